@@ -5,7 +5,6 @@ layout(location = 0) out vec4 FinalColor;
 in vec3 FragColor;
 in vec2 TexCoords;
 in float vThickness;
-in float vTotalLength;
 
 uniform float u_alpha = 1.0;
 
@@ -14,12 +13,9 @@ void main() {
 
   float dx = (TexCoords.x - 0.5) * vThickness;
 
-  float dy = 0.0;
-  if (TexCoords.y < 0.0) {
-    dy = TexCoords.y;
-  } else if (TexCoords.y > vTotalLength) {
-    dy = TexCoords.y - vTotalLength;
-  }
+  // Zero along the body, ramps to +/- radius across the caps; each cap is
+  // a quad exactly one radius long, so this is the distance past the end
+  float dy = TexCoords.y * radius;
 
   float dist = sqrt(dx * dx + dy * dy);
 
@@ -1,28 +1,43 @@
-#version 450 core
+#version 460 core
 
 layout(location = 0) in vec2 aPos;
-layout(location = 1) in vec3 aColor;
-layout(location = 2) in vec2 aUv;
-layout(location = 3) in float aThickness;
-layout(location = 4) in float aTotalLength;
+layout(location = 1) in float aSide;
+layout(location = 2) in float aCap;
+
+// Mirrors StrokeStyle in stroke_style.h
+struct StrokeStyle {
+  vec2 origin;
+  float extent;
+  float thickness;
+  vec3 color;
+  float total_length;
+  uint flags;
+};
+
+layout(std430, binding = 0) readonly buffer StrokeStyles {
+  StrokeStyle styles[];
+};
 
 out vec3 FragColor;
 out vec2 TexCoords;
 out float vThickness;
-out float vTotalLength;
 
 uniform mat4 u_projection;
 
 void main() {
-  // Apply the projection matrix to the vertex position
-  gl_Position = u_projection * vec4(aPos, 0.0, 1.0);
+  // Strokes are drawn as one instance whose base instance is the style slot,
+  // so a whole multi-draw batch needs no per-stroke uniforms
+  StrokeStyle style = styles[gl_BaseInstance];
 
-  // Pass the color to the fragment shader
-  FragColor = aColor;
+  // Dequantize the position inside the stroke's box
+  vec2 world_pos = style.origin + aPos * style.extent;
+  gl_Position = u_projection * vec4(world_pos, 0.0, 1.0);
 
-  TexCoords = aUv;
+  // Pass the color to the fragment shader
+  FragColor = style.color;
 
-  vThickness = aThickness;
+  // x: across the ribbon [0, 1], y: into the caps [-1, 1] (0 on the body)
+  TexCoords = vec2(aSide, aCap);
 
-  vTotalLength = aTotalLength;
+  vThickness = style.thickness;
 }
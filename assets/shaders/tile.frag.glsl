@@ -0,0 +1,9 @@
+#version 450 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// Premultiplied color, composited with GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+layout(binding = 0) uniform sampler2D u_tile;
+
+void main() { FragColor = texture(u_tile, TexCoords); }
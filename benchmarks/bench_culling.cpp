@@ -0,0 +1,238 @@
+// Viewport culling over large stroke sets: the linear AABB::intersects scan
+// against SpatialIndex queries, for the same seeded bounds and viewports,
+// from a screen-sized view up to an overview of the whole canvas. Then the
+// selection queries built on the index: pick, rect and lasso.
+
+#include "geometry.h"
+#include "spatial_index.h"
+#include "stroke.h"
+#include "stroke_generators.h"
+#include "stroke_selection.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SEED = 20240602;
+constexpr size_t POINTS_PER_STROKE = 16;
+constexpr size_t VIEWPORT_COUNT = 256;
+
+// Strokes cover a square that grows with their count, so density (and the
+// share a viewport sees) stays the same at every size
+double canvas_extent(size_t count) {
+  return std::sqrt(static_cast<double>(count)) * 0.1;
+}
+
+// How far the camera is zoomed out
+enum class ViewKind {
+  Screen,   // 1.6 x 0.9 world units, the default zoom
+  Region,   // A quarter of the canvas across
+  Overview, // The whole canvas
+};
+
+const char *view_kind_name(ViewKind kind) {
+  switch (kind) {
+  case ViewKind::Screen:
+    return "screen";
+  case ViewKind::Region:
+    return "region";
+  case ViewKind::Overview:
+    break;
+  }
+  return "overview";
+}
+
+// Viewports of `kind` at seeded positions over the canvas
+std::vector<AABB> generate_viewports(double extent, ViewKind kind) {
+  std::mt19937 rng(SEED);
+  glm::dvec2 size(1.6, 0.9);
+  if (kind == ViewKind::Region)
+    size = glm::dvec2(extent * 0.25, extent * 0.25 * 0.5625);
+  else if (kind == ViewKind::Overview)
+    size = glm::dvec2(extent / 0.5625, extent);
+
+  // Overviews are centred on the canvas, with some jitter
+  std::uniform_real_distribution<double> position(0.0, extent);
+  std::uniform_real_distribution<double> jitter(-0.05, 0.05);
+
+  std::vector<AABB> viewports;
+  for (size_t i = 0; i < VIEWPORT_COUNT; ++i) {
+    glm::dvec2 min(position(rng), position(rng));
+    if (kind == ViewKind::Overview) {
+      min = glm::dvec2(extent * 0.5) - size * 0.5 +
+            extent * glm::dvec2(jitter(rng), jitter(rng));
+    }
+    viewports.push_back({min, min + size});
+  }
+  return viewports;
+}
+
+const std::vector<AABB> &cached_bounds(size_t count) {
+  // Generated once per size; a million strokes take a moment
+  static std::vector<std::vector<AABB>> cache(3);
+  size_t slot = count >= 1000000 ? 2 : count >= 100000 ? 1 : 0;
+  if (cache[slot].size() != count) {
+    cache[slot] = generate_bounds(count, POINTS_PER_STROKE, SEED,
+                                  canvas_extent(count));
+  }
+  return cache[slot];
+}
+
+void BM_CullLinear(benchmark::State &state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  auto kind = static_cast<ViewKind>(state.range(1));
+  const std::vector<AABB> &bounds = cached_bounds(count);
+  std::vector<AABB> viewports = generate_viewports(canvas_extent(count), kind);
+
+  std::vector<uint32_t> visible;
+  size_t frame = 0;
+  for (auto _ : state) {
+    const AABB &view = viewports[frame++ % viewports.size()];
+    visible.clear();
+    for (size_t i = 0; i < bounds.size(); ++i) {
+      if (bounds[i].intersects(view))
+        visible.push_back(static_cast<uint32_t>(i));
+    }
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+  state.counters["visible"] = static_cast<double>(visible.size());
+  state.SetLabel(view_kind_name(kind));
+}
+BENCHMARK(BM_CullLinear)
+    ->ArgNames({"strokes", "view"})
+    ->ArgsProduct({{10000, 100000, 1000000}, {0, 1, 2}});
+
+void BM_CullSpatialIndex(benchmark::State &state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  auto kind = static_cast<ViewKind>(state.range(1));
+  const std::vector<AABB> &bounds = cached_bounds(count);
+  std::vector<AABB> viewports = generate_viewports(canvas_extent(count), kind);
+
+  SpatialIndex index;
+  for (size_t i = 0; i < bounds.size(); ++i)
+    index.insert(static_cast<uint32_t>(i), bounds[i]);
+
+  std::vector<uint32_t> visible;
+  size_t frame = 0;
+  for (auto _ : state) {
+    const AABB &view = viewports[frame++ % viewports.size()];
+    visible.clear();
+    index.query(view, visible);
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+  state.counters["visible"] = static_cast<double>(visible.size());
+  state.SetLabel(view_kind_name(kind));
+}
+BENCHMARK(BM_CullSpatialIndex)
+    ->ArgNames({"strokes", "view"})
+    ->ArgsProduct({{10000, 100000, 1000000}, {0, 1, 2}});
+
+// World units per pixel at the default zoom, for the pick tolerance
+constexpr double PIXEL_SIZE = 2.0 / 600.0;
+constexpr double PICK_RADIUS_PIXELS = 4.0;
+
+// A board of committed strokes with their geometry built, as the selection
+// queries see it, and its index
+struct Board {
+  std::vector<Stroke> strokes;
+  SpatialIndex index;
+};
+
+Board &cached_board(size_t count) {
+  static Board board;
+  if (board.strokes.size() != count) {
+    board.strokes = generate_canvas(count, POINTS_PER_STROKE, SEED,
+                                    canvas_extent(count));
+    board.index.clear();
+    for (size_t i = 0; i < board.strokes.size(); ++i) {
+      board.strokes[i].update_geometry();
+      board.index.insert(static_cast<uint32_t>(i),
+                         board.strokes[i].get_bounds());
+    }
+  }
+  return board;
+}
+
+std::vector<glm::dvec2> generate_positions(double extent) {
+  std::mt19937 rng(SEED);
+  std::uniform_real_distribution<double> position(0.0, extent);
+
+  std::vector<glm::dvec2> positions;
+  for (size_t i = 0; i < VIEWPORT_COUNT; ++i)
+    positions.push_back({position(rng), position(rng)});
+  return positions;
+}
+
+// Middle click on a random spot of the board
+void BM_PickStroke(benchmark::State &state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  Board &board = cached_board(count);
+  std::vector<glm::dvec2> clicks = generate_positions(canvas_extent(count));
+
+  size_t frame = 0, hits = 0;
+  for (auto _ : state) {
+    uint32_t picked;
+    hits += pick_stroke(board.strokes, board.index,
+                        clicks[frame++ % clicks.size()],
+                        PICK_RADIUS_PIXELS * PIXEL_SIZE, picked);
+    benchmark::DoNotOptimize(picked);
+  }
+  state.counters["hit_rate"] =
+      static_cast<double>(hits) / static_cast<double>(frame);
+}
+BENCHMARK(BM_PickStroke)->ArgName("strokes")->Arg(100000);
+
+// Rubber-band selection of about a quarter of the screen
+void BM_SelectInRect(benchmark::State &state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  Board &board = cached_board(count);
+  std::vector<glm::dvec2> corners = generate_positions(canvas_extent(count));
+  glm::dvec2 size(0.8, 0.45);
+
+  std::vector<uint32_t> selected;
+  size_t frame = 0;
+  for (auto _ : state) {
+    glm::dvec2 corner = corners[frame++ % corners.size()];
+    selected.clear();
+    select_in_rect(board.strokes, board.index, {corner, corner + size},
+                   selected);
+    benchmark::DoNotOptimize(selected.data());
+  }
+  state.counters["selected"] = static_cast<double>(selected.size());
+}
+BENCHMARK(BM_SelectInRect)->ArgName("strokes")->Arg(100000);
+
+// Lasso of a circle about as large, drawn with 64 points
+void BM_SelectInLasso(benchmark::State &state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  Board &board = cached_board(count);
+  std::vector<glm::dvec2> centers = generate_positions(canvas_extent(count));
+
+  std::vector<glm::dvec2> circle;
+  for (int i = 0; i < 64; ++i) {
+    double angle = i * 6.283185307179586 / 64.0;
+    circle.push_back(0.3 * glm::dvec2(std::cos(angle), std::sin(angle)));
+  }
+
+  std::vector<glm::dvec2> lasso(circle.size());
+  std::vector<uint32_t> selected;
+  size_t frame = 0;
+  for (auto _ : state) {
+    glm::dvec2 center = centers[frame++ % centers.size()];
+    for (size_t i = 0; i < circle.size(); ++i)
+      lasso[i] = center + circle[i];
+    selected.clear();
+    select_in_lasso(board.strokes, board.index, lasso, selected);
+    benchmark::DoNotOptimize(selected.data());
+  }
+  state.counters["selected"] = static_cast<double>(selected.size());
+}
+BENCHMARK(BM_SelectInLasso)->ArgName("strokes")->Arg(100000);
+
+} // namespace
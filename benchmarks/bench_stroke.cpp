@@ -0,0 +1,133 @@
+// Stroke geometry: the per-sample cost while drawing and the full rebuilds
+// done when documents load or strokes are edited.
+
+#include "stroke.h"
+#include "stroke_generators.h"
+#include "task_scheduler.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SEED = 20240601;
+
+void set_shape_label(benchmark::State &state, StrokeShape shape) {
+  state.SetLabel(stroke_shape_name(shape));
+}
+
+// 1, 2, 4, ... threads up to every hardware thread. One thread is the
+// caller alone, the baseline for the scaling.
+std::vector<int64_t> thread_counts() {
+  int64_t hardware =
+      std::max<int64_t>(1, std::thread::hardware_concurrency());
+  std::vector<int64_t> counts;
+  for (int64_t threads = 1; threads < hardware; threads *= 2)
+    counts.push_back(threads);
+  counts.push_back(hardware);
+  return counts;
+}
+
+// Drawing a whole stroke one add_point() at a time, as the app does
+void BM_AddPoint(benchmark::State &state) {
+  auto shape = static_cast<StrokeShape>(state.range(0));
+  size_t count = static_cast<size_t>(state.range(1));
+  std::vector<glm::dvec2> points = generate_points(shape, count, SEED);
+
+  for (auto _ : state) {
+    Stroke stroke({0.0f, 0.0f, 0.0f}, 0.02);
+    for (glm::dvec2 point : points)
+      stroke.add_point(point.x, point.y);
+    benchmark::DoNotOptimize(stroke.get_render_vertices().data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+  set_shape_label(state, shape);
+}
+BENCHMARK(BM_AddPoint)
+    ->ArgNames({"shape", "points"})
+    ->ArgsProduct({{0, 1, 2}, {64, 1024, 16384}});
+
+// The same stroke fed in per-frame batches, as staged input arrives: a
+// 1 kHz tablet delivers about 8 samples per 120 Hz frame
+void BM_AddPointsBatched(benchmark::State &state) {
+  auto shape = static_cast<StrokeShape>(state.range(0));
+  size_t count = static_cast<size_t>(state.range(1));
+  size_t batch = static_cast<size_t>(state.range(2));
+  std::vector<glm::dvec2> points = generate_points(shape, count, SEED);
+
+  for (auto _ : state) {
+    Stroke stroke({0.0f, 0.0f, 0.0f}, 0.02);
+    for (size_t i = 0; i < points.size(); i += batch) {
+      size_t size = std::min(batch, points.size() - i);
+      stroke.add_points(std::span<const glm::dvec2>(points.data() + i, size));
+    }
+    benchmark::DoNotOptimize(stroke.get_render_vertices().data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+  set_shape_label(state, shape);
+}
+BENCHMARK(BM_AddPointsBatched)
+    ->ArgNames({"shape", "points", "batch"})
+    ->ArgsProduct({{0, 1, 2}, {1024, 16384}, {1, 4, 8, 16}});
+
+// Full re-smoothing and re-tessellation on one thread, at the default
+// number of Chaikin passes (2) and around it. Every pass doubles the
+// smoothed points, and with them the tessellation work.
+void BM_UpdateGeometry(benchmark::State &state) {
+  auto shape = static_cast<StrokeShape>(state.range(0));
+  size_t count = static_cast<size_t>(state.range(1));
+  int iterations = static_cast<int>(state.range(2));
+  Stroke stroke = generate_stroke(shape, count, SEED);
+
+  for (auto _ : state) {
+    stroke.update_geometry(iterations);
+    benchmark::DoNotOptimize(stroke.get_render_vertices().data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+  state.counters["smooth_points"] =
+      static_cast<double>(stroke.get_smooth_points().size());
+  set_shape_label(state, shape);
+}
+BENCHMARK(BM_UpdateGeometry)
+    ->ArgNames({"shape", "points", "smoothing"})
+    ->ArgsProduct({{0, 1, 2}, {256, 4096, 65536}, {0, 1, 2, 3, 4}});
+
+// One long stroke tessellated in parallel ranges
+void BM_UpdateGeometryParallel(benchmark::State &state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  unsigned threads = static_cast<unsigned>(state.range(1));
+  TaskScheduler scheduler(threads - 1);
+  Stroke stroke = generate_stroke(StrokeShape::Scribble, count, SEED);
+
+  for (auto _ : state) {
+    stroke.update_geometry(scheduler);
+    benchmark::DoNotOptimize(stroke.get_render_vertices().data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_UpdateGeometryParallel)
+    ->ArgNames({"points", "threads"})
+    ->ArgsProduct({{65536, 262144}, thread_counts()})
+    ->UseRealTime();
+
+// Building every stroke of a loaded document
+void BM_RebuildStrokes(benchmark::State &state) {
+  unsigned threads = static_cast<unsigned>(state.range(0));
+  TaskScheduler scheduler(threads - 1);
+  std::vector<Stroke> strokes = generate_canvas(2000, 200, SEED, 10.0);
+
+  for (auto _ : state)
+    rebuild_strokes(strokes, scheduler);
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(strokes.size()));
+}
+BENCHMARK(BM_RebuildStrokes)
+    ->ArgName("threads")
+    ->ArgsProduct({thread_counts()})
+    ->UseRealTime();
+
+} // namespace
@@ -0,0 +1,56 @@
+// UI hit testing: UIManager::handle_click over toolbars of growing size.
+
+#include "ui_manager.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SEED = 20240603;
+constexpr float BUTTON_SIZE = 40.0f;
+constexpr float BUTTON_GAP = 10.0f;
+constexpr int BUTTON_ROWS = 2;
+constexpr size_t CLICK_COUNT = 1024;
+
+// `count` buttons in BUTTON_ROWS rows along the top of the window, like the
+// color swatches and tool buttons of the app
+void BM_HandleClick(benchmark::State &state) {
+  int count = static_cast<int>(state.range(0));
+  int columns = (count + BUTTON_ROWS - 1) / BUTTON_ROWS;
+
+  UIManager ui;
+  size_t clicked = 0;
+  for (int i = 0; i < count; ++i) {
+    float x = BUTTON_GAP + (i % columns) * (BUTTON_SIZE + BUTTON_GAP);
+    float y = BUTTON_GAP + (i / columns) * (BUTTON_SIZE + BUTTON_GAP);
+    ui.add_element("button" + std::to_string(i),
+                   {x, y, BUTTON_SIZE, BUTTON_SIZE}, glm::vec3(1.0f),
+                   [&clicked](UIElement *) { clicked++; });
+  }
+
+  // Seeded clicks over the toolbar area, both on buttons and in the gaps
+  std::mt19937 rng(SEED);
+  std::uniform_real_distribution<double> x_position(
+      0.0, columns * (BUTTON_SIZE + BUTTON_GAP) + BUTTON_GAP);
+  std::uniform_real_distribution<double> y_position(
+      0.0, BUTTON_ROWS * (BUTTON_SIZE + BUTTON_GAP) + BUTTON_GAP);
+  std::vector<glm::dvec2> clicks;
+  for (size_t i = 0; i < CLICK_COUNT; ++i)
+    clicks.push_back({x_position(rng), y_position(rng)});
+
+  size_t next = 0;
+  for (auto _ : state) {
+    glm::dvec2 click = clicks[next++ % clicks.size()];
+    benchmark::DoNotOptimize(ui.handle_click(click.x, click.y));
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["hit_rate"] =
+      static_cast<double>(clicked) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_HandleClick)->ArgName("elements")->Arg(8)->Arg(64)->Arg(512);
+
+} // namespace
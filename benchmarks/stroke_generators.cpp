@@ -0,0 +1,129 @@
+#include "stroke_generators.h"
+
+#include <cmath>
+#include <numbers>
+#include <random>
+
+namespace {
+
+// Radians the scribble heading may turn per sample
+constexpr double SCRIBBLE_TURN = 0.35;
+
+// Spiral turns over the whole stroke
+constexpr double SPIRAL_TURNS = 6.0;
+
+} // namespace
+
+const char *stroke_shape_name(StrokeShape shape) {
+  switch (shape) {
+  case StrokeShape::Scribble:
+    return "scribble";
+  case StrokeShape::Line:
+    return "line";
+  case StrokeShape::Spiral:
+    return "spiral";
+  }
+  return "unknown";
+}
+
+std::vector<glm::dvec2> generate_points(StrokeShape shape, size_t count,
+                                        uint32_t seed, glm::dvec2 origin,
+                                        double step) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  double heading = unit(rng) * std::numbers::pi;
+
+  std::vector<glm::dvec2> points;
+  points.reserve(count);
+  switch (shape) {
+  case StrokeShape::Scribble: {
+    glm::dvec2 point = origin;
+    double turn = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+      points.push_back(point);
+      turn = glm::clamp(turn + unit(rng) * SCRIBBLE_TURN * 0.5,
+                        -SCRIBBLE_TURN, SCRIBBLE_TURN);
+      heading += turn;
+      point += glm::dvec2(std::cos(heading), std::sin(heading)) * step;
+    }
+    break;
+  }
+  case StrokeShape::Line: {
+    glm::dvec2 direction(std::cos(heading), std::sin(heading));
+    for (size_t i = 0; i < count; ++i)
+      points.push_back(origin + direction * (step * static_cast<double>(i)));
+    break;
+  }
+  case StrokeShape::Spiral: {
+    // r = b * angle keeps neighbouring turns evenly spaced; samples are
+    // spaced `step` apart along the curve (arc length ~ b * angle^2 / 2)
+    double total_angle = SPIRAL_TURNS * 2.0 * std::numbers::pi;
+    double arc_length = step * static_cast<double>(count);
+    double b = 2.0 * arc_length / (total_angle * total_angle);
+    for (size_t i = 0; i < count; ++i) {
+      double s = step * static_cast<double>(i);
+      double angle = b > 0.0 ? std::sqrt(2.0 * s / b) : 0.0;
+      double radius = b * angle;
+      points.push_back(origin + radius * glm::dvec2(std::cos(angle + heading),
+                                                    std::sin(angle + heading)));
+    }
+    break;
+  }
+  }
+  return points;
+}
+
+Stroke generate_stroke(StrokeShape shape, size_t count, uint32_t seed,
+                       double thickness) {
+  Stroke stroke({0.0f, 0.0f, 0.0f}, thickness);
+  for (glm::dvec2 point : generate_points(shape, count, seed))
+    stroke.add_point(point.x, point.y);
+  return stroke;
+}
+
+std::vector<AABB> generate_bounds(size_t count, size_t points_per_stroke,
+                                  uint32_t seed, double extent,
+                                  double thickness) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> position(0.0, extent);
+
+  std::vector<AABB> bounds;
+  bounds.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto shape = static_cast<StrokeShape>(i % STROKE_SHAPE_COUNT);
+    glm::dvec2 origin(position(rng), position(rng));
+    std::vector<glm::dvec2> points = generate_points(
+        shape, points_per_stroke, static_cast<uint32_t>(rng()), origin);
+
+    AABB box = {points.front(), points.front()};
+    for (glm::dvec2 point : points) {
+      box.min = glm::min(box.min, point);
+      box.max = glm::max(box.max, point);
+    }
+    box.min -= thickness * 0.5;
+    box.max += thickness * 0.5;
+    bounds.push_back(box);
+  }
+  return bounds;
+}
+
+std::vector<Stroke> generate_canvas(size_t count, size_t points_per_stroke,
+                                    uint32_t seed, double extent,
+                                    double thickness) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> position(0.0, extent);
+
+  std::vector<Stroke> strokes;
+  strokes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto shape = static_cast<StrokeShape>(i % STROKE_SHAPE_COUNT);
+    glm::dvec2 origin(position(rng), position(rng));
+
+    Stroke stroke({0.0f, 0.0f, 0.0f}, thickness);
+    stroke.set_raw_points(generate_points(shape, points_per_stroke,
+                                          static_cast<uint32_t>(rng()),
+                                          origin));
+    strokes.push_back(std::move(stroke));
+  }
+  return strokes;
+}
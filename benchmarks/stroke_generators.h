@@ -0,0 +1,46 @@
+#pragma once
+
+#include "geometry.h"
+#include "stroke.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Seeded synthetic input for the benchmarks. The same shape, count and seed
+// always give the same points, so results stay comparable across runs and
+// releases.
+enum class StrokeShape { Scribble, Line, Spiral };
+
+constexpr int STROKE_SHAPE_COUNT = 3;
+
+const char *stroke_shape_name(StrokeShape shape);
+
+// `count` samples of `shape` starting at `origin`, spaced about `step`
+// apart like pointer input:
+//   Scribble: a random walk whose heading drifts smoothly
+//   Line:     evenly spaced along one random direction
+//   Spiral:   an Archimedean spiral around `origin`
+std::vector<glm::dvec2> generate_points(StrokeShape shape, size_t count,
+                                        uint32_t seed,
+                                        glm::dvec2 origin = {0.0, 0.0},
+                                        double step = 0.01);
+
+// A stroke drawn by feeding generate_points() to add_point()
+Stroke generate_stroke(StrokeShape shape, size_t count, uint32_t seed,
+                       double thickness = 0.02);
+
+// Bounds of `count` strokes of `points_per_stroke` samples each, of every
+// shape, spread over the square [0, extent]^2. Cheaper than building the
+// strokes, for culling sets of a million.
+std::vector<AABB> generate_bounds(size_t count, size_t points_per_stroke,
+                                  uint32_t seed, double extent,
+                                  double thickness = 0.02);
+
+// Committed strokes of every shape spread over [0, extent]^2, with the raw
+// points only (as loaded from a document) so each still needs
+// update_geometry()
+std::vector<Stroke> generate_canvas(size_t count, size_t points_per_stroke,
+                                    uint32_t seed, double extent,
+                                    double thickness = 0.02);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "geometry.h"
+#include "shader.h"
+#include "stroke.h"
+#include "stroke_batch.h"
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Vertex layout of PointVertex for the stroke shader (binding 0)
+void setup_stroke(GLuint &stroke_vao);
+
+// Draws committed strokes into an offscreen image of any size and reads it
+// back, independent of any window system. Needs a current GL 4.6 context:
+// a window's or an OffscreenContext.
+//
+// Images hold premultiplied color over transparent black, like the tile
+// cache, so erasers punch holes that a background can show through.
+class CanvasRenderer {
+  Shader m_stroke_shader;
+  GLuint m_stroke_vao = 0;
+  GLuint m_fbo = 0;
+  GLuint m_color = 0;
+  int m_width = 0;
+  int m_height = 0;
+  StrokeBatch m_batch;
+
+public:
+  CanvasRenderer(const char *vertex_path, const char *fragment_path);
+  ~CanvasRenderer();
+
+  CanvasRenderer(const CanvasRenderer &) = delete;
+  CanvasRenderer &operator=(const CanvasRenderer &) = delete;
+
+  // Draws `strokes` in order, each at the LOD that suits the image, so that
+  // `view` fills a `width` x `height` image. The strokes must be uploaded.
+  // Returns false if the size exceeds what the driver supports.
+  bool render(std::span<const Stroke> strokes, const AABB &view, int width,
+              int height);
+
+  // The last image as RGBA8, top row first
+  void read_pixels(std::vector<uint8_t> &rgba) const;
+
+  int get_width() const { return m_width; }
+  int get_height() const { return m_height; }
+
+  // Largest image side the driver can render
+  static int get_max_size();
+
+private:
+  void resize(int width, int height);
+};
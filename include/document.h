@@ -0,0 +1,112 @@
+#pragma once
+
+#include "geometry.h"
+#include "stroke.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Binary canvas file, laid out so that a read-only mapping can be used in
+// place. All fields are little-endian.
+//
+//   DocumentHeader
+//   StrokeRecord[stroke_count]   at stroke_table_offset
+//   glm::dvec2[point_count]      at point_offset (POINT_ALIGNMENT aligned)
+//
+// Every stroke's raw points are one contiguous slice of the point section.
+// The table lists the visible strokes in draw order, then the undone ones
+// (FLAG_REVERTED) from the bottom of the redo stack up.
+struct DocumentHeader {
+  static constexpr char MAGIC[8] = {'S', 'P', 'A', 'I', 'N', 'T', '\0', '\0'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint64_t POINT_ALIGNMENT = 64;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t stroke_count;
+  uint64_t stroke_table_offset; // Bytes from the start of the file
+  uint64_t point_count;
+  uint64_t point_offset; // Bytes from the start of the file
+  uint64_t file_size;
+  uint64_t journal_sequence; // Last journal record folded in, 0 if none
+};
+static_assert(sizeof(DocumentHeader) == 64);
+
+struct StrokeRecord {
+  static constexpr uint32_t FLAG_ERASER = 1u << 0;
+  static constexpr uint32_t FLAG_REVERTED = 1u << 1;
+
+  float color[3];
+  uint32_t flags;
+  double thickness;
+  double bounds[4];     // min x, min y, max x, max y
+  uint64_t first_point; // Index into the point section
+  uint64_t point_count;
+};
+static_assert(sizeof(StrokeRecord) == 72);
+
+// Table entry for `stroke`, whose points start at `first_point`
+StrokeRecord make_stroke_record(const Stroke &stroke, uint64_t first_point,
+                                uint32_t flags = 0);
+
+// Stroke described by `record` that reads `points` in place (see
+// Stroke::attach_points); `source` owns them.
+Stroke make_stroke(const StrokeRecord &record,
+                   std::span<const glm::dvec2> points,
+                   std::shared_ptr<const void> source);
+
+// Writes `strokes` and the redo stack `reverted` to `path` in one
+// sequential pass. The file is written next to `path` and renamed over it,
+// so a document that is currently mapped stays valid. Returns true once the
+// new file and the rename are both on disk, false on I/O errors.
+bool save_document(const std::string &path, std::span<const Stroke> strokes,
+                   std::span<const Stroke> reverted = {},
+                   uint64_t journal_sequence = 0);
+
+// A document file mapped read-only into memory. Nothing is copied on open;
+// pages are faulted in as strokes are first read.
+class MappedDocument {
+  const unsigned char *m_data = nullptr;
+  size_t m_size = 0;
+  const DocumentHeader *m_header = nullptr;
+  const StrokeRecord *m_records = nullptr;
+  const glm::dvec2 *m_points = nullptr;
+
+  MappedDocument() = default;
+
+public:
+  ~MappedDocument();
+
+  MappedDocument(const MappedDocument &) = delete;
+  MappedDocument &operator=(const MappedDocument &) = delete;
+
+  // Maps and validates `path`. Returns nullptr (and reports why) on error.
+  static std::shared_ptr<const MappedDocument> open(const std::string &path);
+
+  size_t get_stroke_count() const { return m_header->stroke_count; }
+  size_t get_point_count() const { return m_header->point_count; }
+  uint64_t get_journal_sequence() const {
+    return m_header->journal_sequence;
+  }
+  const StrokeRecord &get_record(size_t index) const {
+    return m_records[index];
+  }
+  std::span<const glm::dvec2> get_points(size_t index) const {
+    const StrokeRecord &record = m_records[index];
+    return {m_points + record.first_point, record.point_count};
+  }
+  size_t get_size() const { return m_size; }
+};
+
+// Appends the strokes of `document` to `strokes`, and its undone ones to
+// `reverted`. The strokes read their raw points straight from the mapping
+// (keeping it alive) and have no geometry until it is built on first use.
+void load_strokes(const std::shared_ptr<const MappedDocument> &document,
+                  std::vector<Stroke> &strokes,
+                  std::vector<Stroke> &reverted);
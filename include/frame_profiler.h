@@ -0,0 +1,176 @@
+#pragma once
+
+// Frame profiler: nestable scoped zones that record CPU time and GPU time.
+//
+//   PROFILE_ZONE("culling");  // until the end of the enclosing scope
+//   PROFILE_FRAME();          // once per frame, after the swap
+//
+// GPU time comes from GL_TIMESTAMP queries at both ends of a zone. Unlike
+// GL_TIME_ELAPSED queries, these nest. They are read FRAME_LATENCY - 1
+// frames later and only if already available, so the profiler never waits
+// on the GPU; a frame whose queries are late just has no GPU times.
+//
+// Resolved frames feed rolling per-zone statistics (drawn by draw_hud())
+// and a ring of recent frames that write_trace() exports in the Chrome
+// trace format (chrome://tracing, Perfetto).
+//
+// Configure with -DSIMPLE_PAINT_PROFILER=OFF to compile all of it out: the
+// macros expand to nothing and the class is not declared.
+
+#if SIMPLE_PAINT_PROFILE
+
+#include "shader.h"
+#include <glad/gl.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name)                                                     \
+  FrameProfiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(                 \
+      FrameProfiler::instance(), name)
+#define PROFILE_FRAME() FrameProfiler::instance().end_frame()
+
+class FrameProfiler {
+public:
+  // Frames between recording GPU queries and reading them back
+  static constexpr int FRAME_LATENCY = 4;
+
+  // Frames the rolling statistics cover
+  static constexpr size_t HISTORY_FRAMES = 240;
+
+  // Frames kept for write_trace()
+  static constexpr size_t TRACE_FRAMES = 600;
+
+  // Timestamps are nanoseconds since the profiler started; -1 is unknown
+  struct ZoneRecord {
+    const char *name; // A string literal
+    uint32_t depth;
+    int64_t cpu_begin, cpu_end;
+    int64_t gpu_begin = -1, gpu_end = -1;
+  };
+
+  // Milliseconds over the last HISTORY_FRAMES frames
+  struct ZoneStats {
+    const char *name;
+    uint32_t depth;
+    double cpu_mean, cpu_p95, cpu_max;
+    double gpu_mean, gpu_p95, gpu_max; // 0 without GPU times
+  };
+
+  // Times the enclosing scope
+  class Zone {
+    FrameProfiler &m_profiler;
+    uint32_t m_record;
+
+  public:
+    Zone(FrameProfiler &profiler, const char *name)
+        : m_profiler(profiler), m_record(profiler.begin_zone(name)) {}
+    ~Zone() { m_profiler.end_zone(m_record); }
+
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+  };
+
+private:
+  // A frame whose GPU queries may still be in flight
+  struct PendingFrame {
+    uint64_t number = 0;
+    int64_t begin = 0, end = 0;
+    std::vector<ZoneRecord> zones;
+    std::vector<GLuint> queries; // Pool; two per zone, in zone order
+  };
+
+  struct ResolvedFrame {
+    uint64_t number = 0;
+    int64_t begin = 0, end = 0;
+    std::vector<ZoneRecord> zones;
+  };
+
+  // Per zone name, one value per frame (zones that repeat are summed)
+  struct Series {
+    const char *name;
+    uint32_t depth;
+    std::array<float, HISTORY_FRAMES> cpu{};
+    std::array<float, HISTORY_FRAMES> gpu{};
+  };
+
+  std::array<PendingFrame, FRAME_LATENCY> m_pending;
+  size_t m_current = 0;
+  uint64_t m_frame_number = 0;
+  int64_t m_frame_begin = 0;
+  std::vector<uint32_t> m_open; // Records of the zones still open
+
+  std::vector<ResolvedFrame> m_trace; // Ring of TRACE_FRAMES
+  size_t m_trace_next = 0;
+
+  std::vector<Series> m_series;                    // In first-seen order
+  std::array<float, HISTORY_FRAMES> m_frame_ms{}; // Between end_frame() calls
+  size_t m_history_next = 0;
+  size_t m_history_size = 0;
+
+  // GPU clock minus CPU clock, measured every HISTORY_FRAMES frames
+  int64_t m_gpu_offset = 0;
+  bool m_gpu_calibrated = false;
+
+  std::chrono::steady_clock::time_point m_start;
+
+  FrameProfiler();
+
+public:
+  FrameProfiler(const FrameProfiler &) = delete;
+  FrameProfiler &operator=(const FrameProfiler &) = delete;
+
+  static FrameProfiler &instance();
+
+  // Frees the GL queries. Must run while the context is still current.
+  void destroy();
+
+  // Opens a zone inside the innermost open one; returns its record
+  uint32_t begin_zone(const char *name);
+  void end_zone(uint32_t record);
+
+  // Closes the frame, resolves the one FRAME_LATENCY - 1 frames back and
+  // starts the next
+  void end_frame();
+
+  std::vector<ZoneStats> get_stats() const;
+
+  // Frame times (end_frame() to end_frame()): mean and worst, in ms
+  double get_frame_mean_ms() const;
+  double get_frame_max_ms() const;
+
+  // Prints get_stats() as a table, with the HUD color of each zone
+  void print_stats() const;
+
+  // Bars in the bottom left corner, drawn with the UI shader: recent frame
+  // times against the 60 Hz budget, then the mean CPU (upper) and GPU
+  // (lower) time of every zone
+  void draw_hud(const Shader &ui_shader, int window_width,
+                int window_height) const;
+
+  // Writes the kept frames as Chrome trace events: CPU zones on one track,
+  // GPU zones on another. Returns false on I/O errors.
+  bool write_trace(const std::string &path) const;
+
+  // Nanoseconds since the profiler started
+  int64_t now() const;
+
+private:
+  void resolve(PendingFrame &frame);
+  void record_history(const ResolvedFrame &frame);
+  void calibrate_gpu_clock();
+  size_t series_for(const char *name, uint32_t depth);
+};
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+
+#endif // SIMPLE_PAINT_PROFILE
@@ -2,13 +2,33 @@
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compact ribbon vertex (8 bytes). Everything shared by the whole stroke
+// lives once in its StrokeStyle record instead (see stroke_style.h).
+//
+// position: snorm16 offset inside the stroke's quantization box
+// side:     0 / 255 for the left / right edge of the ribbon
+// cap:      -127 / 127 on the pair one radius past the start / end point,
+//           0 everywhere else
 struct PointVertex {
-  glm::vec2 position;
-  glm::vec3 color;
-  glm::vec2 uv;
-  float thickness;
-  float total_stroke_length;
+  int16_t position[2];
+  uint8_t side;
+  int8_t cap;
+  uint16_t _pad;
 };
+static_assert(sizeof(PointVertex) == 8, "PointVertex must stay 8 bytes");
+
+// Layout of one glMultiDrawArraysIndirect record
+struct DrawArraysIndirectCommand {
+  uint32_t count;
+  uint32_t instance_count;
+  uint32_t first;
+  uint32_t base_instance; // Doubles as the stroke's style slot
+};
+static_assert(sizeof(DrawArraysIndirectCommand) == 16);
 
 struct QuadVertex {
   glm::vec2 pos;
@@ -26,3 +46,9 @@ struct AABB {
 };
 
 void draw_quad();
+
+// Ramer-Douglas-Peucker: keeps the fewest points such that no dropped
+// point lies further than `tolerance` from the simplified polyline.
+// Endpoints are always kept.
+void simplify_polyline(const glm::dvec2 *points, size_t count,
+                       double tolerance, std::vector<glm::dvec2> &out);
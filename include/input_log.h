@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary log of the window events a session received, for replaying it
+// with the same input (see simple-paint-replay).
+//
+//   InputLogHeader
+//   { InputRecord }...
+//
+// Records are fixed size and hold the time since the previous record, so
+// a log is about 20 bytes per event and can be appended without seeking.
+struct InputLogHeader {
+  static constexpr char MAGIC[8] = {'S', 'P', 'I', 'N', 'P', 'U', 'T', 0};
+  static constexpr uint32_t VERSION = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  int32_t width; // Framebuffer size when recording started
+  int32_t height;
+};
+static_assert(sizeof(InputLogHeader) == 24);
+
+struct InputRecord {
+  uint32_t delta_us; // Since the previous record (saturates)
+  uint8_t type;      // InputEvent::Type
+  uint8_t action;    // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+  uint8_t mods;      // GLFW_MOD_* bits
+  uint8_t reserved;
+  int32_t code; // Key or mouse button
+  float x, y;   // Cursor position, scroll offset or framebuffer size
+};
+static_assert(sizeof(InputRecord) == 20);
+
+// One window event, as the GLFW callbacks deliver it
+struct InputEvent {
+  enum class Type : uint8_t {
+    Cursor = 1,      // value: position in screen pixels
+    MouseButton = 2, // code: button
+    Key = 3,         // code: key
+    Scroll = 4,      // value: offset
+    Resize = 5,      // value: framebuffer size
+  };
+
+  Type type;
+  double time = 0.0; // Seconds since recording started
+  int code = 0;
+  int action = 0;
+  int mods = 0;
+  glm::dvec2 value = {0.0, 0.0};
+};
+
+struct InputLog {
+  int width = 0;
+  int height = 0;
+  std::vector<InputEvent> events; // By time
+
+  // Returns false, having said why, if the file is missing or not a log.
+  // A truncated last record is dropped.
+  static bool read(const std::string &path, InputLog &log);
+};
+
+// Appends events to a log file as they arrive. Writes are buffered; the
+// file is complete once the recorder is closed or destroyed.
+class InputRecorder {
+  std::ofstream m_file;
+  std::string m_path;
+  double m_start = 0.0;
+  double m_last = 0.0;
+  uint64_t m_count = 0;
+
+public:
+  InputRecorder() = default;
+  ~InputRecorder() { close(); }
+
+  InputRecorder(const InputRecorder &) = delete;
+  InputRecorder &operator=(const InputRecorder &) = delete;
+
+  // Starts a new log; `time` is the clock reading recording starts at.
+  // Returns false, having said why, if the file cannot be created.
+  bool open(const std::string &path, int width, int height, double time);
+
+  // `event.time` is read from the same clock as open()'s `time`
+  void record(const InputEvent &event);
+
+  void close();
+
+  bool is_open() const { return m_file.is_open(); }
+};
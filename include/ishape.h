@@ -1,6 +1,7 @@
 #pragma once
 
 #include "shader.h"
+#include "vertex_arena.h"
 #include <glad/gl.h>
 
 class IShape {
@@ -11,11 +12,11 @@ public:
   virtual void update_geometry() = 0;
 
   // GPU Management
-  virtual void upload() = 0;
+  virtual void upload(VertexArena &arena) = 0;
 
   // Rendering: Needs to know which VAO/Shader to use
   virtual void draw(GLuint &vao, const Shader &shader) const = 0;
 
   // Selection/Modification logic
-  // virtual bool contains_point(float x, float y) const = 0;
+  virtual bool contains_point(double x, double y) const = 0;
 };
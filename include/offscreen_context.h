@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+// A GL 4.6 core context without a window, for rendering on headless
+// servers. Uses EGL on Mesa's surfaceless platform when available (so
+// llvmpipe works without a GPU or display server), otherwise the default
+// EGL display of the installed driver. There is no default framebuffer;
+// everything renders into framebuffer objects (see CanvasRenderer).
+class OffscreenContext {
+  void *m_display = nullptr; // EGLDisplay
+  void *m_context = nullptr; // EGLContext
+
+  OffscreenContext() = default;
+
+public:
+  ~OffscreenContext();
+
+  OffscreenContext(const OffscreenContext &) = delete;
+  OffscreenContext &operator=(const OffscreenContext &) = delete;
+
+  // Creates the context, makes it current on the calling thread and loads
+  // the GL functions. Returns null, having said why, on failure.
+  static std::unique_ptr<OffscreenContext> create();
+
+  // GL_RENDERER and GL_VERSION, for logs
+  std::string get_description() const;
+};
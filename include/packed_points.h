@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <vector>
+
+// Raw samples of a committed stroke in a few bytes each instead of 16: the
+// first point in double precision, then each point's step on a fixed-point
+// grid of `quantum` world units, zigzag and varint packed. Grid positions
+// are rounded, not accumulated, so the error stays below half a step and
+// never drifts along the stroke.
+class PackedPoints {
+  glm::dvec2 m_origin = {0.0, 0.0};
+  double m_quantum = 1.0;
+  size_t m_count = 0;
+  std::vector<uint8_t> m_bytes;
+
+  friend class RawPointView;
+
+public:
+  PackedPoints() = default;
+  PackedPoints(std::span<const glm::dvec2> points, double quantum);
+
+  size_t size() const { return m_count; }
+  bool empty() const { return m_count == 0; }
+  size_t get_byte_size() const { return m_bytes.size(); }
+};
+
+// Read-only sequence of raw points, stored either contiguously or packed.
+// Packed points are decoded one at a time while iterating, so consumers
+// stream them straight into their own buffers.
+class RawPointView {
+  std::span<const glm::dvec2> m_points;
+  const PackedPoints *m_packed = nullptr;
+
+public:
+  class Iterator {
+    // Contiguous storage
+    const glm::dvec2 *m_point = nullptr;
+
+    // Packed storage: next encoded byte and the current grid position
+    const uint8_t *m_byte = nullptr;
+    const PackedPoints *m_packed = nullptr;
+    int64_t m_cell_x = 0;
+    int64_t m_cell_y = 0;
+    glm::dvec2 m_value = {0.0, 0.0};
+
+    size_t m_index = 0;
+
+    friend class RawPointView;
+
+    static int64_t read_delta(const uint8_t *&byte) {
+      uint64_t value = 0;
+      int shift = 0;
+      uint8_t b;
+      do {
+        b = *byte++;
+        value |= static_cast<uint64_t>(b & 0x7f) << shift;
+        shift += 7;
+      } while (b & 0x80);
+      return static_cast<int64_t>(value >> 1) ^
+             -static_cast<int64_t>(value & 1);
+    }
+
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = glm::dvec2;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const glm::dvec2 *;
+    using reference = glm::dvec2;
+
+    Iterator() = default;
+
+    glm::dvec2 operator*() const { return m_packed ? m_value : *m_point; }
+
+    Iterator &operator++() {
+      ++m_index;
+      if (!m_packed) {
+        ++m_point;
+      } else if (m_index < m_packed->m_count) {
+        m_cell_x += read_delta(m_byte);
+        m_cell_y += read_delta(m_byte);
+        m_value = m_packed->m_origin +
+                  glm::dvec2(static_cast<double>(m_cell_x),
+                             static_cast<double>(m_cell_y)) *
+                      m_packed->m_quantum;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator previous = *this;
+      ++*this;
+      return previous;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return m_index == other.m_index;
+    }
+  };
+
+  RawPointView(std::span<const glm::dvec2> points) : m_points(points) {}
+  RawPointView(const PackedPoints &packed) : m_packed(&packed) {}
+
+  size_t size() const { return m_packed ? m_packed->size() : m_points.size(); }
+  bool empty() const { return size() == 0; }
+  bool is_packed() const { return m_packed != nullptr; }
+
+  Iterator begin() const;
+  Iterator end() const;
+  glm::dvec2 front() const { return *begin(); }
+
+  // The points as one span: as stored, or decoded into `storage` if packed
+  std::span<const glm::dvec2>
+  contiguous(std::vector<glm::dvec2> &storage) const;
+};
@@ -3,8 +3,20 @@
 #include <glad/gl.h>
 
 #include "shader.h"
+#include "input_log.h"
+#include "spatial_index.h"
+#include "streaming_buffer.h"
 #include "stroke.h"
+#include "stroke_batch.h"
+#include "stroke_edit.h"
+#include "stroke_finalizer.h"
+#include "stroke_journal.h"
+#include "stroke_predictor.h"
+#include "task_scheduler.h"
+#include "tile_cache.h"
 #include "ui_manager.h"
+#include "undo_history.h"
+#include "vertex_arena.h"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -22,7 +34,18 @@ struct InputState {
   glm::dvec2 curr_pos;
   glm::dvec2 prev_pos;
 
-  bool is_pressed = false;
+  // Latest cursor event; curr_pos catches up once per frame
+  glm::dvec2 cursor_pos = {0.0, 0.0};
+
+  // Time of the event being handled, in seconds (see InputEvent)
+  double event_time = 0.0;
+
+  // Tracked from events rather than polled, so replayed input sees the
+  // same state as the recorded session
+  bool is_pressed = false; // Left button
+  bool right_pressed = false;
+  bool space_down = false;
+  bool ctrl_down = false; // Left Ctrl
 
   void update_pos(glm::dvec2 new_pos) {
     prev_pos = curr_pos;
@@ -44,12 +67,33 @@ struct AppState {
   glm::vec3 current_color = {1.0f, 1.0f, 1.0f};
   float current_thickness = 0.01f;
 
+  // Max distance (world units) a raw sample may move when a committed
+  // stroke is simplified. 0 keeps every sample; negative derives it per
+  // stroke, as simplify_thickness_ratio of its thickness capped at half a
+  // pixel at the zoom it was drawn at.
+  double simplify_tolerance = -1.0;
+  double simplify_thickness_ratio = 0.05;
+
+  // Draw committed strokes through the raster tile cache (F4 toggles)
+  bool use_tile_cache = true;
+
+  // Draw the frame profiler HUD (F6 toggles; profiler builds only)
+  bool show_profiler = false;
+
+  // Seconds the live stroke is extrapolated past its last sample to hide
+  // display latency; 0 turns prediction off (F8 cycles)
+  double prediction_horizon = 0.016;
+
   // --- Interaction State ---
   bool is_drawing = false;
   bool is_panning = false;
 
   bool is_eraser = false;
 
+  // The eraser cuts the strokes it covers instead of painting over them
+  // (V toggles)
+  bool vector_eraser = false;
+
   // --- Viewport ---
   int window_width = 800;
   int window_height = 600;
@@ -69,15 +113,27 @@ public:
   const char *UI_FRAGMENT_SHADER_PATH = SHADER_PATH "/ui.frag.glsl";
   const char *GRID_VERTEX_SHADER_PATH = SHADER_PATH "/grid.vert.glsl";
   const char *GRID_FRAGMENT_SHADER_PATH = SHADER_PATH "/grid.frag.glsl";
+  const char *TILE_VERTEX_SHADER_PATH = SHADER_PATH "/tile.vert.glsl";
+  const char *TILE_FRAGMENT_SHADER_PATH = SHADER_PATH "/tile.frag.glsl";
+
+  // Snapshot (and, next to it, the journal) relative to the working
+  // directory. Loaded on startup; Ctrl+O reloads, Ctrl+S compacts.
+  // Set by the constructor; replays use a scratch document.
+  const char *DOCUMENT_PATH = "canvas.spd";
 
 private:
   const int PREVIEW_SEGMENTS = 64;
+  // How close (in pixels) a click must come to a stroke to pick it
+  static constexpr double PICK_RADIUS_PIXELS = 4.0;
+  // Vertices per shared arena block (8 MiB of PointVertex)
+  static constexpr uint32_t ARENA_BLOCK_VERTICES = 1u << 20;
 
   GLFWwindow *m_window;
 
   Shader m_stroke_shader;
   Shader m_ui_shader;
   Shader m_grid_shader;
+  Shader m_tile_shader;
 
   GLuint m_stroke_vao;
   GLuint m_preview_vao, m_preview_vbo;
@@ -87,19 +143,87 @@ private:
 
   UIManager m_ui_manager;
 
+  // Declared before the strokes so it outlives their allocations
+  VertexArena m_vertex_arena{sizeof(PointVertex), ARENA_BLOCK_VERTICES};
   Stroke m_current_stroke;
+  StreamingBuffer m_live_buffer{sizeof(PointVertex)};
+  StrokeBatch m_stroke_batch;
   std::vector<Stroke> m_strokes;
-  std::vector<Stroke> m_strokes_revert; // for <C-R>
+  UndoHistory m_strokes_revert; // for <C-R>
+  // Ids of undone strokes finalized after their commit was journaled
+  std::vector<uint64_t> m_finalized_while_undone;
+  // Vector erases interleaved with the commits above, by stack depth
+  std::vector<StrokeEdit> m_edit_undo; // depth: m_strokes.size()
+  std::vector<StrokeEdit> m_edit_redo; // depth: m_strokes_revert.size()
+  SpatialIndex m_stroke_index;           // Bounds of m_strokes, by index
+  std::vector<uint32_t> m_visible_strokes;
+  std::vector<uint32_t> m_pending_geometry; // Visible, not yet built
+  TileCache m_tile_cache{m_strokes, m_stroke_index};
+  StrokeFinalizer m_finalizer;
+  StrokeJournal m_journal{DOCUMENT_PATH}; // Mirrors every edit to disk
+  TaskScheduler m_scheduler;
 
   InputState m_input_state;
   AppState m_app_state;
 
+  // Cursor samples for the live stroke that arrived since the last frame.
+  // Every sample is kept; they are applied as one batch.
+  struct StagedSample {
+    glm::dvec2 position; // Screen pixels
+    double time;         // Seconds, as InputEvent::time
+  };
+  std::vector<StagedSample> m_staged_samples;
+  std::vector<glm::dvec2> m_staged_world; // Scratch for the conversion
+
+  // Predicted tail of the live stroke, drawn after it and rebuilt whenever
+  // real samples arrive. Dropped once it is older than the horizon.
+  StrokePredictor m_predictor;
+  Stroke m_predicted_tail;
+  StreamingBuffer m_tail_buffer{sizeof(PointVertex)};
+  std::vector<glm::dvec2> m_predicted_points; // Screen pixels
+  glm::dvec2 m_last_sample_world = {0.0, 0.0};
+  bool m_stroke_moved = false; // Samples applied since the tail was built
+  bool m_has_tail = false;
+  double m_tail_age = 0.0; // Seconds since the tail's newest real sample
+
+  InputRecorder *m_recorder = nullptr;
+
 public:
-  PaintApp(GLFWwindow *window);
+  // Without a window, input arrives only through handle_input() (replay)
+  PaintApp(GLFWwindow *window, const char *document_path = "canvas.spd");
   ~PaintApp();
 
   void render(double delta_time);
 
+  // Rebuilds the geometry of every stroke across all cores, then re-uploads
+  // them in one batch. For changes that affect the whole document: loading,
+  // smoothing or LOD settings. Undone strokes hold no geometry; they are
+  // rebuilt on redo.
+  void rebuild_all();
+
+  // Edits are journaled as they happen; this folds the journal into a new
+  // snapshot in the background (see StrokeJournal)
+  void save_document();
+
+  // Replaces the canvas with the saved document: the snapshot is mapped,
+  // not read, and the journal replayed on top. Strokes reference their
+  // points in place and build their geometry when they first become visible.
+  void open_document();
+
+  // Routes one window event to its handler. The GLFW callbacks come
+  // through here, so the recorder sees exactly what the app handles.
+  void handle_input(const InputEvent &event);
+
+  // Every event handled from now on is also written to `recorder`; null
+  // stops recording. The recorder must outlive the app or be detached.
+  void set_recorder(InputRecorder *recorder) { m_recorder = recorder; }
+
+  // See AppState::prediction_horizon. Clears the error statistics.
+  void set_prediction_horizon(double seconds);
+
+  // Horizon and error of the predicted tail, in screen pixels
+  void print_prediction_stats() const;
+
   // GLFW adapter handler
   static void glfw_cursor_callback(GLFWwindow *window, double xpos,
                                    double ypos);
@@ -124,7 +248,29 @@ private:
   // Drawing handlers
   void start_drawing();
   void on_drawing(double x, double y);
+
+  // Adds the staged samples to the live stroke. Runs at the start of a
+  // frame and before any event that is not a cursor move, so samples are
+  // applied in the order they arrived.
+  void apply_staged_samples();
+
+  // Rebuilds the predicted tail from the latest samples, or drops it
+  void update_predicted_tail(double delta_time);
   void end_drawing();
+  double simplify_tolerance_for(const Stroke &stroke) const;
+  void collect_finalized_strokes();
+
+  // Cuts the committed strokes under `eraser` and records the result as an
+  // undoable edit. The eraser itself is not kept.
+  void vector_erase(const Stroke &eraser);
+
+  // Applies `edit` (see replace_strokes), leaving its inverse in it, and
+  // journals it. Removed strokes release their geometry.
+  void apply_edit(StrokeEdit &edit, bool clears_redo);
+  void build_visible_geometry();
+
+  // Reports the stroke under the cursor (middle click)
+  void pick_at_cursor();
 
   // Helper method
   void set_color(glm::vec3 color);
@@ -132,9 +278,14 @@ private:
   void update_camera(double delta_time);
   void update_projection();
   static glm::dvec2 screen_to_world(const AppState &state, double x, double yh);
+  // Same, with the inverse projection computed once for many points
+  static glm::dvec2 screen_to_world(const AppState &state,
+                                    const glm::mat4 &inverse_projection,
+                                    double x, double y);
   void draw_dot(GLuint &vao, const glm::vec2 &world_pos, float radius,
                 const glm::vec3 &color, float alpha,
                 int draw_mode = GL_TRIANGLE_FAN) const;
 
   void setup_buffers();
+  void print_render_stats() const;
 };
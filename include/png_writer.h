@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Encodes `width` x `height` RGBA8 pixels (top row first, no padding) as a
+// PNG into `out`. Rows use the Sub filter, which suits the flat areas and
+// soft edges of drawings. Returns false if compression fails.
+bool encode_png(int width, int height, std::span<const uint8_t> rgba,
+                std::vector<uint8_t> &out, int compression_level = 6);
+
+// encode_png() into a file
+bool write_png(const std::string &path, int width, int height,
+               std::span<const uint8_t> rgba, int compression_level = 6);
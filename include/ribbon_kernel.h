@@ -0,0 +1,56 @@
+#pragma once
+
+#include "geometry.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Instruction sets the ribbon kernel can run on. Higher values are faster;
+// detect_simd_level() returns the best one the running CPU supports.
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+SimdLevel detect_simd_level();
+const char *simd_level_name(SimdLevel level);
+
+// Vertices are quantized to snorm16 inside the box origin +/- extent
+struct RibbonParams {
+  glm::dvec2 origin;
+  double extent;
+  double thickness;
+};
+
+// Quantizes one left/right vertex pair into out[0], out[1].
+// `cap` is -1 / 0 / 1 for the start cap, body and end cap.
+void write_ribbon_pair(PointVertex *out, glm::dvec2 left, glm::dvec2 right,
+                       int cap, const RibbonParams &params);
+
+// Generates the mitered vertex pair for every interior point in
+// [begin, end) of `points`, where 1 <= begin and end <= count - 1 so each
+// point has a neighbour on both sides. Caps are left to the caller.
+//
+// lengths[begin - 1] must hold the arc length up to the previous point;
+// lengths[begin..end) is filled with the running arc length. Vertex pairs
+// are written to out[2 * (i - begin)] and `bounds` is grown to cover them.
+void build_ribbon_joins(const glm::dvec2 *points, size_t begin, size_t end,
+                        const RibbonParams &params, double *lengths,
+                        PointVertex *out, AABB &bounds);
+
+// Same as above, forced onto a specific instruction set. Levels the build or
+// the running CPU do not support fall back to the best one that is.
+void build_ribbon_joins(SimdLevel level, const glm::dvec2 *points,
+                        size_t begin, size_t end, const RibbonParams &params,
+                        double *lengths, PointVertex *out, AABB &bounds);
+
+// Squared distance from `point` to the polyline through `count` points (a
+// single point is a dot): the centerline of a ribbon, which is everything
+// within thickness / 2 of it. Once a segment comes within `stop_below`
+// (squared) the scan ends early, returning some distance <= stop_below
+// instead of the minimum.
+double polyline_distance_squared(const glm::dvec2 *points, size_t count,
+                                 glm::dvec2 point, double stop_below = -1.0);
+
+// Same as above, forced onto a specific instruction set (with the same
+// fallback as build_ribbon_joins)
+double polyline_distance_squared(SimdLevel level, const glm::dvec2 *points,
+                                 size_t count, glm::dvec2 point,
+                                 double stop_below = -1.0);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "geometry.h"
+#include "ribbon_kernel.h"
+#include "stroke.h"
+#include "task_scheduler.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Draws committed strokes on the CPU, for machines without any GL stack and
+// for output that is the same on every machine. Follows stroke.frag.glsl:
+// coverage is 1 - smoothstep(r - fwidth(d), r, d) of the distance d to the
+// centerline, so segment ends get round caps, with fwidth taken from the
+// analytic gradient instead of a pixel quad. Pens blend over and erasers
+// cut with the same blend functions as StrokeBatch, in the order given.
+//
+// The image is split into TILE_SIZE square tiles. Each row of tiles is one
+// task: it bins the centerline segments that reach its tiles, then shades
+// every tile in a small premultiplied float buffer, one stroke at a time.
+// Strokes are drawn from their full-resolution centerline, not an LOD.
+//
+// Like CanvasRenderer, images hold premultiplied color over transparent
+// black, top row first.
+class SoftwareRasterizer {
+public:
+  static constexpr int TILE_SIZE = 32;
+
+  // Centerline points per culling box of a prepared stroke
+  static constexpr size_t CHUNK_POINTS = 32;
+
+  // Segment in tile coordinates: a, the direction d and 1 / |d|^2 (0 for a
+  // dot)
+  struct Segment {
+    float ax, ay;
+    float dx, dy;
+    float inv_length2;
+  };
+
+private:
+  struct Chunk {
+    glm::vec2 min; // Grown by the radius
+    glm::vec2 max;
+  };
+
+  // A stroke in image coordinates (one unit per pixel row)
+  struct PreparedStroke {
+    std::vector<glm::vec2> points;
+    std::vector<Chunk> chunks;
+    glm::vec2 min = glm::vec2(0.0f);
+    glm::vec2 max = glm::vec2(0.0f);
+    glm::vec3 color = glm::vec3(0.0f);
+    float radius = 0.0f;
+    bool is_eraser = false;
+  };
+
+  // Segments of one stroke inside one tile
+  struct Run {
+    uint32_t stroke;
+    uint32_t first_segment;
+    uint32_t segment_count;
+    int min_x, min_y, max_x, max_y; // Pixels it may cover, inclusive
+  };
+
+  struct TileBin {
+    std::vector<Segment> segments;
+    std::vector<glm::vec4> extents; // Segment boxes grown by the radius
+    std::vector<Run> runs;
+  };
+
+  TaskScheduler &m_scheduler;
+  SimdLevel m_level;
+  std::vector<PreparedStroke> m_prepared;
+  std::vector<std::vector<TileBin>> m_rows;
+
+  // Image of the current render
+  AABB m_view = {{0.0, 0.0}, {1.0, 1.0}};
+  int m_width = 0;
+  int m_height = 0;
+  float m_pixel_aspect = 1.0f; // Image units per pixel column
+
+public:
+  explicit SoftwareRasterizer(TaskScheduler &scheduler,
+                              SimdLevel level = detect_simd_level());
+
+  // Draws `strokes` in order so that `view` fills a `width` x `height`
+  // image, as RGBA8 or as float. Strokes need no geometry or upload.
+  // Returns false for an empty size.
+  bool render(std::span<const Stroke> strokes, const AABB &view, int width,
+              int height, std::vector<uint8_t> &rgba);
+  bool render(std::span<const Stroke> strokes, const AABB &view, int width,
+              int height, std::vector<glm::vec4> &rgba);
+
+  SimdLevel get_simd_level() const { return m_level; }
+
+private:
+  template <typename Pixel>
+  bool render_into(std::span<const Stroke> strokes, const AABB &view,
+                   int width, int height, std::vector<Pixel> &out);
+
+  void prepare(std::span<const Stroke> strokes);
+  void prepare_stroke(const Stroke &stroke, PreparedStroke &prepared) const;
+
+  // Fills the bins of tile row `row` from every prepared stroke
+  void bin_row(int row);
+
+  // Shades one tile into the SoA buffers r, g, b, a (TILE_SIZE^2 each)
+  void shade_tile(const TileBin &bin, float *tile) const;
+};
+
+// Blends one row of a stroke into the premultiplied SoA tile rows r, g, b, a
+// over pixel columns [begin, end); AVX2 is fastest when both are multiples
+// of 8. Pixel x of this row sits at ((x + 0.5) * aspect, y) in tile
+// coordinates. Every level gives bit-identical results.
+void shade_stroke_span(SimdLevel level,
+                       const SoftwareRasterizer::Segment *segments,
+                       size_t count, float y, int begin, int end,
+                       float aspect, float radius, glm::vec3 color,
+                       bool is_eraser, float *r, float *g, float *b, float *a);
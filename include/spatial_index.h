@@ -0,0 +1,62 @@
+#pragma once
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Hierarchical hashed grid over stroke bounds, for viewport culling.
+//
+// Every entry lives on the finest level whose cells are at least as large
+// as its bounds, so it touches at most 2x2 cells there. Level L has cells
+// BASE_CELL_SIZE * CELL_GROWTH^L wide; the last level takes everything
+// larger. Ids are the strokes' positions in draw order, and query() returns
+// them sorted so callers can keep painter's order (erasers depend on it).
+class SpatialIndex {
+public:
+  static constexpr double BASE_CELL_SIZE = 1.0 / 64.0;
+  static constexpr double CELL_GROWTH = 4.0;
+  static constexpr int LEVEL_COUNT = 12;
+
+private:
+  struct Level {
+    double cell_size;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+    std::vector<uint32_t> members; // For queries that cover most cells
+    size_t cell_entries = 0;        // Ids summed over all cells
+  };
+
+  struct Entry {
+    int level = -1; // -1 when the id is not in the index
+    uint32_t member_index = 0;
+  };
+
+  Level m_levels[LEVEL_COUNT];
+  std::vector<Entry> m_entries;
+  std::vector<AABB> m_bounds; // By id, packed for the fallback scan
+  std::vector<uint32_t> m_visit_stamps; // Dedupes ids spanning cells
+  uint32_t m_stamp = 0;
+  size_t m_size = 0;
+
+public:
+  SpatialIndex();
+
+  void insert(uint32_t id, const AABB &bounds);
+  void remove(uint32_t id);
+  void clear();
+
+  // Appends every id whose bounds intersect `area` to `out`, ascending
+  void query(const AABB &area, std::vector<uint32_t> &out);
+
+  size_t size() const { return m_size; }
+
+private:
+  static AABB empty_bounds();
+  static int level_for(const AABB &bounds);
+  static uint64_t cell_key(int64_t x, int64_t y);
+
+  template <typename Fn>
+  static void for_each_cell(const Level &level, const AABB &bounds, Fn &&fn);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+//
+// Slots are reused in place, so T must be default constructible and move
+// assignable. The head and tail counters sit on separate cache lines so
+// the two threads do not false-share.
+template <typename T> class SpscQueue {
+  static constexpr size_t CACHE_LINE = 64;
+
+  std::vector<T> m_slots;
+  size_t m_mask;
+
+  alignas(CACHE_LINE) std::atomic<size_t> m_head{0}; // Next slot to read
+  alignas(CACHE_LINE) std::atomic<size_t> m_tail{0}; // Next slot to write
+
+public:
+  // `capacity` is rounded up to a power of two
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity)
+      size *= 2;
+    m_slots.resize(size);
+    m_mask = size - 1;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Producer only. Returns false (leaving `value` untouched) when full.
+  bool try_push(T &value) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+      return false;
+
+    m_slots[tail & m_mask] = std::move(value);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false when empty.
+  bool try_pop(T &out) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+      return false;
+
+    out = std::move(m_slots[head & m_mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+};
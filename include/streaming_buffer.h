@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+
+// Persistently mapped vertex buffer for geometry that grows every frame
+// (the stroke being drawn).
+//
+// The buffer is split into REGION_COUNT copies that are used round-robin,
+// each guarded by a fence so the CPU never writes a region the GPU may
+// still be reading. Every region remembers the first element changed since
+// it was last written, so a frame only copies what actually changed
+// instead of the whole stroke. Capacity grows geometrically; after a
+// resize every region is rewritten once.
+class StreamingBuffer {
+public:
+  static constexpr int REGION_COUNT = 3;
+
+private:
+  size_t m_element_size;
+  size_t m_capacity = 0; // Elements per region
+
+  GLuint m_buffer = 0;
+  unsigned char *m_mapped = nullptr;
+
+  GLsync m_fences[REGION_COUNT] = {};
+  size_t m_dirty_from[REGION_COUNT] = {};
+  int m_region = 0;
+  size_t m_count = 0;
+
+public:
+  explicit StreamingBuffer(size_t element_size);
+  ~StreamingBuffer();
+
+  StreamingBuffer(const StreamingBuffer &) = delete;
+  StreamingBuffer &operator=(const StreamingBuffer &) = delete;
+
+  // Marks elements from `first` onward as changed. Elements before it are
+  // assumed identical to what was last passed to update().
+  void invalidate(size_t first);
+
+  // Makes the next region current and brings it up to date with `data`,
+  // copying only elements changed since that region was last written.
+  void update(const void *data, size_t count);
+
+  // Fences the current region. Call after the draw that reads it.
+  void end_frame();
+
+  // Drops the contents, e.g. when a new stroke starts
+  void reset();
+
+  GLuint get_buffer() const { return m_buffer; }
+  GLintptr get_offset() const {
+    return static_cast<GLintptr>(m_region * m_capacity * m_element_size);
+  }
+  size_t get_count() const { return m_count; }
+
+private:
+  void wait_for_region(int region);
+  void reallocate(size_t min_capacity);
+};
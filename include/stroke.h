@@ -2,37 +2,125 @@
 #include "geometry.h"
 #include "glm/fwd.hpp"
 #include "ishape.h"
+#include "packed_points.h"
+#include "streaming_buffer.h"
+#include "stroke_style.h"
+#include "task_scheduler.h"
 #include <glad/gl.h>
 
+#include <memory>
+#include <span>
 #include <vector>
 
+// A decimated copy of the ribbon, stored after the full-resolution one in
+// the same vertex buffer.
+struct LodLevel {
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  double tolerance; // Max centerline error in world units
+};
+
 class Stroke : public IShape {
+public:
+  // Number of Chaikin corner-cutting passes applied to the raw input
+  static constexpr int SMOOTHING_ITERATIONS = 2;
+
+  // Starting half size of the quantization box, in multiples of thickness
+  static constexpr double INITIAL_QUANT_EXTENT = 8.0;
+
+  // LOD chain: level 1 is decimated with thickness * LOD_BASE_TOLERANCE,
+  // and every further step multiplies the tolerance by LOD_TOLERANCE_STEP
+  static constexpr double LOD_BASE_TOLERANCE = 0.125;
+  static constexpr double LOD_TOLERANCE_STEP = 4.0;
+  static constexpr int MAX_LOD_STEPS = 16;
+
+  // select_lod() only picks a decimated level for a stroke at least
+  // LOD_MIN_PIXELS across, and only if its centerline error is at most
+  // LOD_MAX_PIXEL_ERROR pixels. Level 0 is drawn otherwise.
+  static constexpr double LOD_MIN_PIXELS = 4.0;
+  static constexpr double LOD_MAX_PIXEL_ERROR = 0.25;
+
+  // A single-sample stroke is drawn as a zero-length capsule (a round dot)
+  static constexpr size_t DOT_VERTEX_COUNT = 4;
+
+  // Smooth points per task when a long stroke is rebuilt in parallel
+  static constexpr size_t PARALLEL_GRAIN = 4096;
+
+  // Grid steps per thickness that finalized raw points are rounded to; the
+  // same resolution as a vertex in the initial quantization box
+  static constexpr double PACKED_POINT_STEPS = 4096.0;
+
 private:
+  // Raw points live in exactly one of: m_raw_points while drawing,
+  // m_packed_points once finalized, or read in place from elsewhere (a
+  // mapped document) kept alive by m_mapped_source
   std::vector<glm::dvec2> m_raw_points;
+  PackedPoints m_packed_points;
+  std::span<const glm::dvec2> m_mapped_points;
+  std::shared_ptr<const void> m_mapped_source;
+  std::vector<glm::dvec2> m_smooth_points;
+  std::vector<double> m_smooth_lengths; // arc length at each smooth point
   std::vector<PointVertex> m_render_vertices;
-  GLuint m_vbo;
+  std::vector<LodLevel> m_lods; // Coarser levels 1..N; level 0 is implicit
+  VertexArena *m_arena = nullptr;
+  VertexArena::Handle m_allocation = VertexArena::INVALID_HANDLE;
   glm::vec3 m_color;
   double m_cummulative_distance;
   double m_thickness;
   AABB m_bounds;
+  glm::dvec2 m_quant_origin = {0.0, 0.0};
+  double m_quant_extent = 1.0;
+  uint32_t m_style_slot = StrokeStyleTable::INVALID_SLOT;
+  size_t m_dirty_vertex = 0; // First vertex changed since last upload
+  bool m_needs_geometry = false;
   bool m_is_eraser = false;
+  uint64_t m_id = next_id(); // Survives moves, shared by geometry clones
 
 public:
   Stroke();
   Stroke(glm::vec3 color, double thickness, bool is_eraser = false);
   ~Stroke();
 
-  // Disable Copying (prevents double-free of VBO)
+  // Disable Copying (prevents double-free of the arena range)
   Stroke(const Stroke &) = delete;
   Stroke &operator=(const Stroke &) = delete;
 
-  // Enable Moving (transfers ownership of VBO)
+  // Enable Moving (transfers ownership of the arena range)
   Stroke(Stroke &&other) noexcept;
   Stroke &operator=(Stroke &&other) noexcept;
 
-  void upload() override;
+  void upload(VertexArena &arena) override;
   void draw(GLuint &vao, const Shader &shader) const override;
+  void draw(GLuint &vao, const Shader &shader, size_t lod) const;
+
+  // Fills in the indirect draw for `lod` and the arena buffer it reads
+  // from. Returns false if the stroke has nothing uploaded.
+  bool get_draw_command(size_t lod, DrawArraysIndirectCommand &command,
+                        GLuint &buffer) const;
+
+  // Draws the full-resolution ribbon from the current region of `stream`
+  // instead of the stroke's own buffer (used for the live stroke).
+  void draw(GLuint &vao, const Shader &shader,
+            const StreamingBuffer &stream) const;
+
+  // Writes the style record only; upload() also does this.
+  void upload_style();
+
+  // Returns the first vertex changed since the last call (SIZE_MAX if none)
+  size_t take_dirty_vertex();
+
+  // Full rebuild of the smoothed path and ribbon. While drawing,
+  // add_point() keeps both up to date incrementally, so this is only needed
+  // after changing a parameter that affects the whole stroke.
   void update_geometry() override;
+
+  // Same, with the ribbon of a long stroke tessellated in parallel ranges
+  void update_geometry(TaskScheduler &scheduler);
+
+  // Same, with `smoothing_iterations` Chaikin passes instead of
+  // SMOOTHING_ITERATIONS, for measuring their cost. Points added afterwards
+  // are smoothed with SMOOTHING_ITERATIONS again.
+  void update_geometry(int smoothing_iterations);
   const AABB &get_bounds() const { return m_bounds; }
 
   void set_color(glm::vec3 color);
@@ -42,9 +130,129 @@ public:
   bool is_eraser() const { return m_is_eraser; }
   glm::vec3 get_color() const;
   double get_thickness() const;
+  StrokeStyle get_style() const;
+
+  RawPointView get_raw_points() const;
+  const std::vector<glm::dvec2> &get_smooth_points() const;
 
-  const std::vector<glm::dvec2> &get_raw_points() const;
+  // The smoothed centerline: as built, or smoothed from the raw points into
+  // `storage` if the stroke has no geometry
+  std::span<const glm::dvec2>
+  get_centerline(std::vector<glm::dvec2> &storage) const;
+
+  // Exact hit tests against the centerline and thickness
+  bool contains_point(double x, double y) const override;
+
+  // True if `point` lies within `tolerance` of the ribbon
+  bool hits(glm::dvec2 point, double tolerance = 0.0) const;
+
+  // Distance from `point` to the edge of the ribbon; 0 inside it
+  double distance_to(glm::dvec2 point) const;
+  const std::vector<PointVertex> &get_render_vertices() const {
+    return m_render_vertices;
+  }
   void add_point(double x, double y);
+
+  // Same as add_point() for each sample in turn, but re-smooths the tail and
+  // re-tessellates once for the whole run. Geometry matches the per-sample
+  // path, except that the bounds skip tails that were never built.
+  void add_points(std::span<const glm::dvec2> points);
+
+  // Makes `points` the raw samples of this (committed) stroke without
+  // copying them; `source` owns their storage. `bounds` must be the bounds
+  // the stroke was saved with. No geometry is built until update_geometry().
+  void attach_points(std::span<const glm::dvec2> points,
+                     std::shared_ptr<const void> source, const AABB &bounds);
+
+  // Makes `points` the raw samples of this (committed) stroke, e.g. a piece
+  // cut out of another one. Bounds are estimated from the points until
+  // update_geometry() builds the ribbon.
+  void set_raw_points(std::vector<glm::dvec2> points);
+
+  // True for strokes whose geometry has not been built yet (attached) or
+  // was released
+  bool needs_geometry() const { return m_needs_geometry; }
+
+  // Moves the raw points (owned or attached) into packed storage. Returns
+  // false if there was nothing to pack.
+  bool pack_points();
+
+  // Frees everything update_geometry() can rebuild from the raw points:
+  // the arena range, style slot, ribbon, smoothed path and LODs. Packs the
+  // raw points, which are all that is left afterwards.
+  void release_geometry();
+
+  // Approximate bytes held on the CPU, the object itself included
+  size_t get_memory_size() const;
+
+  uint64_t get_id() const { return m_id; }
+
+  // Copies the CPU-side geometry and style parameters, without the GPU
+  // resources, so the copy can be processed on another thread. The copy
+  // keeps this stroke's id.
+  Stroke clone_geometry() const;
+
+  // Replaces this stroke's geometry with `other`'s (a finalized clone).
+  // GPU data is stale afterwards; call upload() again.
+  void adopt_geometry(Stroke &&other);
+
+  // Commit-time processing: simplify the raw samples, rebuild the geometry
+  // if any were dropped, build the LOD chain and pack the raw samples.
+  // Touches no GL or shared state, so it is safe to run on a worker thread
+  // on a clone.
+  void finalize(double simplify_tolerance);
+
+  // Drops raw samples that lie within `tolerance` (world units) of the
+  // simplified path, keeping the rest as the stroke's control points.
+  // Returns true if any point was removed; geometry then needs rebuilding.
+  bool simplify(double tolerance);
+
+  // Builds the LOD chain of a finished stroke. Call before upload().
+  void build_lods();
+
+  // Picks the coarsest LOD whose error is invisible at `pixel_size` world
+  // units per pixel. 0 is full resolution.
+  size_t select_lod(double pixel_size) const;
+  size_t get_lod_count() const { return m_lods.size() + 1; }
+
+  // Vertex range of `lod` in get_render_vertices(); out of range means 0
+  LodLevel get_lod(size_t lod) const;
   void clear();
   bool is_empty() const;
+
+private:
+  // Re-smooths only the tail affected by the last `added` raw points and
+  // splices it onto m_smooth_points. Returns the first smooth index that
+  // changed.
+  size_t update_smooth_tail(size_t added = 1);
+
+  void rebuild(TaskScheduler *scheduler,
+               int smoothing_iterations = SMOOTHING_ITERATIONS);
+
+  // Moves packed or attached raw points into m_raw_points before they are
+  // modified
+  void detach_points();
+
+  // Regenerates arc lengths and ribbon vertices from smooth index `from`.
+  void tessellate_from(size_t from);
+
+  // Full tessellation, split into PARALLEL_GRAIN ranges
+  void tessellate_parallel(TaskScheduler &scheduler);
+
+  // Writes the dot drawn for a stroke with a single raw point
+  void tessellate_dot();
+
+  // Vertices of the full-resolution ribbon (LODs are stored after it)
+  size_t get_base_vertex_count() const;
+
+  static uint64_t next_id();
+
+  // Grows m_quant_extent until it covers m_bounds. Returns true if the
+  // vertices have to be requantized.
+  bool grow_quantization_box();
 };
+
+// Rebuilds the geometry of every stroke on `scheduler`: strokes are spread
+// over all threads and long ones are split further into ranges. CPU only;
+// upload the strokes afterwards on the GL thread.
+void rebuild_strokes(std::span<Stroke> strokes, TaskScheduler &scheduler);
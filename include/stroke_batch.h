@@ -0,0 +1,80 @@
+#pragma once
+
+#include "geometry.h"
+#include "streaming_buffer.h"
+#include "stroke.h"
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <vector>
+
+struct BatchStats {
+  size_t strokes = 0;       // Strokes submitted this frame
+  size_t draw_calls = 0;    // glMultiDrawArraysIndirect calls
+  size_t state_changes = 0; // Blend function and vertex buffer switches
+};
+
+// Collects the visible committed strokes of a frame and draws them with one
+// glMultiDrawArraysIndirect per run.
+//
+// A run is a stretch of consecutive strokes that share a blend mode and an
+// arena block. Strokes are never reordered across runs, so an eraser still
+// only removes what was drawn before it, and state changes scale with the
+// number of pen/eraser transitions instead of the number of strokes.
+//
+// Commands can be split into groups (e.g. one per cache tile) that are
+// uploaded together but drawn separately.
+class StrokeBatch {
+public:
+  enum class BlendMode { Pen, Eraser };
+
+private:
+  struct Run {
+    BlendMode mode;
+    GLuint buffer;
+    uint32_t first_command;
+    uint32_t command_count;
+  };
+
+  std::vector<DrawArraysIndirectCommand> m_commands;
+  std::vector<Run> m_runs;
+  std::vector<uint32_t> m_groups; // First run of each group
+  bool m_group_open = false;      // Next add() must start a new run
+  StreamingBuffer m_indirect{sizeof(DrawArraysIndirectCommand)};
+  BatchStats m_stats;
+
+public:
+  StrokeBatch() = default;
+
+  StrokeBatch(const StrokeBatch &) = delete;
+  StrokeBatch &operator=(const StrokeBatch &) = delete;
+
+  // Drops the commands of the previous frame. Strokes added before the
+  // first begin_group() go to group 0.
+  void begin();
+
+  // Starts a new group; later add() calls go to it. Returns its index.
+  size_t begin_group();
+
+  // Queues `stroke` at level of detail `lod` behind everything added so far
+  void add(const Stroke &stroke, size_t lod);
+
+  // Uploads the queued commands of every group in one copy
+  void upload();
+
+  // Draws the runs of one group. The stroke shader and `vao` must be
+  // bound; the blend function is left at the last run's mode.
+  void draw_group(GLuint vao, size_t group);
+
+  // Fences the uploaded commands. Call after the last draw_group().
+  void end_frame();
+
+  // upload(), every group, end_frame()
+  void submit(GLuint vao);
+
+  size_t get_group_count() const { return m_groups.size(); }
+
+  const BatchStats &get_stats() const { return m_stats; }
+
+  static void apply_blend_mode(BlendMode mode);
+};
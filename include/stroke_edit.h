@@ -0,0 +1,31 @@
+#pragma once
+
+#include "stroke.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Replaces `remove_count` strokes starting at `index` with `strokes`
+struct StrokeReplacement {
+  uint32_t index;
+  uint32_t remove_count;
+  std::vector<Stroke> strokes;
+};
+
+// Applies `replacements` (sorted by index, not overlapping, indices into
+// `strokes` as it is before the call) in one pass over the list.
+// Afterwards every replacement describes its own inverse: its index in the
+// new list, the number of strokes it inserted, and the strokes it removed.
+// Applying the same list again undoes the edit. Returns the first index
+// whose stroke changed.
+size_t replace_strokes(std::vector<Stroke> &strokes,
+                       std::vector<StrokeReplacement> &replacements);
+
+// A reversible edit of the committed strokes (a vector erase). `depth` is
+// the size of the stack the edit was recorded on top of, so undo and redo
+// can tell whether the edit or a plain stroke commit comes next.
+struct StrokeEdit {
+  std::vector<StrokeReplacement> replacements;
+  size_t depth = 0;
+};
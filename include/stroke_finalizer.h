@@ -0,0 +1,55 @@
+#pragma once
+
+#include "spsc_queue.h"
+#include "stroke.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Runs Stroke::finalize() for committed strokes on a background thread.
+//
+// The GL thread submits a geometry clone of each stroke it commits and
+// keeps drawing the original (the live ribbon geometry) in the meantime.
+// Finished clones come back through a lock-free queue; poll() hands them
+// over without ever blocking, so back-to-back strokes only queue up on the
+// worker, never on the UI thread.
+class StrokeFinalizer {
+public:
+  static constexpr size_t COMPLETION_CAPACITY = 256;
+
+private:
+  struct Job {
+    Stroke stroke;
+    double simplify_tolerance;
+  };
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<Job> m_jobs; // Guarded by m_mutex
+  std::atomic<bool> m_stopping = false;
+
+  SpscQueue<Stroke> m_completed{COMPLETION_CAPACITY};
+
+  // Last, so everything it touches exists before it starts
+  std::thread m_worker;
+
+public:
+  StrokeFinalizer();
+  ~StrokeFinalizer(); // Drops pending jobs and joins the worker
+
+  StrokeFinalizer(const StrokeFinalizer &) = delete;
+  StrokeFinalizer &operator=(const StrokeFinalizer &) = delete;
+
+  // Queues `clone` (see Stroke::clone_geometry) for finalization
+  void submit(Stroke &&clone, double simplify_tolerance);
+
+  // GL thread: takes one finished stroke, if any. Its id matches the
+  // stroke it was cloned from.
+  bool poll(Stroke &out) { return m_completed.try_pop(out); }
+
+private:
+  void run();
+};
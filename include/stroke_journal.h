@@ -0,0 +1,157 @@
+#pragma once
+
+#include "stroke.h"
+#include "stroke_edit.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Write-ahead log of canvas edits, kept next to the document snapshot it
+// applies to (`<document>.journal`).
+//
+//   JournalHeader
+//   { JournalRecord, payload (padded to 8 bytes) }...
+//
+// Every commit, undo, redo and stroke edit appends one record, so saving
+// costs time proportional to the edit, not the document. Records are
+// numbered; a snapshot stores the last number it contains and replay skips
+// up to it.
+struct JournalHeader {
+  static constexpr char MAGIC[8] = {'S', 'P', 'J', 'O', 'U', 'R', 'N', 'L'};
+  static constexpr uint32_t VERSION = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+};
+static_assert(sizeof(JournalHeader) == 16);
+
+struct JournalRecord {
+  enum Type : uint32_t {
+    Commit = 1, // Payload: StrokeRecord, then its points
+    Undo = 2,
+    Redo = 3,
+    Replace = 4, // Payload: JournalReplace, then its replacements
+  };
+
+  uint32_t type;
+  uint32_t payload_size; // Unpadded
+  uint64_t sequence;
+  uint32_t checksum; // Of the other fields and the payload
+  uint32_t reserved;
+};
+static_assert(sizeof(JournalRecord) == 24);
+
+// A StrokeEdit applied to the stroke list, stored as its result so replay
+// needs no geometry: each JournalReplacement is followed by the
+// StrokeRecord and points of every stroke it inserts.
+struct JournalReplace {
+  static constexpr uint32_t FLAG_CLEARS_REDO = 1; // A new edit, not undo/redo
+
+  uint32_t flags;
+  uint32_t replacement_count;
+};
+static_assert(sizeof(JournalReplace) == 8);
+
+struct JournalReplacement {
+  uint32_t index;
+  uint32_t remove_count;
+  uint32_t insert_count;
+  uint32_t reserved;
+};
+static_assert(sizeof(JournalReplacement) == 16);
+
+// Appends journal records from the GL thread and writes them on a worker.
+//
+// append_*() only encode the record into a buffer. The worker writes
+// whatever has accumulated with one write() and one fdatasync(), so a burst
+// of edits shares a single sync. Once the journal outgrows
+// COMPACTION_THRESHOLD (or on request) the worker folds it into a new
+// snapshot and truncates it.
+class StrokeJournal {
+public:
+  static constexpr uint64_t COMPACTION_THRESHOLD = 64ull << 20;
+
+private:
+  std::string m_document_path;
+  std::string m_journal_path;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_written;
+  std::vector<unsigned char> m_pending; // Guarded by m_mutex
+  uint64_t m_next_sequence = 1;         // Guarded by m_mutex
+  uint64_t m_written_sequence = 0;      // Guarded by m_mutex
+  bool m_compaction_requested = false;  // Guarded by m_mutex
+  bool m_stopping = false;              // Guarded by m_mutex
+
+  // Worker (or load(), while the worker is idle) only
+  std::mutex m_file_mutex;
+  int m_fd = -1;
+  uint64_t m_journal_size = 0;
+
+  // Last, so everything it touches exists before it starts
+  std::thread m_worker;
+
+public:
+  explicit StrokeJournal(std::string document_path);
+  ~StrokeJournal(); // Writes everything appended so far, then joins
+
+  StrokeJournal(const StrokeJournal &) = delete;
+  StrokeJournal &operator=(const StrokeJournal &) = delete;
+
+  // Recovers the canvas: the snapshot (if any) with the journal replayed on
+  // top, into empty `strokes` and redo stack `reverted`. A torn record left
+  // by a crash ends the replay and is cut off. Must be called before the
+  // first append.
+  void load(std::vector<Stroke> &strokes, std::vector<Stroke> &reverted);
+
+  // The canvas saved at `document_path`, journal included, for readers
+  // such as exporters: nothing is written, and no journal is needed.
+  static void read(const std::string &document_path,
+                   std::vector<Stroke> &strokes,
+                   std::vector<Stroke> &reverted);
+
+  // Mirror the edits PaintApp makes to its stroke lists. A commit also
+  // clears the redo stack.
+  void append_commit(const Stroke &stroke);
+  void append_undo() { append(JournalRecord::Undo, {}); }
+  void append_redo() { append(JournalRecord::Redo, {}); }
+
+  // Records `replacements` before they are applied with replace_strokes()
+  void append_replace(const std::vector<StrokeReplacement> &replacements,
+                      bool clears_redo);
+
+  // Records that the stroke at `index` now has the points `stroke` was
+  // finalized to (simplified and packed). A commit is journaled with the
+  // raw samples, before the finalizer is done with them.
+  void append_finalized(uint32_t index, const Stroke &stroke);
+
+  // Folds the journal into a new snapshot on the worker
+  void request_compaction();
+
+  // Blocks until every appended record is on disk
+  void flush();
+
+private:
+  void append(JournalRecord::Type type, std::span<const unsigned char> payload,
+              std::span<const unsigned char> points = {});
+
+  void run();
+  void write(const std::vector<unsigned char> &data);
+  void compact();
+
+  // Snapshot plus journal, without touching the open journal file. Returns
+  // the last sequence applied; `valid_size` is where the intact records end.
+  static uint64_t read_state(const std::string &document_path,
+                             const std::string &journal_path,
+                             std::vector<Stroke> &strokes,
+                             std::vector<Stroke> &reverted,
+                             uint64_t &valid_size);
+};
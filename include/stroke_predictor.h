@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Extrapolates the stroke being drawn a few milliseconds past its last
+// sample, so a temporary tail can cover the display latency between input
+// and pixels.
+//
+// Each axis is fitted with a least-squares quadratic in time over the last
+// few samples (position, velocity and acceleration), shifted to pass
+// through the newest sample. Samples are in screen pixels, so errors are
+// too: every real sample that lands inside the horizon of the latest
+// prediction is scored against it.
+class StrokePredictor {
+public:
+  // Samples the fit uses at most, and how far back they may reach
+  static constexpr size_t HISTORY_SAMPLES = 8;
+  static constexpr double HISTORY_WINDOW = 0.05; // Seconds
+
+  // Longest horizon predict() accepts; further out is mostly guesswork
+  static constexpr double MAX_HORIZON = 0.05; // Seconds
+
+  // Spacing of the predicted points
+  static constexpr double TAIL_STEP = 0.004; // Seconds
+
+  // Errors kept for get_error_stats()
+  static constexpr size_t ERROR_HISTORY = 1024;
+
+  // Prediction error in screen pixels
+  struct ErrorStats {
+    size_t samples;
+    double mean, p95, max;
+  };
+
+private:
+  struct Sample {
+    glm::dvec2 position;
+    double time;
+  };
+
+  std::array<Sample, HISTORY_SAMPLES> m_history;
+  size_t m_history_next = 0;
+  size_t m_history_size = 0;
+
+  // The latest prediction: origin + c1 * t + c2 * t^2, t after `m_base`
+  bool m_has_prediction = false;
+  double m_base = 0.0;
+  double m_horizon = 0.0;
+  glm::dvec2 m_origin = {0.0, 0.0};
+  glm::dvec2 m_c1 = {0.0, 0.0};
+  glm::dvec2 m_c2 = {0.0, 0.0};
+
+  std::vector<float> m_errors; // Ring of ERROR_HISTORY
+  size_t m_errors_next = 0;
+
+public:
+  // Forgets the samples of the previous stroke; errors are kept
+  void reset();
+
+  // Adds a real sample (time in seconds, non-decreasing) and scores the
+  // latest prediction against it
+  void add_sample(glm::dvec2 position, double time);
+
+  // Appends positions every TAIL_STEP up to `horizon` seconds past the last
+  // sample. Returns false, appending nothing, if the recent samples do not
+  // determine a motion (fewer than two, or all at the same time).
+  bool predict(double horizon, std::vector<glm::dvec2> &points);
+
+  ErrorStats get_error_stats() const;
+  void clear_error_stats();
+
+private:
+  glm::dvec2 evaluate(double t) const;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "geometry.h"
+#include "spatial_index.h"
+#include "stroke.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Selection queries over committed strokes, by index into `strokes` (the
+// list `index` was built from). Candidates come from the spatial index and
+// are pruned by their bounds before the exact test against the ribbon.
+// Eraser strokes are never selected.
+
+// The topmost stroke whose ribbon lies within `tolerance` of `point`.
+// Returns false if there is none, or if an eraser stroke drawn over the
+// point hides everything below it.
+bool pick_stroke(std::span<const Stroke> strokes, SpatialIndex &index,
+                 glm::dvec2 point, double tolerance, uint32_t &picked);
+
+// Appends the strokes whose ribbon touches `area` to `out`, ascending
+void select_in_rect(std::span<const Stroke> strokes, SpatialIndex &index,
+                    const AABB &area, std::vector<uint32_t> &out);
+
+// Appends the strokes whose smoothed centerline points all lie inside the
+// closed polygon `lasso` (even-odd rule) to `out`, ascending
+void select_in_lasso(std::span<const Stroke> strokes, SpatialIndex &index,
+                     std::span<const glm::dvec2> lasso,
+                     std::vector<uint32_t> &out);
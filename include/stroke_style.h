@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-stroke data shared by every vertex of a stroke. Mirrors the std430
+// `StrokeStyle` struct in stroke.vert.glsl, so keep both in sync.
+struct StrokeStyle {
+  glm::vec2 origin;   // Center of the quantization box (world)
+  float extent;       // Half size of the quantization box (world)
+  float thickness;
+  glm::vec3 color;
+  float total_length;
+  uint32_t flags;
+  uint32_t _pad[3];
+
+  static constexpr uint32_t FLAG_ERASER = 1u << 0;
+};
+static_assert(sizeof(StrokeStyle) == 48, "StrokeStyle must match std430");
+
+// Slot allocator for StrokeStyle records, backed by one shader storage
+// buffer. Strokes grab a slot on first upload and pass its index to the
+// shader when drawing.
+class StrokeStyleTable {
+public:
+  static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+  static constexpr GLuint BINDING = 0;
+
+private:
+  std::vector<StrokeStyle> m_styles;
+  std::vector<uint32_t> m_free_slots;
+
+  GLuint m_ssbo = 0;
+  size_t m_gpu_capacity = 0;
+  size_t m_dirty_begin = SIZE_MAX;
+  size_t m_dirty_end = 0;
+
+  StrokeStyleTable() = default;
+
+public:
+  static StrokeStyleTable &instance();
+
+  StrokeStyleTable(const StrokeStyleTable &) = delete;
+  StrokeStyleTable &operator=(const StrokeStyleTable &) = delete;
+
+  uint32_t allocate();
+  void release(uint32_t slot);
+  void set(uint32_t slot, const StrokeStyle &style);
+
+  // Uploads records changed since the last call and binds the buffer to
+  // BINDING. Call once per frame before drawing strokes.
+  void bind();
+
+  // Frees the GL buffer. Must run while the context is still current.
+  void destroy();
+
+  size_t size() const { return m_styles.size() - m_free_slots.size(); }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for CPU-heavy batch jobs (bulk re-tessellation).
+//
+// Every worker owns a deque: it pushes and pops its own tasks at the back
+// (LIFO, cache-warm) while idle workers steal from the front of the others
+// (FIFO, the largest pending chunks). Threads outside the pool submit to a
+// shared queue that everyone steals from. wait() runs tasks instead of
+// blocking, so tasks may spawn and wait on nested work, and the calling
+// thread contributes to the job too.
+class TaskScheduler {
+public:
+  using Task = std::function<void()>;
+
+  // Counts the unfinished tasks spawned into it
+  class TaskGroup {
+    std::atomic<size_t> m_pending{0};
+    friend class TaskScheduler;
+
+  public:
+    bool is_done() const {
+      return m_pending.load(std::memory_order_acquire) == 0;
+    }
+  };
+
+private:
+  struct QueuedTask {
+    Task fn;
+    TaskGroup *group;
+  };
+
+  struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<QueuedTask> tasks;
+  };
+
+  // One per worker, plus the shared queue for outside threads at the end
+  std::vector<std::unique_ptr<WorkQueue>> m_queues;
+  std::vector<std::thread> m_workers;
+
+  std::atomic<size_t> m_queued{0};
+  std::atomic<bool> m_stopping{false};
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_sleep;
+
+public:
+  // Defaults to one worker per hardware thread, minus the caller's. With no
+  // workers every task runs on the thread that calls wait().
+  explicit TaskScheduler(unsigned worker_count = default_worker_count());
+  ~TaskScheduler();
+
+  TaskScheduler(const TaskScheduler &) = delete;
+  TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+  void spawn(TaskGroup &group, Task fn);
+
+  // Runs queued tasks until every task in `group` has finished
+  void wait(TaskGroup &group);
+
+  // Calls fn(first, last) over [begin, end) in chunks of at most `grain`,
+  // split recursively so idle threads steal the biggest halves first.
+  template <typename Fn>
+  void parallel_for(size_t begin, size_t end, size_t grain, Fn &&fn) {
+    if (begin >= end)
+      return;
+
+    TaskGroup group;
+    split(group, begin, end, grain == 0 ? 1 : grain, fn);
+    wait(group);
+  }
+
+  // Threads that execute tasks, including the one calling wait()
+  unsigned get_thread_count() const {
+    return static_cast<unsigned>(m_workers.size()) + 1;
+  }
+
+  static unsigned default_worker_count();
+
+private:
+  template <typename Fn>
+  void split(TaskGroup &group, size_t begin, size_t end, size_t grain,
+             Fn &fn) {
+    while (end - begin > grain) {
+      size_t mid = begin + (end - begin) / 2;
+      spawn(group, [this, &group, mid, end, grain, &fn] {
+        split(group, mid, end, grain, fn);
+      });
+      end = mid;
+    }
+    fn(begin, end);
+  }
+
+  size_t current_queue() const;
+  bool run_one(size_t home);
+  void worker_loop(size_t index);
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "geometry.h"
+#include "shader.h"
+#include "spatial_index.h"
+#include "stroke.h"
+#include "stroke_batch.h"
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Caches committed strokes as world-space raster tiles.
+//
+// Tiles are TILE_PIXELS square and belong to a zoom bucket: bucket L has
+// texels 2^L world units wide, and a frame uses the bucket whose texels are
+// no larger than its pixels (so tiles are at most 2x supersampled). A tile
+// is rasterized once, erasers included, and then drawn as a single textured
+// quad until a stroke committed or undone over it invalidates it.
+//
+// Tiles hold premultiplied color and are composited with
+// GL_ONE, GL_ONE_MINUS_SRC_ALPHA, which matches drawing the strokes
+// directly. The pool is capped by a texture memory budget and recycles the
+// least recently used tile.
+class TileCache {
+public:
+  static constexpr int TILE_PIXELS = 256;
+  static constexpr size_t TILE_BYTES = TILE_PIXELS * TILE_PIXELS * 4;
+  static constexpr size_t DEFAULT_BUDGET = 256u << 20;
+
+private:
+  struct TileKey {
+    int32_t level;
+    int32_t x;
+    int32_t y;
+
+    bool operator==(const TileKey &other) const = default;
+  };
+
+  struct TileKeyHash {
+    size_t operator()(const TileKey &key) const {
+      uint64_t h = static_cast<uint32_t>(key.x) * 0x9E3779B1u;
+      h ^= static_cast<uint64_t>(static_cast<uint32_t>(key.y)) * 0x85EBCA77u;
+      h ^= static_cast<uint64_t>(static_cast<uint32_t>(key.level)) << 48;
+      return static_cast<size_t>(h ^ (h >> 29));
+    }
+  };
+
+  struct Tile {
+    TileKey key;
+    AABB bounds;
+    GLuint texture = 0;
+    GLuint fbo = 0;
+    bool dirty = true;
+  };
+
+  const std::vector<Stroke> &m_strokes;
+  SpatialIndex &m_index;
+  size_t m_capacity; // Tiles that fit in the budget
+
+  // Most recently used first
+  std::list<Tile> m_tiles;
+  std::unordered_map<TileKey, std::list<Tile>::iterator, TileKeyHash> m_lookup;
+
+  StrokeBatch m_batch;
+  std::vector<uint32_t> m_visible;
+  std::vector<Tile *> m_frame_tiles;
+  std::vector<Tile *> m_dirty_tiles;
+  size_t m_rendered_last_frame = 0;
+
+public:
+  TileCache(const std::vector<Stroke> &strokes, SpatialIndex &index,
+            size_t budget_bytes = DEFAULT_BUDGET);
+  ~TileCache();
+
+  TileCache(const TileCache &) = delete;
+  TileCache &operator=(const TileCache &) = delete;
+
+  // Draws the committed strokes covering `view` through the cache,
+  // rasterizing missing or stale tiles first. Returns false, drawing
+  // nothing, if the view needs more tiles than the budget allows.
+  bool draw(const AABB &view, double pixel_size, const glm::mat4 &projection,
+            const Shader &stroke_shader, GLuint stroke_vao,
+            const Shader &tile_shader);
+
+  // Marks every cached tile touching `bounds` for re-rasterization
+  void invalidate(const AABB &bounds);
+  void clear();
+
+  size_t get_tile_count() const { return m_tiles.size(); }
+  size_t get_capacity() const { return m_capacity; }
+  size_t get_rendered_last_frame() const { return m_rendered_last_frame; }
+
+private:
+  Tile &acquire(const TileKey &key, double tile_size);
+  void render_tiles(double texel_size, const Shader &stroke_shader,
+                    GLuint stroke_vao);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "document.h"
+#include "stroke.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+// The redo stack: strokes that were undone, most recent at the top.
+//
+// Pushed strokes release everything that can be rebuilt (see
+// Stroke::release_geometry) and keep only their packed raw points; they
+// come back with needs_geometry() set and are rebuilt once visible. When
+// the resident strokes outgrow the memory budget, the oldest ones are
+// spilled to an anonymous temporary file. Spilled strokes are always the
+// bottom of the stack, so the file grows and shrinks at its end only.
+class UndoHistory {
+public:
+  static constexpr size_t DEFAULT_BUDGET = 64ull << 20;
+
+private:
+  struct SpilledStroke {
+    StrokeRecord record; // first_point is unused
+    uint64_t offset;     // Of the points, in bytes
+  };
+
+  size_t m_budget;
+  size_t m_resident_bytes = 0;
+  std::deque<Stroke> m_resident;        // Top of the stack at the back
+  std::vector<SpilledStroke> m_spilled; // Below m_resident, oldest first
+
+  std::FILE *m_spill_file = nullptr;
+  uint64_t m_spill_size = 0;
+  std::vector<glm::dvec2> m_scratch;
+
+public:
+  explicit UndoHistory(size_t budget = DEFAULT_BUDGET);
+  ~UndoHistory();
+
+  UndoHistory(const UndoHistory &) = delete;
+  UndoHistory &operator=(const UndoHistory &) = delete;
+
+  void push(Stroke &&stroke);
+
+  // Takes the top stroke. Must not be empty.
+  Stroke pop();
+
+  void clear();
+
+  // Finished geometry for the undone stroke it was cloned from (see
+  // StrokeFinalizer). Only the packed points are kept. Returns false if
+  // that stroke is not resident.
+  bool adopt_geometry(Stroke &&finished);
+
+  // Spills right away if the new budget is already exceeded
+  void set_budget(size_t bytes);
+
+  bool empty() const { return m_resident.empty() && m_spilled.empty(); }
+  size_t size() const { return m_resident.size() + m_spilled.size(); }
+  size_t get_budget() const { return m_budget; }
+  size_t get_resident_bytes() const { return m_resident_bytes; }
+  size_t get_spilled_count() const { return m_spilled.size(); }
+  uint64_t get_spilled_bytes() const { return m_spill_size; }
+
+private:
+  void enforce_budget();
+  bool spill_oldest();
+  Stroke unspill_newest();
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "packed_points.h"
+
+#include <glm/glm.hpp>
+
+#include <span>
+#include <vector>
+
+// Cuts the raw centerline `points` of a stroke wherever it passes within
+// `radius` of the polyline `path`, splitting or trimming it at the exact
+// crossing parameters. To erase ink rather than centerline, `radius` is the
+// eraser's radius plus the stroke's. The surviving pieces go to
+// `pieces`; none means the stroke was covered entirely. Returns false if
+// the path does not touch the centerline, leaving `pieces` empty.
+bool erase_along_path(const RawPointView &points,
+                      std::span<const glm::dvec2> path, double radius,
+                      std::vector<std::vector<glm::dvec2>> &pieces);
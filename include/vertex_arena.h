@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+struct ArenaStats {
+  size_t block_count = 0;
+  size_t capacity = 0;      // Elements across all blocks
+  size_t used = 0;          // Elements in live allocations
+  size_t largest_free = 0;  // Largest contiguous free range
+  size_t live_allocations = 0;
+  size_t total_allocations = 0;
+  size_t total_frees = 0;
+  size_t defragmentations = 0;
+  size_t upload_calls = 0; // glNamedBufferSubData calls issued
+
+  // 0 when all free space is one range, approaching 1 when it is shattered
+  double fragmentation() const {
+    size_t free = capacity - used;
+    return free == 0 ? 0.0 : 1.0 - static_cast<double>(largest_free) / free;
+  }
+};
+
+// Sub-allocates vertex ranges for all committed strokes out of a few large
+// immutable-storage buffers, so the renderer binds one buffer per block
+// instead of one per stroke.
+//
+// Allocations are referred to by handle; the arena is free to move the data
+// behind a handle when it compacts a fragmented block, so always look up
+// the current location with get() right before drawing.
+class VertexArena {
+public:
+  using Handle = uint32_t;
+  static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+  struct Location {
+    GLuint buffer;
+    uint32_t offset; // In elements
+    uint32_t count;
+  };
+
+private:
+  struct Block {
+    GLuint buffer = 0;
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+    std::map<uint32_t, uint32_t> free_ranges; // offset -> size
+    bool needs_check = false;
+  };
+
+  struct Allocation {
+    uint32_t block;
+    uint32_t offset;
+    uint32_t count; // 0 for an unused handle
+  };
+
+  struct StagedUpload {
+    Handle handle;
+    uint32_t first;
+    uint32_t count;
+    size_t data; // Byte offset into m_staging
+  };
+
+  size_t m_element_size;
+  uint32_t m_block_elements;
+
+  std::vector<Block> m_blocks;
+  std::vector<Allocation> m_allocations;
+  std::vector<Handle> m_free_handles;
+  ArenaStats m_stats;
+
+  bool m_batching = false;
+  std::vector<StagedUpload> m_staged;
+  std::vector<unsigned char> m_staging;
+  std::vector<unsigned char> m_run; // Contiguous data of one merged upload
+
+public:
+  VertexArena(size_t element_size, uint32_t block_elements);
+  ~VertexArena();
+
+  VertexArena(const VertexArena &) = delete;
+  VertexArena &operator=(const VertexArena &) = delete;
+
+  Handle allocate(uint32_t count);
+  void free(Handle handle);
+  void upload(Handle handle, const void *data, uint32_t count,
+              uint32_t first = 0);
+
+  // Uploads between begin_batch() and end_batch() are staged, then sent
+  // with one call per run of adjacent ranges. Fresh allocations are mostly
+  // adjacent, so re-uploading hundreds of strokes takes a call or two per
+  // block. Upload each range at most once, and do not free or collect()
+  // inside a batch.
+  void begin_batch() { m_batching = true; }
+  void end_batch();
+
+  Location get(Handle handle) const;
+
+  // Binds the block holding `handle` to binding 0 of `vao`. Returns the
+  // first element to draw from.
+  GLint bind(GLuint vao, Handle handle);
+
+  // Compacts at most one fragmented block. Cheap when nothing was freed;
+  // call once per frame.
+  void collect();
+
+  ArenaStats get_stats() const;
+
+private:
+  uint32_t create_block(uint32_t capacity);
+  bool allocate_in(uint32_t block, uint32_t count, uint32_t &offset);
+  void release_range(Block &block, uint32_t offset, uint32_t count);
+  void compact(uint32_t block);
+};
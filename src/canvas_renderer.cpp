@@ -0,0 +1,109 @@
+#include "canvas_renderer.h"
+#include "stroke_style.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstddef>
+
+void setup_stroke(GLuint &stroke_vao) {
+  glCreateVertexArrays(1, &stroke_vao);
+
+  // Attribute 0: Position (2 snorm16, relative to the quantization box)
+  glEnableVertexArrayAttrib(stroke_vao, 0);
+  glVertexArrayAttribFormat(stroke_vao, 0, 2, GL_SHORT, GL_TRUE,
+                            offsetof(PointVertex, position));
+  glVertexArrayAttribBinding(stroke_vao, 0, 0);
+
+  // Attribute 1: Side across the ribbon (1 unorm8)
+  glEnableVertexArrayAttrib(stroke_vao, 1);
+  glVertexArrayAttribFormat(stroke_vao, 1, 1, GL_UNSIGNED_BYTE, GL_TRUE,
+                            offsetof(PointVertex, side));
+  glVertexArrayAttribBinding(stroke_vao, 1, 0);
+
+  // Attribute 2: Cap coordinate along the ribbon (1 snorm8)
+  glEnableVertexArrayAttrib(stroke_vao, 2);
+  glVertexArrayAttribFormat(stroke_vao, 2, 1, GL_BYTE, GL_TRUE,
+                            offsetof(PointVertex, cap));
+  glVertexArrayAttribBinding(stroke_vao, 2, 0);
+}
+
+CanvasRenderer::CanvasRenderer(const char *vertex_path,
+                               const char *fragment_path)
+    : m_stroke_shader(vertex_path, fragment_path) {
+  setup_stroke(m_stroke_vao);
+  glCreateFramebuffers(1, &m_fbo);
+}
+
+CanvasRenderer::~CanvasRenderer() {
+  glDeleteFramebuffers(1, &m_fbo);
+  glDeleteTextures(1, &m_color);
+  glDeleteVertexArrays(1, &m_stroke_vao);
+  glDeleteProgram(m_stroke_shader.ID);
+}
+
+int CanvasRenderer::get_max_size() {
+  GLint texture_size = 0;
+  GLint viewport_size[2] = {0, 0};
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &texture_size);
+  glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewport_size);
+  return glm::min(texture_size, glm::min(viewport_size[0], viewport_size[1]));
+}
+
+void CanvasRenderer::resize(int width, int height) {
+  if (width == m_width && height == m_height)
+    return;
+
+  // Immutable storage: replace the texture instead of resizing it
+  glDeleteTextures(1, &m_color);
+  glCreateTextures(GL_TEXTURE_2D, 1, &m_color);
+  glTextureStorage2D(m_color, 1, GL_RGBA8, width, height);
+  glNamedFramebufferTexture(m_fbo, GL_COLOR_ATTACHMENT0, m_color, 0);
+  m_width = width;
+  m_height = height;
+}
+
+bool CanvasRenderer::render(std::span<const Stroke> strokes, const AABB &view,
+                            int width, int height) {
+  int max_size = get_max_size();
+  if (width <= 0 || height <= 0 || width > max_size || height > max_size)
+    return false;
+  resize(width, height);
+
+  // 1. Commands for every stroke, at the LOD of one image pixel
+  double pixel_size = (view.max.y - view.min.y) / static_cast<double>(height);
+  m_batch.begin();
+  for (const Stroke &stroke : strokes)
+    m_batch.add(stroke, stroke.select_lod(pixel_size));
+
+  // 2. Draw over transparent black. The projection is flipped vertically
+  // so the first row read back is the top of the view.
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  glViewport(0, 0, width, height);
+  const GLfloat transparent[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  glClearNamedFramebufferfv(m_fbo, GL_COLOR, 0, transparent);
+
+  glEnable(GL_BLEND);
+  StrokeStyleTable::instance().bind();
+  m_stroke_shader.use();
+  glBindVertexArray(m_stroke_vao);
+  m_stroke_shader.setMat4(
+      "u_projection",
+      glm::ortho(static_cast<float>(view.min.x),
+                 static_cast<float>(view.max.x),
+                 static_cast<float>(view.max.y),
+                 static_cast<float>(view.min.y), -1.0f, 1.0f));
+  m_batch.submit(m_stroke_vao);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  return true;
+}
+
+void CanvasRenderer::read_pixels(std::vector<uint8_t> &rgba) const {
+  rgba.resize(static_cast<size_t>(m_width) * m_height * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTextureImage(m_color, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                    static_cast<GLsizei>(rgba.size()), rgba.data());
+}
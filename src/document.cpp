@@ -0,0 +1,238 @@
+#include "document.h"
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::endian::native == std::endian::little,
+              "Documents are mapped in place and stored little-endian");
+static_assert(sizeof(glm::dvec2) == 16);
+
+namespace {
+
+uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// fsync() of a file, or of a directory to make a rename in it durable
+bool sync_path(const std::string &path, int flags) {
+  int fd = ::open(path.c_str(), O_RDONLY | flags);
+  if (fd < 0)
+    return false;
+  bool synced = fsync(fd) == 0;
+  close(fd);
+  return synced;
+}
+
+} // namespace
+
+StrokeRecord make_stroke_record(const Stroke &stroke, uint64_t first_point,
+                                uint32_t flags) {
+  glm::vec3 color = stroke.get_color();
+  const AABB &bounds = stroke.get_bounds();
+  if (stroke.is_eraser())
+    flags |= StrokeRecord::FLAG_ERASER;
+
+  return {{color.r, color.g, color.b},
+          flags,
+          stroke.get_thickness(),
+          {bounds.min.x, bounds.min.y, bounds.max.x, bounds.max.y},
+          first_point,
+          stroke.get_raw_points().size()};
+}
+
+Stroke make_stroke(const StrokeRecord &record,
+                   std::span<const glm::dvec2> points,
+                   std::shared_ptr<const void> source) {
+  Stroke stroke({record.color[0], record.color[1], record.color[2]},
+                record.thickness,
+                (record.flags & StrokeRecord::FLAG_ERASER) != 0);
+  AABB bounds = {{record.bounds[0], record.bounds[1]},
+                 {record.bounds[2], record.bounds[3]}};
+  stroke.attach_points(points, std::move(source), bounds);
+  return stroke;
+}
+
+bool save_document(const std::string &path, std::span<const Stroke> strokes,
+                   std::span<const Stroke> reverted,
+                   uint64_t journal_sequence) {
+  // 1. Layout, known up front so everything is written in order
+  size_t stroke_count = strokes.size() + reverted.size();
+  uint64_t point_count = 0;
+  for (std::span<const Stroke> list : {strokes, reverted}) {
+    for (const Stroke &stroke : list)
+      point_count += stroke.get_raw_points().size();
+  }
+
+  DocumentHeader header = {};
+  std::memcpy(header.magic, DocumentHeader::MAGIC, sizeof(header.magic));
+  header.version = DocumentHeader::VERSION;
+  header.header_size = sizeof(DocumentHeader);
+  header.stroke_count = stroke_count;
+  header.stroke_table_offset = sizeof(DocumentHeader);
+  header.point_count = point_count;
+  header.point_offset =
+      align_up(header.stroke_table_offset +
+                   stroke_count * sizeof(StrokeRecord),
+               DocumentHeader::POINT_ALIGNMENT);
+  header.file_size = header.point_offset + point_count * sizeof(glm::dvec2);
+  header.journal_sequence = journal_sequence;
+
+  std::string temp_path = path + ".tmp";
+  std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::cout << "Failed to open " << temp_path << " for writing" << std::endl;
+    return false;
+  }
+
+  // 2. Header and stroke table
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  uint64_t first_point = 0;
+  auto write_records = [&](std::span<const Stroke> list, uint32_t flags) {
+    for (const Stroke &stroke : list) {
+      StrokeRecord record = make_stroke_record(stroke, first_point, flags);
+      file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+      first_point += record.point_count;
+    }
+  };
+  write_records(strokes, 0);
+  write_records(reverted, StrokeRecord::FLAG_REVERTED);
+
+  // 3. Padding, then every stroke's points back to back
+  static const char zeros[DocumentHeader::POINT_ALIGNMENT] = {};
+  uint64_t table_end =
+      header.stroke_table_offset + stroke_count * sizeof(StrokeRecord);
+  file.write(zeros, static_cast<std::streamsize>(header.point_offset -
+                                                 table_end));
+
+  std::vector<glm::dvec2> decoded;
+  for (std::span<const Stroke> list : {strokes, reverted}) {
+    for (const Stroke &stroke : list) {
+      std::span<const glm::dvec2> points =
+          stroke.get_raw_points().contiguous(decoded);
+      file.write(reinterpret_cast<const char *>(points.data()),
+                 static_cast<std::streamsize>(points.size_bytes()));
+    }
+  }
+
+  file.close();
+  if (!file || !sync_path(temp_path, 0)) {
+    std::cout << "Failed to write " << temp_path << std::endl;
+    std::remove(temp_path.c_str());
+    return false;
+  }
+
+  // 4. Swap it in; a mapping of the old file keeps its own inode. The
+  // rename is only durable once the directory is synced too.
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::cout << "Failed to replace " << path << std::endl;
+    std::remove(temp_path.c_str());
+    return false;
+  }
+
+  std::filesystem::path directory =
+      std::filesystem::path(path).parent_path();
+  if (!sync_path(directory.empty() ? "." : directory.string(), O_DIRECTORY)) {
+    std::cout << "Failed to sync the directory of " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+MappedDocument::~MappedDocument() {
+  if (m_data)
+    munmap(const_cast<unsigned char *>(m_data), m_size);
+}
+
+std::shared_ptr<const MappedDocument>
+MappedDocument::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cout << "Failed to open document: " << path << std::endl;
+    return nullptr;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(DocumentHeader)) {
+    std::cout << "Not a document: " << path << std::endl;
+    close(fd);
+    return nullptr;
+  }
+
+  size_t size = static_cast<size_t>(info.st_size);
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping holds its own reference
+  if (data == MAP_FAILED) {
+    std::cout << "Failed to map document: " << path << std::endl;
+    return nullptr;
+  }
+
+  std::shared_ptr<MappedDocument> document(new MappedDocument());
+  document->m_data = static_cast<const unsigned char *>(data);
+  document->m_size = size;
+
+  // Validate the layout; record ranges are checked in load_strokes()
+  const DocumentHeader *header =
+      reinterpret_cast<const DocumentHeader *>(document->m_data);
+  uint64_t table_end = header->stroke_table_offset +
+                       header->stroke_count * sizeof(StrokeRecord);
+  uint64_t points_end =
+      header->point_offset + header->point_count * sizeof(glm::dvec2);
+
+  bool valid =
+      std::memcmp(header->magic, DocumentHeader::MAGIC,
+                  sizeof(header->magic)) == 0 &&
+      header->header_size == sizeof(DocumentHeader) &&
+      header->file_size == size &&
+      header->stroke_table_offset % alignof(StrokeRecord) == 0 &&
+      header->point_offset % DocumentHeader::POINT_ALIGNMENT == 0 &&
+      table_end <= header->point_offset && points_end <= size;
+
+  if (!valid) {
+    std::cout << "Corrupt document: " << path << std::endl;
+    return nullptr;
+  }
+  if (header->version != DocumentHeader::VERSION) {
+    std::cout << "Unsupported document version " << header->version << ": "
+              << path << std::endl;
+    return nullptr;
+  }
+
+  document->m_header = header;
+  document->m_records = reinterpret_cast<const StrokeRecord *>(
+      document->m_data + header->stroke_table_offset);
+  document->m_points = reinterpret_cast<const glm::dvec2 *>(
+      document->m_data + header->point_offset);
+  return document;
+}
+
+void load_strokes(const std::shared_ptr<const MappedDocument> &document,
+                  std::vector<Stroke> &strokes,
+                  std::vector<Stroke> &reverted) {
+  uint64_t point_count = document->get_point_count();
+  strokes.reserve(strokes.size() + document->get_stroke_count());
+
+  for (size_t i = 0; i < document->get_stroke_count(); ++i) {
+    const StrokeRecord &record = document->get_record(i);
+    if (record.first_point > point_count ||
+        record.point_count > point_count - record.first_point) {
+      std::cout << "Skipping stroke " << i << ": points out of range"
+                << std::endl;
+      continue;
+    }
+
+    std::vector<Stroke> &out =
+        (record.flags & StrokeRecord::FLAG_REVERTED) ? reverted : strokes;
+    out.push_back(make_stroke(record, document->get_points(i), document));
+  }
+}
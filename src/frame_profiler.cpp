@@ -0,0 +1,408 @@
+#include "frame_profiler.h"
+
+#if SIMPLE_PAINT_PROFILE
+
+#include "geometry.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+// HUD layout, in pixels
+constexpr float HUD_MARGIN = 10.0f;
+constexpr float HUD_PADDING = 6.0f;
+constexpr float HUD_WIDTH = 2.0f * HUD_PADDING + FrameProfiler::HISTORY_FRAMES;
+constexpr float HUD_GRAPH_HEIGHT = 60.0f;
+constexpr float HUD_BAR_HEIGHT = 5.0f;
+constexpr float HUD_ROW_GAP = 3.0f;
+
+// The graph tops out at two 60 Hz frames; zone bars at one
+constexpr double FRAME_BUDGET_MS = 1000.0 / 60.0;
+constexpr double GRAPH_SCALE_MS = 2.0 * FRAME_BUDGET_MS;
+
+struct PaletteColor {
+  const char *name;
+  glm::vec3 color;
+};
+
+constexpr PaletteColor PALETTE[] = {
+    {"blue", {0.30f, 0.60f, 1.00f}},   {"orange", {1.00f, 0.60f, 0.20f}},
+    {"green", {0.40f, 0.85f, 0.40f}},  {"magenta", {0.90f, 0.40f, 0.90f}},
+    {"yellow", {0.95f, 0.90f, 0.30f}}, {"cyan", {0.30f, 0.90f, 0.90f}},
+    {"red", {1.00f, 0.35f, 0.35f}},    {"white", {0.90f, 0.90f, 0.90f}},
+};
+constexpr size_t PALETTE_SIZE = sizeof(PALETTE) / sizeof(PALETTE[0]);
+
+struct Summary {
+  double mean = 0.0, p95 = 0.0, max = 0.0;
+};
+
+// Negative samples (frames without GPU times) are skipped
+Summary summarize(const float *values, size_t count) {
+  static thread_local std::vector<float> sorted;
+  sorted.clear();
+  for (size_t i = 0; i < count; ++i) {
+    if (values[i] >= 0.0f)
+      sorted.push_back(values[i]);
+  }
+  if (sorted.empty())
+    return {};
+
+  std::sort(sorted.begin(), sorted.end());
+  Summary summary;
+  for (float value : sorted)
+    summary.mean += value;
+  summary.mean /= static_cast<double>(sorted.size());
+  summary.p95 = sorted[(sorted.size() - 1) * 95 / 100];
+  summary.max = sorted.back();
+  return summary;
+}
+
+double to_ms(int64_t nanoseconds) {
+  return static_cast<double>(nanoseconds) * 1e-6;
+}
+
+void write_json_string(std::ostream &out, const char *text) {
+  out << '"';
+  for (const char *c = text; *c; ++c) {
+    if (*c == '"' || *c == '\\')
+      out << '\\' << *c;
+    else if (static_cast<unsigned char>(*c) < 0x20)
+      out << ' ';
+    else
+      out << *c;
+  }
+  out << '"';
+}
+
+// One complete ("X") event; times in nanoseconds, written in microseconds
+void write_event(std::ostream &out, const char *name, const char *category,
+                 int tid, int64_t begin, int64_t end) {
+  out << ",\n{\"name\":";
+  write_json_string(out, name);
+  out << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+      << tid << ",\"ts\":" << static_cast<double>(begin) * 1e-3
+      << ",\"dur\":" << static_cast<double>(end - begin) * 1e-3 << '}';
+}
+
+void draw_rect(const Shader &shader, float x, float y, float w, float h,
+               const glm::vec3 &color, float alpha) {
+  glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+  model = glm::scale(model, glm::vec3(w, h, 1.0f));
+  shader.setMat4("u_model", model);
+  shader.setVec3("u_color", color);
+  shader.setFloat("u_alpha", alpha);
+  draw_quad();
+}
+
+} // namespace
+
+FrameProfiler::FrameProfiler() : m_start(std::chrono::steady_clock::now()) {
+  m_trace.reserve(TRACE_FRAMES);
+}
+
+FrameProfiler &FrameProfiler::instance() {
+  static FrameProfiler profiler;
+  return profiler;
+}
+
+void FrameProfiler::destroy() {
+  for (PendingFrame &frame : m_pending) {
+    if (!frame.queries.empty()) {
+      glDeleteQueries(static_cast<GLsizei>(frame.queries.size()),
+                      frame.queries.data());
+    }
+    frame.queries.clear();
+    frame.zones.clear();
+  }
+  m_gpu_calibrated = false;
+}
+
+int64_t FrameProfiler::now() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - m_start)
+      .count();
+}
+
+uint32_t FrameProfiler::begin_zone(const char *name) {
+  PendingFrame &frame = m_pending[m_current];
+  auto record = static_cast<uint32_t>(frame.zones.size());
+  size_t query = 2 * static_cast<size_t>(record);
+
+  // Pools only grow; a frame with more zones than before adds queries
+  if (frame.queries.size() < query + 2) {
+    size_t old_size = frame.queries.size();
+    frame.queries.resize(std::max<size_t>(16, 2 * old_size));
+    glCreateQueries(GL_TIMESTAMP,
+                    static_cast<GLsizei>(frame.queries.size() - old_size),
+                    frame.queries.data() + old_size);
+  }
+
+  frame.zones.push_back(
+      {name, static_cast<uint32_t>(m_open.size()), now(), -1});
+  m_open.push_back(record);
+  glQueryCounter(frame.queries[query], GL_TIMESTAMP);
+  return record;
+}
+
+void FrameProfiler::end_zone(uint32_t record) {
+  PendingFrame &frame = m_pending[m_current];
+  glQueryCounter(frame.queries[2 * static_cast<size_t>(record) + 1],
+                 GL_TIMESTAMP);
+  frame.zones[record].cpu_end = now();
+  m_open.pop_back();
+}
+
+void FrameProfiler::end_frame() {
+  // 1. Close the frame; the next one starts now
+  int64_t time = now();
+  PendingFrame &frame = m_pending[m_current];
+  frame.number = m_frame_number++;
+  frame.begin = m_frame_begin;
+  frame.end = time;
+  m_frame_begin = time;
+
+  if (!m_gpu_calibrated || m_frame_number % HISTORY_FRAMES == 0)
+    calibrate_gpu_clock();
+
+  // 2. The next slot holds the oldest frame; its queries have had
+  // FRAME_LATENCY - 1 frames to finish
+  m_current = (m_current + 1) % FRAME_LATENCY;
+  PendingFrame &oldest = m_pending[m_current];
+  if (oldest.end != 0)
+    resolve(oldest);
+  oldest.zones.clear();
+  oldest.end = 0;
+}
+
+void FrameProfiler::calibrate_gpu_clock() {
+  GLint64 gpu_time = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+  m_gpu_offset = static_cast<int64_t>(gpu_time) - now();
+  m_gpu_calibrated = true;
+}
+
+void FrameProfiler::resolve(PendingFrame &frame) {
+  ResolvedFrame resolved;
+  resolved.number = frame.number;
+  resolved.begin = frame.begin;
+  resolved.end = frame.end;
+  resolved.zones = frame.zones;
+
+  // Timestamps complete in order, so the last one being available means
+  // all are. If not, the GPU is far behind; waiting would only add to that.
+  GLint available = GL_FALSE;
+  if (!frame.zones.empty()) {
+    glGetQueryObjectiv(frame.queries[2 * frame.zones.size() - 1],
+                       GL_QUERY_RESULT_AVAILABLE, &available);
+  }
+  if (available == GL_TRUE) {
+    for (size_t i = 0; i < resolved.zones.size(); ++i) {
+      GLuint64 begin = 0, end = 0;
+      glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+      resolved.zones[i].gpu_begin = static_cast<int64_t>(begin) - m_gpu_offset;
+      resolved.zones[i].gpu_end = static_cast<int64_t>(end) - m_gpu_offset;
+    }
+  }
+
+  record_history(resolved);
+
+  if (m_trace.size() < TRACE_FRAMES) {
+    m_trace.push_back(std::move(resolved));
+  } else {
+    m_trace[m_trace_next] = std::move(resolved);
+    m_trace_next = (m_trace_next + 1) % TRACE_FRAMES;
+  }
+}
+
+size_t FrameProfiler::series_for(const char *name, uint32_t depth) {
+  for (size_t i = 0; i < m_series.size(); ++i) {
+    if (m_series[i].depth == depth && std::strcmp(m_series[i].name, name) == 0)
+      return i;
+  }
+  m_series.push_back({name, depth});
+  return m_series.size() - 1;
+}
+
+void FrameProfiler::record_history(const ResolvedFrame &frame) {
+  size_t slot = m_history_next;
+  m_frame_ms[slot] = static_cast<float>(to_ms(frame.end - frame.begin));
+  for (Series &series : m_series) {
+    series.cpu[slot] = 0.0f;
+    series.gpu[slot] = 0.0f;
+  }
+
+  bool has_gpu = !frame.zones.empty() && frame.zones.front().gpu_begin >= 0;
+  for (const ZoneRecord &zone : frame.zones) {
+    Series &series = m_series[series_for(zone.name, zone.depth)];
+    series.cpu[slot] +=
+        static_cast<float>(to_ms(zone.cpu_end - zone.cpu_begin));
+    if (has_gpu) {
+      series.gpu[slot] +=
+          static_cast<float>(to_ms(zone.gpu_end - zone.gpu_begin));
+    }
+  }
+  if (!has_gpu) {
+    for (Series &series : m_series)
+      series.gpu[slot] = -1.0f;
+  }
+
+  m_history_next = (m_history_next + 1) % HISTORY_FRAMES;
+  m_history_size = std::min(m_history_size + 1, HISTORY_FRAMES);
+}
+
+std::vector<FrameProfiler::ZoneStats> FrameProfiler::get_stats() const {
+  std::vector<ZoneStats> stats;
+  stats.reserve(m_series.size());
+  for (const Series &series : m_series) {
+    Summary cpu = summarize(series.cpu.data(), m_history_size);
+    Summary gpu = summarize(series.gpu.data(), m_history_size);
+    stats.push_back({series.name, series.depth, cpu.mean, cpu.p95, cpu.max,
+                     gpu.mean, gpu.p95, gpu.max});
+  }
+  return stats;
+}
+
+double FrameProfiler::get_frame_mean_ms() const {
+  return summarize(m_frame_ms.data(), m_history_size).mean;
+}
+
+double FrameProfiler::get_frame_max_ms() const {
+  return summarize(m_frame_ms.data(), m_history_size).max;
+}
+
+void FrameProfiler::print_stats() const {
+  std::vector<ZoneStats> stats = get_stats();
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::cout << std::fixed << std::setprecision(3)
+            << "frame: mean " << get_frame_mean_ms() << " ms, max "
+            << get_frame_max_ms() << " ms over " << m_history_size
+            << " frames\n"
+            << "zone               cpu mean/p95/max (ms)    "
+               "gpu mean/p95/max (ms)    color\n";
+  for (size_t i = 0; i < stats.size(); ++i) {
+    const ZoneStats &zone = stats[i];
+    std::string label = std::string(2 * zone.depth, ' ') + zone.name;
+    label.resize(std::max<size_t>(label.size(), 18), ' ');
+    std::cout << label << ' ' << zone.cpu_mean << ' ' << zone.cpu_p95 << ' '
+              << zone.cpu_max << "    " << zone.gpu_mean << ' ' << zone.gpu_p95
+              << ' ' << zone.gpu_max << "    "
+              << PALETTE[i % PALETTE_SIZE].name << '\n';
+  }
+  std::cout.flags(flags);
+  std::cout << std::flush;
+}
+
+void FrameProfiler::draw_hud(const Shader &ui_shader, int window_width,
+                             int window_height) const {
+  std::vector<ZoneStats> stats = get_stats();
+  float zone_rows =
+      static_cast<float>(stats.size()) * (2.0f * HUD_BAR_HEIGHT + HUD_ROW_GAP);
+  float height = 3.0f * HUD_PADDING + HUD_GRAPH_HEIGHT + zone_rows;
+  float left = HUD_MARGIN;
+  float top = static_cast<float>(window_height) - HUD_MARGIN - height;
+
+  // 1. Screen-space projection, as UIManager uses: (0,0) at top-left
+  ui_shader.use();
+  ui_shader.setMat4("u_projection",
+                    glm::ortho(0.0f, static_cast<float>(window_width),
+                               static_cast<float>(window_height), 0.0f));
+  ui_shader.setBool("u_hasTexture", false);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  draw_rect(ui_shader, left, top, HUD_WIDTH, height, {0.0f, 0.0f, 0.0f},
+            0.6f);
+
+  // 2. Frame time graph, oldest frame on the left
+  float graph_left = left + HUD_PADDING;
+  float graph_bottom = top + HUD_PADDING + HUD_GRAPH_HEIGHT;
+  float px_per_ms = HUD_GRAPH_HEIGHT / static_cast<float>(GRAPH_SCALE_MS);
+  size_t first = (m_history_next + HISTORY_FRAMES - m_history_size) %
+                 HISTORY_FRAMES;
+  for (size_t i = 0; i < m_history_size; ++i) {
+    float ms = m_frame_ms[(first + i) % HISTORY_FRAMES];
+    float bar = std::min(ms * px_per_ms, HUD_GRAPH_HEIGHT);
+    glm::vec3 color = ms > FRAME_BUDGET_MS ? glm::vec3(1.0f, 0.3f, 0.3f)
+                                           : glm::vec3(0.4f, 0.85f, 0.4f);
+    draw_rect(ui_shader, graph_left + static_cast<float>(i),
+              graph_bottom - bar, 1.0f, bar, color, 0.9f);
+  }
+  float budget_y =
+      graph_bottom - static_cast<float>(FRAME_BUDGET_MS) * px_per_ms;
+  draw_rect(ui_shader, graph_left, budget_y, FrameProfiler::HISTORY_FRAMES,
+            1.0f, {1.0f, 1.0f, 1.0f}, 0.8f);
+
+  // 3. Zone bars: CPU mean, then GPU mean below it, one frame budget wide
+  float bar_px_per_ms = static_cast<float>(HISTORY_FRAMES / FRAME_BUDGET_MS);
+  float y = graph_bottom + HUD_PADDING;
+  for (size_t i = 0; i < stats.size(); ++i) {
+    const glm::vec3 &color = PALETTE[i % PALETTE_SIZE].color;
+    float indent = 4.0f * static_cast<float>(stats[i].depth);
+    float available = HISTORY_FRAMES - indent;
+    float cpu = std::min(static_cast<float>(stats[i].cpu_mean) * bar_px_per_ms,
+                         available);
+    float gpu = std::min(static_cast<float>(stats[i].gpu_mean) * bar_px_per_ms,
+                         available);
+    draw_rect(ui_shader, graph_left + indent, y, cpu, HUD_BAR_HEIGHT, color,
+              0.9f);
+    draw_rect(ui_shader, graph_left + indent, y + HUD_BAR_HEIGHT, gpu,
+              HUD_BAR_HEIGHT, color, 0.5f);
+    y += 2.0f * HUD_BAR_HEIGHT + HUD_ROW_GAP;
+  }
+
+  // Leave alpha as UIManager expects it
+  ui_shader.setFloat("u_alpha", 1.0f);
+}
+
+bool FrameProfiler::write_trace(const std::string &path) const {
+  std::ofstream out(path);
+  if (!out) {
+    std::cout << "ERROR::PROFILER::CANNOT_OPEN: " << path << std::endl;
+    return false;
+  }
+
+  // 1. Track names
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n"
+      << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+         "\"args\":{\"name\":\"Simple Paint\"}},\n"
+      << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+         "\"args\":{\"name\":\"CPU\"}},\n"
+      << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+         "\"args\":{\"name\":\"GPU\"}}";
+
+  // 2. Frames oldest first; the ring starts at m_trace_next once full
+  size_t count = m_trace.size();
+  size_t first = count < TRACE_FRAMES ? 0 : m_trace_next;
+  char frame_name[32];
+  for (size_t i = 0; i < count; ++i) {
+    const ResolvedFrame &frame = m_trace[(first + i) % count];
+    std::snprintf(frame_name, sizeof(frame_name), "frame %llu",
+                  static_cast<unsigned long long>(frame.number));
+    write_event(out, frame_name, "frame", 1, frame.begin, frame.end);
+    for (const ZoneRecord &zone : frame.zones) {
+      write_event(out, zone.name, "cpu", 1, zone.cpu_begin, zone.cpu_end);
+      if (zone.gpu_begin >= 0)
+        write_event(out, zone.name, "gpu", 2, zone.gpu_begin, zone.gpu_end);
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  out.close();
+  if (!out) {
+    std::cout << "ERROR::PROFILER::WRITE_FAILED: " << path << std::endl;
+    return false;
+  }
+  std::cout << "trace: " << count << " frames written to " << path
+            << std::endl;
+  return true;
+}
+
+#endif // SIMPLE_PAINT_PROFILE
@@ -1,6 +1,10 @@
 #include "geometry.h"
 
 #include "glad/gl.h"
+#include <glm/glm.hpp>
+
+#include <utility>
+#include <vector>
 
 void draw_quad() {
   static GLuint quadVAO = 0;
@@ -35,3 +39,60 @@ void draw_quad() {
   glBindVertexArray(quadVAO);
   glDrawArrays(GL_TRIANGLES, 0, 6);
 }
+
+namespace {
+
+double distance_to_segment(glm::dvec2 p, glm::dvec2 a, glm::dvec2 b) {
+  glm::dvec2 ab = b - a;
+  double len2 = glm::dot(ab, ab);
+  if (len2 == 0.0)
+    return glm::distance(p, a);
+
+  double t = glm::clamp(glm::dot(p - a, ab) / len2, 0.0, 1.0);
+  return glm::distance(p, a + ab * t);
+}
+
+} // namespace
+
+void simplify_polyline(const glm::dvec2 *points, size_t count,
+                       double tolerance, std::vector<glm::dvec2> &out) {
+  out.clear();
+  if (count < 3 || tolerance <= 0.0) {
+    out.assign(points, points + count);
+    return;
+  }
+
+  // Explicit stack instead of recursion: strokes can hold tens of
+  // thousands of samples
+  std::vector<bool> keep(count, false);
+  std::vector<std::pair<size_t, size_t>> ranges;
+  keep.front() = keep.back() = true;
+  ranges.push_back({0, count - 1});
+
+  while (!ranges.empty()) {
+    auto [first, last] = ranges.back();
+    ranges.pop_back();
+
+    double max_dist = 0.0;
+    size_t max_index = first;
+    for (size_t i = first + 1; i < last; ++i) {
+      double dist =
+          distance_to_segment(points[i], points[first], points[last]);
+      if (dist > max_dist) {
+        max_dist = dist;
+        max_index = i;
+      }
+    }
+
+    if (max_dist > tolerance) {
+      keep[max_index] = true;
+      ranges.push_back({first, max_index});
+      ranges.push_back({max_index, last});
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    if (keep[i])
+      out.push_back(points[i]);
+  }
+}
@@ -0,0 +1,111 @@
+#include "input_log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+bool InputRecorder::open(const std::string &path, int width, int height,
+                         double time) {
+  close();
+
+  m_file.open(path, std::ios::binary | std::ios::trunc);
+  if (!m_file) {
+    std::cout << "ERROR::INPUT_LOG::CANNOT_CREATE: " << path << std::endl;
+    return false;
+  }
+
+  InputLogHeader header = {};
+  std::memcpy(header.magic, InputLogHeader::MAGIC, sizeof(header.magic));
+  header.version = InputLogHeader::VERSION;
+  header.header_size = sizeof(InputLogHeader);
+  header.width = width;
+  header.height = height;
+  m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  m_path = path;
+  m_start = time;
+  m_last = time;
+  m_count = 0;
+  return true;
+}
+
+void InputRecorder::record(const InputEvent &event) {
+  if (!m_file.is_open())
+    return;
+
+  // Deltas are rounded against the absolute time, so rounding errors do not
+  // add up over a long session
+  double elapsed_us = std::round((event.time - m_start) * 1e6);
+  double last_us = std::round((m_last - m_start) * 1e6);
+  double delta_us = std::clamp(elapsed_us - last_us, 0.0, 4294967295.0);
+  m_last = event.time;
+
+  InputRecord record = {};
+  record.delta_us = static_cast<uint32_t>(delta_us);
+  record.type = static_cast<uint8_t>(event.type);
+  record.action = static_cast<uint8_t>(event.action);
+  record.mods = static_cast<uint8_t>(event.mods);
+  record.code = event.code;
+  record.x = static_cast<float>(event.value.x);
+  record.y = static_cast<float>(event.value.y);
+  m_file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+  m_count++;
+}
+
+void InputRecorder::close() {
+  if (!m_file.is_open())
+    return;
+
+  m_file.close();
+  if (!m_file)
+    std::cout << "ERROR::INPUT_LOG::WRITE_FAILED: " << m_path << std::endl;
+  else
+    std::cout << "recorded " << m_count << " input events to " << m_path
+              << std::endl;
+}
+
+bool InputLog::read(const std::string &path, InputLog &log) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cout << "ERROR::INPUT_LOG::CANNOT_OPEN: " << path << std::endl;
+    return false;
+  }
+
+  // 1. Header; later versions may grow it
+  InputLogHeader header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, InputLogHeader::MAGIC, sizeof(header.magic)) !=
+          0 ||
+      header.header_size < sizeof(InputLogHeader)) {
+    std::cout << "ERROR::INPUT_LOG::NOT_A_LOG: " << path << std::endl;
+    return false;
+  }
+  if (header.version != InputLogHeader::VERSION) {
+    std::cout << "ERROR::INPUT_LOG::UNSUPPORTED_VERSION: " << header.version
+              << std::endl;
+    return false;
+  }
+  file.seekg(header.header_size);
+
+  log.width = header.width;
+  log.height = header.height;
+  log.events.clear();
+
+  // 2. Records, with times accumulated from their deltas
+  InputRecord record;
+  uint64_t time_us = 0;
+  while (file.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+    time_us += record.delta_us;
+
+    InputEvent event;
+    event.type = static_cast<InputEvent::Type>(record.type);
+    event.time = static_cast<double>(time_us) * 1e-6;
+    event.code = record.code;
+    event.action = record.action;
+    event.mods = record.mods;
+    event.value = {record.x, record.y};
+    log.events.push_back(event);
+  }
+  return true;
+}
@@ -1,5 +1,8 @@
+#include "frame_profiler.h"
+#include "input_log.h"
 #include "paint.h"
 #include <cstddef>
+#include <cstring>
 #define _USE_MATH_DEFINES
 #include <stdbool.h>
 #include <stddef.h>
@@ -28,16 +31,27 @@ GLFWwindow *initialize_window(int width, int height, const char *title) {
   if (!glfwInit())
     exit(EXIT_FAILURE);
 
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  // The stroke shader reads gl_BaseInstance (GLSL 4.60) and the renderer
+  // uses direct state access and persistent mapping
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
+  // macOS stops at OpenGL 4.1, so window creation below fails there
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
   GLFWwindow *window = glfwCreateWindow(width, height, title, NULL, NULL);
   if (!window) {
-    fprintf(stderr, "Failed to create GLFW window\n");
+    const char *description = NULL;
+    glfwGetError(&description);
+    fprintf(stderr,
+            "Failed to create GLFW window: simple-paint needs an OpenGL 4.6 "
+            "core context (%s)\n",
+            description ? description : "unknown error");
+#ifdef __APPLE__
+    fprintf(stderr, "macOS supports OpenGL up to 4.1 only\n");
+#endif
     glfwTerminate();
     exit(EXIT_FAILURE);
   }
@@ -52,13 +66,36 @@ GLFWwindow *initialize_window(int width, int height, const char *title) {
 
 //_________________________________________________MAIN______________________________________________________________//
 
-int main() {
+// simple-paint [--record <input log>]
+//
+// --record writes every window event to a log that simple-paint-replay
+// plays back with the same timing
+int main(int argc, char **argv) {
+  const char *record_path = NULL;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else {
+      fprintf(stderr, "usage: simple-paint [--record <input log>]\n");
+      return EXIT_FAILURE;
+    }
+  }
+
   GLFWwindow *window = initialize_window(800, 600, "Simple Paint");
 
   // Forcing paint app destructor with scope
   {
+    // Outlives the app, which holds on to it
+    InputRecorder recorder;
     PaintApp app(window);
 
+    if (record_path) {
+      int width, height;
+      glfwGetWindowSize(window, &width, &height);
+      if (recorder.open(record_path, width, height, glfwGetTime()))
+        app.set_recorder(&recorder);
+    }
+
     double prev_time = glfwGetTime();
 
     while (!glfwWindowShouldClose(window)) {
@@ -68,13 +105,22 @@ int main() {
 
       process_input(window);
 
-      glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-      app.render(delta_time);
-
-      glfwSwapBuffers(window);
-      glfwPollEvents();
+      {
+        PROFILE_ZONE("render");
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        app.render(delta_time);
+      }
+      {
+        PROFILE_ZONE("present");
+        glfwSwapBuffers(window);
+      }
+      {
+        PROFILE_ZONE("events");
+        glfwPollEvents();
+      }
+      PROFILE_FRAME();
     }
   }
 
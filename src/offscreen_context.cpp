@@ -0,0 +1,131 @@
+#include "offscreen_context.h"
+
+#include <glad/gl.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+bool has_extension(const char *extensions, const char *name) {
+  if (!extensions)
+    return false;
+
+  size_t length = std::strlen(name);
+  for (const char *p = std::strstr(extensions, name); p;
+       p = std::strstr(p + length, name)) {
+    bool starts = p == extensions || p[-1] == ' ';
+    bool ends = p[length] == ' ' || p[length] == '\0';
+    if (starts && ends)
+      return true;
+  }
+  return false;
+}
+
+EGLDisplay open_display() {
+  // Mesa's surfaceless platform needs neither a GPU nor a display server
+  const char *client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  auto get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display &&
+      has_extension(client, "EGL_MESA_platform_surfaceless")) {
+    EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                              EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY)
+      return display;
+  }
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+} // namespace
+
+std::unique_ptr<OffscreenContext> OffscreenContext::create() {
+  std::unique_ptr<OffscreenContext> context(new OffscreenContext());
+
+  // 1. Display
+  EGLDisplay display = open_display();
+  EGLint major, minor;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+    std::cout << "Failed to initialize an EGL display" << std::endl;
+    return nullptr;
+  }
+  context->m_display = display;
+
+  const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+  if (!has_extension(extensions, "EGL_KHR_surfaceless_context")) {
+    std::cout << "EGL display does not support surfaceless contexts"
+              << std::endl;
+    return nullptr;
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::cout << "EGL display does not support desktop OpenGL" << std::endl;
+    return nullptr;
+  }
+
+  // 2. Any OpenGL config will do, since nothing is drawn to a surface
+  EGLConfig config = nullptr;
+  const EGLint config_attributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                      EGL_NONE};
+  EGLint config_count = 0;
+  if (!eglChooseConfig(display, config_attributes, &config, 1,
+                       &config_count) ||
+      config_count == 0) {
+    if (!has_extension(extensions, "EGL_KHR_no_config_context")) {
+      std::cout << "No EGL config for OpenGL" << std::endl;
+      return nullptr;
+    }
+    config = EGL_NO_CONFIG_KHR;
+  }
+
+  // 3. The same context the window gets: 4.6 core
+  const EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                       4,
+                                       EGL_CONTEXT_MINOR_VERSION,
+                                       6,
+                                       EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                       EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                       EGL_NONE};
+  EGLContext egl_context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+  if (egl_context == EGL_NO_CONTEXT) {
+    std::cout << "Failed to create an OpenGL 4.6 core context (EGL error 0x"
+              << std::hex << eglGetError() << std::dec << ")" << std::endl;
+    return nullptr;
+  }
+  context->m_context = egl_context;
+
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+    std::cout << "Failed to make the offscreen context current" << std::endl;
+    return nullptr;
+  }
+
+  // 4. GL entry points come from EGL instead of the window system
+  if (!gladLoadGL(reinterpret_cast<GLADloadfunc>(eglGetProcAddress))) {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return nullptr;
+  }
+  return context;
+}
+
+OffscreenContext::~OffscreenContext() {
+  if (!m_display)
+    return;
+
+  if (m_context) {
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(m_display, m_context);
+  }
+  eglTerminate(m_display);
+}
+
+std::string OffscreenContext::get_description() const {
+  const char *renderer =
+      reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+  const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+  return std::string(renderer ? renderer : "unknown renderer") + ", OpenGL " +
+         (version ? version : "unknown");
+}
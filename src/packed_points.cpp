@@ -0,0 +1,71 @@
+#include "packed_points.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void write_delta(std::vector<uint8_t> &out, int64_t delta) {
+  // Zigzag so small negative steps stay small, then 7 bits per byte
+  uint64_t value = (static_cast<uint64_t>(delta) << 1) ^
+                   static_cast<uint64_t>(delta >> 63);
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+} // namespace
+
+PackedPoints::PackedPoints(std::span<const glm::dvec2> points, double quantum)
+    : m_quantum(quantum), m_count(points.size()) {
+  if (points.empty())
+    return;
+
+  // Mouse samples move a few hundred grid steps apart: two bytes per axis
+  m_origin = points.front();
+  m_bytes.reserve(points.size() * 4);
+
+  int64_t previous_x = 0;
+  int64_t previous_y = 0;
+  for (size_t i = 1; i < points.size(); ++i) {
+    glm::dvec2 steps = (points[i] - m_origin) / quantum;
+    int64_t x = std::llround(steps.x);
+    int64_t y = std::llround(steps.y);
+
+    write_delta(m_bytes, x - previous_x);
+    write_delta(m_bytes, y - previous_y);
+    previous_x = x;
+    previous_y = y;
+  }
+  m_bytes.shrink_to_fit();
+}
+
+RawPointView::Iterator RawPointView::begin() const {
+  Iterator it;
+  if (m_packed) {
+    it.m_packed = m_packed;
+    it.m_byte = m_packed->m_bytes.data();
+    it.m_value = m_packed->m_origin;
+  } else {
+    it.m_point = m_points.data();
+  }
+  return it;
+}
+
+RawPointView::Iterator RawPointView::end() const {
+  Iterator it;
+  it.m_index = size();
+  return it;
+}
+
+std::span<const glm::dvec2>
+RawPointView::contiguous(std::vector<glm::dvec2> &storage) const {
+  if (!m_packed)
+    return m_points;
+
+  storage.resize(size());
+  std::copy(begin(), end(), storage.begin());
+  return storage;
+}
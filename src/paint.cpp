@@ -1,14 +1,21 @@
 #include "paint.h"
+#include "canvas_renderer.h"
+#include "frame_profiler.h"
 #include "GLFW/glfw3.h"
 #include "geometry.h"
 #include "glad/gl.h"
 #include "shader.h"
 #include "stroke.h"
+#include "stroke_selection.h"
+#include "stroke_style.h"
 #include "ui_manager.h"
+#include "vector_eraser.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <glm/matrix.hpp>
 #include <iostream>
+#include <iterator>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -50,21 +57,27 @@ GLuint load_texture(const char *path) {
   return textureID;
 }
 
-PaintApp::PaintApp(GLFWwindow *window)
-    : m_window(window), m_stroke_shader(Shader(STROKE_VERTEX_SHADER_PATH,
+PaintApp::PaintApp(GLFWwindow *window, const char *document_path)
+    : DOCUMENT_PATH(document_path), m_window(window),
+      m_stroke_shader(Shader(STROKE_VERTEX_SHADER_PATH,
                                                STROKE_FRAGMENT_SHADER_PATH)),
       m_ui_shader(Shader(UI_VERTEX_SHADER_PATH, UI_FRAGMENT_SHADER_PATH)),
       m_grid_shader(
-          Shader(GRID_VERTEX_SHADER_PATH, GRID_FRAGMENT_SHADER_PATH)) {
+          Shader(GRID_VERTEX_SHADER_PATH, GRID_FRAGMENT_SHADER_PATH)),
+      m_tile_shader(
+          Shader(TILE_VERTEX_SHADER_PATH, TILE_FRAGMENT_SHADER_PATH)) {
   setup_buffers();
 
-  glfwSetWindowUserPointer(m_window, (void *)this);
+  if (m_window) {
+    glfwSetWindowUserPointer(m_window, (void *)this);
 
-  glfwSetKeyCallback(m_window, PaintApp::glfw_key_callback);
-  glfwSetCursorPosCallback(m_window, PaintApp::glfw_cursor_callback);
-  glfwSetMouseButtonCallback(m_window, PaintApp::glfw_mouse_button_callback);
-  glfwSetWindowSizeCallback(m_window, PaintApp::glfw_framebuffer_size_callback);
-  glfwSetScrollCallback(m_window, PaintApp::glfw_scroll_callback);
+    glfwSetKeyCallback(m_window, PaintApp::glfw_key_callback);
+    glfwSetCursorPosCallback(m_window, PaintApp::glfw_cursor_callback);
+    glfwSetMouseButtonCallback(m_window, PaintApp::glfw_mouse_button_callback);
+    glfwSetWindowSizeCallback(m_window,
+                              PaintApp::glfw_framebuffer_size_callback);
+    glfwSetScrollCallback(m_window, PaintApp::glfw_scroll_callback);
+  }
 
   glEnable(GL_BLEND);
   glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
@@ -123,10 +136,12 @@ PaintApp::PaintApp(GLFWwindow *window)
                                self->textureID = m_pen_tex;
                              }
                            });
+
+  // Recover the last session, including edits made after the last save
+  open_document();
 }
 
 void setup_brush_preview(GLuint &preview_vao, GLuint &preview_vbo);
-void setup_stroke(GLuint &preview_vao);
 
 void PaintApp::setup_buffers() {
   setup_stroke(m_stroke_vao);
@@ -134,13 +149,39 @@ void PaintApp::setup_buffers() {
 }
 
 void PaintApp::render(double delta_time) {
-  process_input();
-  update_camera(delta_time);
+  {
+    PROFILE_ZONE("input");
+    apply_staged_samples();
+    process_input();
+  }
+  {
+    PROFILE_ZONE("prediction");
+    update_predicted_tail(delta_time);
+  }
+  {
+    PROFILE_ZONE("camera");
+    update_camera(delta_time);
+  }
+
+  // --- LIVE STROKE UPLOAD ---
+  // Copies only the vertices that changed since this ring region was last
+  // written, instead of re-uploading the whole stroke on every mouse move
+  if (!m_current_stroke.is_empty()) {
+    PROFILE_ZONE("live upload");
+    const std::vector<PointVertex> &vertices =
+        m_current_stroke.get_render_vertices();
+    m_live_buffer.invalidate(m_current_stroke.take_dirty_vertex());
+    m_live_buffer.update(vertices.data(), vertices.size());
+    m_current_stroke.upload_style();
+  }
 
   // --- STROKE RENDERING ---
-  m_stroke_shader.use();
-  glBindVertexArray(m_stroke_vao);
-  m_stroke_shader.setMat4("u_projection", m_app_state.projection);
+  {
+    PROFILE_ZONE("commit");
+    collect_finalized_strokes();
+    m_vertex_arena.collect();
+    StrokeStyleTable::instance().bind();
+  }
 
   double aspect_zoom =
       static_cast<double>(m_app_state.get_aspect()) * m_app_state.zoom;
@@ -151,91 +192,125 @@ void PaintApp::render(double delta_time) {
   camera_bounds.max = {m_app_state.view_pos.x + aspect_zoom,
                        m_app_state.view_pos.y + zoom};
 
-  for (auto &stroke : m_strokes) {
-    if (!stroke.get_bounds().intersects(camera_bounds))
-      continue;
+  // World units covered by one pixel, for picking stroke LODs
+  double pixel_size =
+      2.0 * zoom / static_cast<double>(m_app_state.window_height);
 
-    if (stroke.is_eraser()) {
-      glBlendFuncSeparate(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO,
-                          GL_ONE_MINUS_SRC_ALPHA);
-    } else {
-      glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
-                          GL_ONE_MINUS_SRC_ALPHA);
-    }
+  // Visible strokes come back in draw order, as erasers require
+  {
+    PROFILE_ZONE("culling");
+    m_visible_strokes.clear();
+    m_stroke_index.query(camera_bounds, m_visible_strokes);
+    build_visible_geometry();
+  }
 
-    if (stroke.get_raw_points().size() == 1) {
-      draw_dot(m_preview_vao, stroke.get_raw_points().front(),
-               stroke.get_thickness() / 2.0f, stroke.get_color(), 1.0f);
-    } else {
-      m_stroke_shader.use();
-      m_stroke_shader.setMat4("u_projection", m_app_state.projection);
-      glBindVertexArray(m_stroke_vao);
-      stroke.draw(m_stroke_vao, m_stroke_shader);
+  {
+    PROFILE_ZONE("strokes");
+    // Committed strokes only change on commit/undo/redo, so normally they
+    // come from cached tiles. Draw directly if the view needs more tiles
+    // than the cache can hold.
+    bool from_cache = m_app_state.use_tile_cache &&
+                      m_tile_cache.draw(camera_bounds, pixel_size,
+                                        m_app_state.projection,
+                                        m_stroke_shader, m_stroke_vao,
+                                        m_tile_shader);
+
+    m_stroke_shader.use();
+    glBindVertexArray(m_stroke_vao);
+    m_stroke_shader.setMat4("u_projection", m_app_state.projection);
+
+    if (!from_cache) {
+      // Runs of same-blend strokes go out as one multi-draw each
+      m_stroke_batch.begin();
+      for (uint32_t index : m_visible_strokes) {
+        const Stroke &stroke = m_strokes[index];
+        m_stroke_batch.add(stroke, stroke.select_lod(pixel_size));
+      }
+      m_stroke_batch.submit(m_stroke_vao);
     }
   }
 
-  // --- CURRENT STROKE + START CAP ---
+  // --- CURRENT STROKE ---
+  // A single sample already has dot geometry, so this also draws the
+  // start cap before the ribbon exists
   if (!m_current_stroke.is_empty()) {
-    if (m_current_stroke.is_eraser()) {
-      glBlendFuncSeparate(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO,
-                          GL_ONE_MINUS_SRC_ALPHA);
-    } else {
-      glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
-                          GL_ONE_MINUS_SRC_ALPHA);
-    }
-
-    // Draw the "Live" Start Cap
-    draw_dot(m_preview_vao, m_current_stroke.get_raw_points().front(),
-             m_app_state.current_thickness / 2.0f, m_app_state.current_color,
-             1.0f);
+    PROFILE_ZONE("live stroke");
+    StrokeBatch::apply_blend_mode(m_current_stroke.is_eraser()
+                                      ? StrokeBatch::BlendMode::Eraser
+                                      : StrokeBatch::BlendMode::Pen);
+    m_current_stroke.draw(m_stroke_vao, m_stroke_shader, m_live_buffer);
+    m_live_buffer.end_frame();
+  }
 
-    // Draw the actual line
-    m_stroke_shader.use(); // Ensure stroke shader is active for the ribbon
-    m_stroke_shader.setMat4("u_projection", m_app_state.projection);
-    glBindVertexArray(m_stroke_vao);
-    m_current_stroke.draw(m_stroke_vao, m_stroke_shader);
+  // --- PREDICTED TAIL ---
+  // Overlaps the end cap of the live stroke in the same style, so the
+  // joint does not show
+  if (m_has_tail) {
+    PROFILE_ZONE("predicted tail");
+    const std::vector<PointVertex> &vertices =
+        m_predicted_tail.get_render_vertices();
+    m_tail_buffer.invalidate(m_predicted_tail.take_dirty_vertex());
+    m_tail_buffer.update(vertices.data(), vertices.size());
+    m_predicted_tail.draw(m_stroke_vao, m_stroke_shader, m_tail_buffer);
+    m_tail_buffer.end_frame();
   }
 
   // --- MOUSE PREVIEW ---
-  // Reset to standard Alpha blending for the UI/Cursor
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glm::dvec2 world_pos = screen_to_world(m_app_state, m_input_state.curr_pos.x,
-                                         m_input_state.curr_pos.y);
-
-  if (m_app_state.is_eraser) {
-    // White Ring for Eraser
-    draw_dot(m_preview_vao, world_pos, m_app_state.current_thickness / 2.0f,
-             {1.0f, 1.0f, 1.0f}, 0.6f, GL_LINE_LOOP);
-  } else {
-    // Solid colored dot for Pen
-    draw_dot(m_preview_vao, world_pos, m_app_state.current_thickness / 2.0f,
-             m_app_state.current_color, 0.4f, GL_TRIANGLE_FAN);
+  {
+    PROFILE_ZONE("cursor");
+    // Reset to standard Alpha blending for the UI/Cursor
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glm::dvec2 world_pos = screen_to_world(
+        m_app_state, m_input_state.curr_pos.x, m_input_state.curr_pos.y);
+
+    if (m_app_state.is_eraser) {
+      // White Ring for Eraser
+      draw_dot(m_preview_vao, world_pos, m_app_state.current_thickness / 2.0f,
+               {1.0f, 1.0f, 1.0f}, 0.6f, GL_LINE_LOOP);
+    } else {
+      // Solid colored dot for Pen
+      draw_dot(m_preview_vao, world_pos, m_app_state.current_thickness / 2.0f,
+               m_app_state.current_color, 0.4f, GL_TRIANGLE_FAN);
+    }
   }
 
   // --- GRID ---
-  glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_ONE);
-  glm::mat4 gridModel =
-      glm::translate(glm::mat4(1.0f), glm::vec3(m_app_state.view_pos, -0.9f));
-  gridModel = glm::scale(
-      gridModel, glm::vec3(m_app_state.get_aspect() * m_app_state.zoom * 2.0f,
-                           m_app_state.zoom * 2.0f, 1.0f));
-  gridModel = glm::translate(gridModel, glm::vec3(-0.5f, -0.5f, 0.0f));
-
-  m_grid_shader.use();
-  m_grid_shader.setMat4("u_projection", m_app_state.projection);
-  m_grid_shader.setMat4("u_model", gridModel);
-  m_grid_shader.setFloat("u_zoom", m_app_state.zoom);
-  draw_quad();
+  {
+    PROFILE_ZONE("grid");
+    glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_ONE);
+    glm::mat4 gridModel = glm::translate(
+        glm::mat4(1.0f), glm::vec3(m_app_state.view_pos, -0.9f));
+    gridModel = glm::scale(
+        gridModel, glm::vec3(m_app_state.get_aspect() * m_app_state.zoom * 2.0f,
+                             m_app_state.zoom * 2.0f, 1.0f));
+    gridModel = glm::translate(gridModel, glm::vec3(-0.5f, -0.5f, 0.0f));
+
+    m_grid_shader.use();
+    m_grid_shader.setMat4("u_projection", m_app_state.projection);
+    m_grid_shader.setMat4("u_model", gridModel);
+    m_grid_shader.setFloat("u_zoom", m_app_state.zoom);
+    draw_quad();
+  }
 
   // --- UI ---
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  m_ui_manager.render(m_ui_shader, m_app_state.window_width,
-                      m_app_state.window_height);
+  {
+    PROFILE_ZONE("ui");
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_ui_manager.render(m_ui_shader, m_app_state.window_width,
+                        m_app_state.window_height);
+  }
+
+#if SIMPLE_PAINT_PROFILE
+  // Drawn last and outside any zone, so it does not time itself
+  if (m_app_state.show_profiler) {
+    FrameProfiler::instance().draw_hud(m_ui_shader, m_app_state.window_width,
+                                       m_app_state.window_height);
+  }
+#endif
 }
 
 void PaintApp::start_drawing() {
   m_app_state.is_drawing = true;
-  m_strokes_revert.clear();
 
   m_current_stroke =
       Stroke(m_app_state.current_color, m_app_state.current_thickness,
@@ -245,24 +320,103 @@ void PaintApp::start_drawing() {
                                          m_input_state.curr_pos.y);
 
   m_current_stroke.add_point(world_pos.x, world_pos.y);
-  m_current_stroke.upload();
+  m_live_buffer.reset();
+
+  m_predictor.reset();
+  m_predictor.add_sample(m_input_state.curr_pos, m_input_state.event_time);
+  m_last_sample_world = world_pos;
 }
 
 void PaintApp::on_drawing(double x, double y) {
-  glm::dvec2 world_pos = screen_to_world(m_app_state, x, y);
+  // Applied at the start of the next frame (or before the next non-cursor
+  // event), then uploaded once in render()
+  m_staged_samples.push_back({{x, y}, m_input_state.event_time});
+}
 
-  m_current_stroke.add_point(world_pos.x, world_pos.y);
-  m_current_stroke.upload();
+void PaintApp::apply_staged_samples() {
+  if (m_staged_samples.empty())
+    return;
+
+  // The projection only changes in update_camera(), after this, so every
+  // sample converts exactly as it would have on arrival
+  glm::mat4 inverse_projection = glm::inverse(m_app_state.projection);
+  m_staged_world.clear();
+  for (const StagedSample &sample : m_staged_samples) {
+    m_staged_world.push_back(screen_to_world(m_app_state, inverse_projection,
+                                             sample.position.x,
+                                             sample.position.y));
+  }
+
+  if (m_app_state.is_drawing) {
+    m_current_stroke.add_points(m_staged_world);
+    for (const StagedSample &sample : m_staged_samples)
+      m_predictor.add_sample(sample.position, sample.time);
+    m_last_sample_world = m_staged_world.back();
+    m_stroke_moved = true;
+  }
+  m_staged_samples.clear();
+}
+
+void PaintApp::update_predicted_tail(double delta_time) {
+  // 1. A new tail once real samples arrive; the old one is thrown away
+  m_tail_age += delta_time;
+  bool moved = m_stroke_moved;
+  m_stroke_moved = false;
+  if (!m_app_state.is_drawing || m_app_state.prediction_horizon <= 0.0) {
+    m_has_tail = false;
+    return;
+  }
+  if (!moved) {
+    // The pen stopped (or its events are late): keep the tail only as
+    // long as it predicts
+    if (m_tail_age > m_app_state.prediction_horizon)
+      m_has_tail = false;
+    return;
+  }
+
+  m_predicted_points.clear();
+  m_has_tail = m_predictor.predict(m_app_state.prediction_horizon,
+                                   m_predicted_points);
+  m_tail_age = 0.0;
+  if (!m_has_tail)
+    return;
+
+  // 2. From the end of the live stroke along the prediction, in its style
+  glm::mat4 inverse_projection = glm::inverse(m_app_state.projection);
+  m_staged_world.clear();
+  m_staged_world.push_back(m_last_sample_world);
+  for (glm::dvec2 point : m_predicted_points) {
+    m_staged_world.push_back(
+        screen_to_world(m_app_state, inverse_projection, point.x, point.y));
+  }
+
+  m_predicted_tail.clear();
+  m_predicted_tail.set_color(m_current_stroke.get_color());
+  m_predicted_tail.set_thickness(m_current_stroke.get_thickness());
+  m_predicted_tail.set_eraser(m_current_stroke.is_eraser());
+  m_predicted_tail.add_points(m_staged_world);
+  m_predicted_tail.upload_style();
 }
 
 void PaintApp::end_drawing() {
   m_app_state.is_drawing = false;
-  if (!m_current_stroke.is_empty()) {
-    if (m_current_stroke.get_raw_points().size() > 1) {
-      m_current_stroke.update_geometry();
-      m_current_stroke.upload();
-    }
-
+  if (m_current_stroke.is_eraser() && m_app_state.vector_eraser) {
+    vector_erase(m_current_stroke);
+  } else if (!m_current_stroke.is_empty()) {
+    m_strokes_revert.clear();
+    m_finalized_while_undone.clear();
+    m_edit_redo.clear();
+
+    // Simplification, rebuild and LODs run on the worker; until they are
+    // done the stroke keeps its live geometry, uploaded as is
+    m_finalizer.submit(m_current_stroke.clone_geometry(),
+                       simplify_tolerance_for(m_current_stroke));
+    m_current_stroke.upload(m_vertex_arena);
+
+    m_stroke_index.insert(static_cast<uint32_t>(m_strokes.size()),
+                          m_current_stroke.get_bounds());
+    m_tile_cache.invalidate(m_current_stroke.get_bounds());
+    m_journal.append_commit(m_current_stroke);
     m_strokes.push_back(std::move(m_current_stroke));
   }
   m_current_stroke =
@@ -270,6 +424,101 @@ void PaintApp::end_drawing() {
              m_app_state.is_eraser);
 }
 
+double PaintApp::simplify_tolerance_for(const Stroke &stroke) const {
+  if (m_app_state.simplify_tolerance >= 0.0)
+    return m_app_state.simplify_tolerance;
+
+  // Thin strokes keep their detail, and so does anything drawn zoomed in
+  double pixel_size = 2.0 * static_cast<double>(m_app_state.zoom) /
+                      static_cast<double>(m_app_state.window_height);
+  return std::min(m_app_state.simplify_thickness_ratio * stroke.get_thickness(),
+                  0.5 * pixel_size);
+}
+
+void PaintApp::vector_erase(const Stroke &eraser) {
+  // 1. Cut every stroke under the eraser, in parallel
+  std::vector<uint32_t> candidates;
+  m_stroke_index.query(eraser.get_bounds(), candidates);
+
+  struct Cut {
+    bool touched = false;
+    std::vector<std::vector<glm::dvec2>> pieces;
+  };
+  std::vector<Cut> cuts(candidates.size());
+  // A single click has no smooth points yet still erases, as a dot
+  std::vector<glm::dvec2> storage;
+  std::span<const glm::dvec2> path = eraser.get_centerline(storage);
+  double eraser_radius = eraser.get_thickness() * 0.5;
+
+  m_scheduler.parallel_for(0, candidates.size(), 1, [&](size_t first,
+                                                         size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      const Stroke &stroke = m_strokes[candidates[i]];
+      if (stroke.is_eraser())
+        continue;
+
+      // Cut wherever the ink is under the eraser: the pieces get round
+      // caps of the stroke's radius, which then end at the eraser's edge
+      double radius = eraser_radius + stroke.get_thickness() * 0.5;
+      cuts[i].touched = erase_along_path(stroke.get_raw_points(), path,
+                                         radius, cuts[i].pieces);
+    }
+  });
+
+  // 2. Each touched stroke is replaced by its pieces; candidates are in
+  // list order already
+  StrokeEdit edit;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (!cuts[i].touched)
+      continue;
+
+    const Stroke &original = m_strokes[candidates[i]];
+    StrokeReplacement &replacement =
+        edit.replacements.emplace_back(candidates[i], 1u);
+    for (std::vector<glm::dvec2> &piece : cuts[i].pieces) {
+      Stroke stroke(original.get_color(), original.get_thickness());
+      stroke.set_raw_points(std::move(piece));
+      stroke.pack_points();
+      replacement.strokes.push_back(std::move(stroke));
+    }
+  }
+  if (edit.replacements.empty())
+    return;
+
+  // 3. A new edit: nothing to redo any more
+  m_strokes_revert.clear();
+  m_finalized_while_undone.clear();
+  m_edit_redo.clear();
+  apply_edit(edit, true);
+  edit.depth = m_strokes.size();
+  m_edit_undo.push_back(std::move(edit));
+}
+
+void PaintApp::apply_edit(StrokeEdit &edit, bool clears_redo) {
+  m_journal.append_replace(edit.replacements, clears_redo);
+
+  for (const StrokeReplacement &replacement : edit.replacements) {
+    for (uint32_t i = 0; i < replacement.remove_count; ++i)
+      m_tile_cache.invalidate(m_strokes[replacement.index + i].get_bounds());
+    for (const Stroke &stroke : replacement.strokes)
+      m_tile_cache.invalidate(stroke.get_bounds());
+  }
+
+  // Inserted strokes build their geometry once visible
+  size_t old_size = m_strokes.size();
+  size_t first = replace_strokes(m_strokes, edit.replacements);
+  for (StrokeReplacement &replacement : edit.replacements) {
+    for (Stroke &stroke : replacement.strokes)
+      stroke.release_geometry();
+  }
+
+  // Everything after the first change may have moved
+  for (size_t i = first; i < m_strokes.size(); ++i)
+    m_stroke_index.insert(static_cast<uint32_t>(i), m_strokes[i].get_bounds());
+  for (size_t i = old_size; i > m_strokes.size(); --i)
+    m_stroke_index.remove(static_cast<uint32_t>(i - 1));
+}
+
 // Paint app internal handlers
 void PaintApp::update_camera(double deltaTime) {
   // 1. Smoothly interpolate Zoom
@@ -296,9 +545,9 @@ void PaintApp::handle_viewport_size(int width, int height) {
 }
 
 void PaintApp::handle_scroll(double xoffset, double yoffset) {
-  if (glfwGetKey(m_window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
-    double x, y;
-    glfwGetCursorPos(m_window, &x, &y);
+  if (m_input_state.ctrl_down) {
+    double x = m_input_state.cursor_pos.x;
+    double y = m_input_state.cursor_pos.y;
 
     glm::dvec2 mouse_world_before = screen_to_world(m_app_state, x, y);
 
@@ -334,6 +583,14 @@ void PaintApp::handle_scroll(double xoffset, double yoffset) {
 }
 
 void PaintApp::handle_key_event(int key, int action, int mods) {
+  // Modifiers used by mouse gestures; GLFW_REPEAT leaves them held
+  if (action != GLFW_REPEAT) {
+    if (key == GLFW_KEY_SPACE)
+      m_input_state.space_down = action == GLFW_PRESS;
+    if (key == GLFW_KEY_LEFT_CONTROL)
+      m_input_state.ctrl_down = action == GLFW_PRESS;
+  }
+
   if (action == GLFW_PRESS) {
     if (key == GLFW_KEY_0) {
       m_app_state.target_view_pos = glm::vec2(0.0f, 0.0f);
@@ -344,17 +601,48 @@ void PaintApp::handle_key_event(int key, int action, int mods) {
 
     // Undo: Ctrl + Z or U
     if ((ctrl_down && key == GLFW_KEY_Z) || key == GLFW_KEY_U) {
-      if (!m_strokes.empty()) {
-        m_strokes_revert.push_back(std::move(m_strokes.back()));
+      if (!m_edit_undo.empty() &&
+          m_edit_undo.back().depth == m_strokes.size()) {
+        StrokeEdit edit = std::move(m_edit_undo.back());
+        m_edit_undo.pop_back();
+        apply_edit(edit, false);
+        edit.depth = m_strokes_revert.size();
+        m_edit_redo.push_back(std::move(edit));
+      } else if (!m_strokes.empty()) {
+        m_tile_cache.invalidate(m_strokes.back().get_bounds());
+        m_strokes_revert.push(std::move(m_strokes.back()));
         m_strokes.pop_back();
+        m_stroke_index.remove(static_cast<uint32_t>(m_strokes.size()));
+        m_journal.append_undo();
       }
     }
 
     // Redo: Ctrl + Y or Ctrl + R
     if (ctrl_down && (key == GLFW_KEY_R || key == GLFW_KEY_Y)) {
-      if (!m_strokes_revert.empty()) {
-        m_strokes.push_back(std::move(m_strokes_revert.back()));
-        m_strokes_revert.pop_back();
+      // The stroke's geometry is rebuilt once it is visible
+      if (!m_edit_redo.empty() &&
+          m_edit_redo.back().depth == m_strokes_revert.size()) {
+        StrokeEdit edit = std::move(m_edit_redo.back());
+        m_edit_redo.pop_back();
+        apply_edit(edit, false);
+        edit.depth = m_strokes.size();
+        m_edit_undo.push_back(std::move(edit));
+      } else if (!m_strokes_revert.empty()) {
+        Stroke stroke = m_strokes_revert.pop();
+        m_stroke_index.insert(static_cast<uint32_t>(m_strokes.size()),
+                              stroke.get_bounds());
+        m_tile_cache.invalidate(stroke.get_bounds());
+        m_strokes.push_back(std::move(stroke));
+        m_journal.append_redo();
+
+        auto finalized = std::find(m_finalized_while_undone.begin(),
+                                   m_finalized_while_undone.end(),
+                                   m_strokes.back().get_id());
+        if (finalized != m_finalized_while_undone.end()) {
+          m_finalized_while_undone.erase(finalized);
+          m_journal.append_finalized(
+              static_cast<uint32_t>(m_strokes.size() - 1), m_strokes.back());
+        }
       }
     }
 
@@ -366,6 +654,50 @@ void PaintApp::handle_key_event(int key, int action, int mods) {
       set_thickness(m_app_state.current_thickness * 0.8f);
     }
 
+    if (key == GLFW_KEY_F3) {
+      print_render_stats();
+    }
+
+    if (key == GLFW_KEY_F4) {
+      m_app_state.use_tile_cache = !m_app_state.use_tile_cache;
+    }
+
+    if (key == GLFW_KEY_F5) {
+      rebuild_all();
+    }
+
+    // Cycles the prediction horizon, reporting the error of the last one
+    if (key == GLFW_KEY_F8) {
+      print_prediction_stats();
+      double horizon = m_app_state.prediction_horizon + 0.008;
+      set_prediction_horizon(horizon > 0.0325 ? 0.0 : horizon);
+      std::cout << "prediction horizon: "
+                << m_app_state.prediction_horizon * 1000.0 << " ms"
+                << std::endl;
+    }
+
+#if SIMPLE_PAINT_PROFILE
+    // F6 shows the profiler HUD (its legend goes to the console), F7 dumps
+    // the recent frames for chrome://tracing
+    if (key == GLFW_KEY_F6) {
+      m_app_state.show_profiler = !m_app_state.show_profiler;
+      if (m_app_state.show_profiler)
+        FrameProfiler::instance().print_stats();
+    }
+
+    if (key == GLFW_KEY_F7) {
+      FrameProfiler::instance().write_trace("frame_trace.json");
+    }
+#endif
+
+    if (ctrl_down && key == GLFW_KEY_S) {
+      save_document();
+    }
+
+    if (ctrl_down && key == GLFW_KEY_O) {
+      open_document();
+    }
+
     if (key == GLFW_KEY_E) {
       m_app_state.is_eraser = !m_app_state.is_eraser;
       UIElement *tool_el = m_ui_manager.get_element("current_tool");
@@ -373,6 +705,165 @@ void PaintApp::handle_key_event(int key, int action, int mods) {
         tool_el->textureID = m_app_state.is_eraser ? m_eraser_tex : m_pen_tex;
       }
     }
+
+    if (key == GLFW_KEY_V) {
+      m_app_state.vector_eraser = !m_app_state.vector_eraser;
+      std::cout << "eraser: "
+                << (m_app_state.vector_eraser ? "vector" : "pixel")
+                << std::endl;
+    }
+  }
+}
+
+void PaintApp::print_render_stats() const {
+  const BatchStats &batch = m_stroke_batch.get_stats();
+  ArenaStats arena = m_vertex_arena.get_stats();
+
+  std::cout << "strokes: " << batch.strokes << " / " << m_strokes.size()
+            << " visible, draw calls: " << batch.draw_calls
+            << ", state changes: " << batch.state_changes << std::endl;
+  std::cout << "arena: " << arena.block_count << " blocks, " << arena.used
+            << " / " << arena.capacity << " vertices, fragmentation "
+            << arena.fragmentation() << ", " << arena.defragmentations
+            << " defragmentations, " << arena.upload_calls << " uploads"
+            << std::endl;
+  std::cout << "tiles: " << m_tile_cache.get_tile_count() << " / "
+            << m_tile_cache.get_capacity() << " cached, "
+            << m_tile_cache.get_rendered_last_frame()
+            << " rasterized last frame" << std::endl;
+  std::cout << "undo history: " << m_strokes_revert.size() << " strokes, "
+            << m_strokes_revert.get_resident_bytes() / 1024 << " / "
+            << m_strokes_revert.get_budget() / 1024 << " KiB resident, "
+            << m_strokes_revert.get_spilled_count() << " spilled ("
+            << m_strokes_revert.get_spilled_bytes() / 1024 << " KiB)"
+            << std::endl;
+  print_prediction_stats();
+}
+
+void PaintApp::set_prediction_horizon(double seconds) {
+  m_app_state.prediction_horizon =
+      glm::clamp(seconds, 0.0, StrokePredictor::MAX_HORIZON);
+  m_predictor.clear_error_stats();
+  m_has_tail = false;
+}
+
+void PaintApp::print_prediction_stats() const {
+  StrokePredictor::ErrorStats error = m_predictor.get_error_stats();
+  std::cout << "prediction: "
+            << m_app_state.prediction_horizon * 1000.0 << " ms horizon, error "
+            << error.mean << " px mean, " << error.p95 << " px p95, "
+            << error.max << " px max over " << error.samples << " samples"
+            << std::endl;
+}
+
+void PaintApp::rebuild_all() {
+  double start = glfwGetTime();
+
+  // 1. CPU work on every core
+  rebuild_strokes(m_strokes, m_scheduler);
+
+  // 2. Upload in one batch on the GL thread
+  m_stroke_index.clear();
+  m_vertex_arena.begin_batch();
+  for (size_t i = 0; i < m_strokes.size(); ++i) {
+    m_strokes[i].upload(m_vertex_arena);
+    m_stroke_index.insert(static_cast<uint32_t>(i), m_strokes[i].get_bounds());
+  }
+  m_vertex_arena.end_batch();
+  m_tile_cache.clear();
+
+  std::cout << "rebuilt " << m_strokes.size() << " strokes in "
+            << (glfwGetTime() - start) * 1000.0 << " ms on "
+            << m_scheduler.get_thread_count() << " threads" << std::endl;
+}
+
+void PaintApp::save_document() { m_journal.request_compaction(); }
+
+void PaintApp::open_document() {
+  double start = glfwGetTime();
+
+  // 1. Replace the canvas; finalizer results for old strokes are dropped
+  m_app_state.is_drawing = false;
+  m_current_stroke.clear();
+  m_strokes.clear();
+  m_strokes_revert.clear();
+  m_finalized_while_undone.clear();
+  m_edit_undo.clear();
+  m_edit_redo.clear();
+  m_stroke_index.clear();
+  m_tile_cache.clear();
+
+  // 2. Strokes point into the snapshot mapping or the journal; geometry
+  // waits until they are seen
+  std::vector<Stroke> reverted;
+  m_journal.load(m_strokes, reverted);
+  for (Stroke &stroke : reverted)
+    m_strokes_revert.push(std::move(stroke));
+  for (size_t i = 0; i < m_strokes.size(); ++i)
+    m_stroke_index.insert(static_cast<uint32_t>(i), m_strokes[i].get_bounds());
+
+  std::cout << "opened " << DOCUMENT_PATH << ": " << m_strokes.size()
+            << " strokes in " << (glfwGetTime() - start) * 1000.0 << " ms"
+            << std::endl;
+}
+
+void PaintApp::build_visible_geometry() {
+  m_pending_geometry.clear();
+  for (uint32_t index : m_visible_strokes) {
+    if (m_strokes[index].needs_geometry())
+      m_pending_geometry.push_back(index);
+  }
+  if (m_pending_geometry.empty())
+    return;
+
+  // 1. CPU work on every core
+  m_scheduler.parallel_for(
+      0, m_pending_geometry.size(), 1, [this](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+          m_strokes[m_pending_geometry[i]].update_geometry(m_scheduler);
+      });
+
+  // 2. Upload in one batch, and redraw any tiles that were cached without
+  // these strokes
+  m_vertex_arena.begin_batch();
+  for (uint32_t index : m_pending_geometry) {
+    Stroke &stroke = m_strokes[index];
+    stroke.upload(m_vertex_arena);
+    m_stroke_index.insert(index, stroke.get_bounds());
+    m_tile_cache.invalidate(stroke.get_bounds());
+  }
+  m_vertex_arena.end_batch();
+}
+
+void PaintApp::collect_finalized_strokes() {
+  Stroke finished;
+  while (m_finalizer.poll(finished)) {
+    auto matches = [&](const Stroke &stroke) {
+      return stroke.get_id() == finished.get_id();
+    };
+
+    // Usually one of the last strokes, unless it was undone meanwhile
+    auto it = std::find_if(m_strokes.rbegin(), m_strokes.rend(), matches);
+    if (it != m_strokes.rend()) {
+      uint32_t index =
+          static_cast<uint32_t>(std::distance(it, m_strokes.rend()) - 1);
+      m_tile_cache.invalidate(it->get_bounds());
+
+      it->adopt_geometry(std::move(finished));
+      it->upload(m_vertex_arena);
+      m_stroke_index.insert(index, it->get_bounds());
+      m_tile_cache.invalidate(it->get_bounds());
+
+      // Reloads must rebuild from the points the session draws
+      m_journal.append_finalized(index, *it);
+      continue;
+    }
+
+    // Otherwise it was undone (keep its packed points, journaled on redo)
+    // or discarded
+    uint64_t id = finished.get_id();
+    if (m_strokes_revert.adopt_geometry(std::move(finished)))
+      m_finalized_while_undone.push_back(id);
   }
 }
 
@@ -392,21 +883,39 @@ void PaintApp::handle_mouse_click(int button, int action) {
       m_input_state.is_pressed = false;
       end_drawing();
     }
+  } else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
+    m_input_state.right_pressed = action == GLFW_PRESS;
+  } else if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS) {
+    pick_at_cursor();
   }
 }
 
-void PaintApp::process_input() {
-  double x, y;
-
-  glfwGetCursorPos(m_window, &x, &y);
+void PaintApp::pick_at_cursor() {
+  double start = glfwGetTime();
+  glm::dvec2 world_pos = screen_to_world(m_app_state, m_input_state.curr_pos.x,
+                                         m_input_state.curr_pos.y);
+  double pixel_size = 2.0 * static_cast<double>(m_app_state.zoom) /
+                      static_cast<double>(m_app_state.window_height);
+
+  uint32_t picked;
+  bool found = pick_stroke(m_strokes, m_stroke_index, world_pos,
+                           PICK_RADIUS_PIXELS * pixel_size, picked);
+  double elapsed = (glfwGetTime() - start) * 1000.0;
+
+  if (found)
+    std::cout << "picked stroke " << picked << " in " << elapsed << " ms"
+              << std::endl;
+  else
+    std::cout << "no stroke under the cursor (" << elapsed << " ms)"
+              << std::endl;
+}
 
-  m_input_state.update_pos({x, y});
+void PaintApp::process_input() {
+  m_input_state.update_pos(m_input_state.cursor_pos);
 
-  bool left_down =
-      glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
-  bool right_down =
-      glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
-  bool space_down = glfwGetKey(m_window, GLFW_KEY_SPACE) == GLFW_PRESS;
+  bool left_down = m_input_state.is_pressed;
+  bool right_down = m_input_state.right_pressed;
+  bool space_down = m_input_state.space_down;
 
   bool is_panning_chord = left_down && right_down;
   bool is_space_panning = space_down && left_down;
@@ -433,13 +942,13 @@ void PaintApp::process_input() {
 }
 
 void PaintApp::handle_mouse_move(double x, double y) {
+  m_input_state.cursor_pos = {x, y};
+
   // We check panning conditions to ensure we don't draw while panning chords
   // are active
-  bool left_down =
-      glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
-  bool right_down =
-      glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
-  bool space_down = glfwGetKey(m_window, GLFW_KEY_SPACE) == GLFW_PRESS;
+  bool left_down = m_input_state.is_pressed;
+  bool right_down = m_input_state.right_pressed;
+  bool space_down = m_input_state.space_down;
   bool is_panning = (left_down && right_down) || (space_down && left_down);
 
   if (m_app_state.is_drawing && !is_panning) {
@@ -486,12 +995,17 @@ void PaintApp::draw_dot(GLuint &vao, const glm::vec2 &world_pos, float radius,
 
 glm::dvec2 PaintApp::screen_to_world(const AppState &state, double xpos,
                                      double ypos) {
+  return screen_to_world(state, glm::inverse(state.projection), xpos, ypos);
+}
+
+glm::dvec2 PaintApp::screen_to_world(const AppState &state,
+                                     const glm::mat4 &inverse_projection,
+                                     double xpos, double ypos) {
   float nx = (2.0f * (float)xpos) / state.window_width - 1.0f;
   float ny = 1.0f - (2.0f * (float)ypos) / state.window_height;
 
   // Direct inverse transform
-  glm::mat4 invProj = glm::inverse(state.projection);
-  glm::vec4 worldPos = invProj * glm::vec4(nx, ny, 0.0f, 1.0f);
+  glm::vec4 worldPos = inverse_projection * glm::vec4(nx, ny, 0.0f, 1.0f);
 
   return glm::dvec2(worldPos);
 }
@@ -509,40 +1023,6 @@ void PaintApp::update_projection() {
   m_app_state.projection = glm::ortho(left, right, bottom, top, -1.0f, 1.0f);
 }
 
-void setup_stroke(GLuint &stroke_vao) {
-  glCreateVertexArrays(1, &stroke_vao);
-
-  // Attribute 0: Position (3 floats)
-  glEnableVertexArrayAttrib(stroke_vao, 0);
-  glVertexArrayAttribFormat(stroke_vao, 0, 2, GL_FLOAT, GL_FALSE,
-                            offsetof(PointVertex, position));
-  glVertexArrayAttribBinding(stroke_vao, 0, 0);
-
-  // Attribute 1: Color (3 floats)
-  glEnableVertexArrayAttrib(stroke_vao, 1);
-  glVertexArrayAttribFormat(stroke_vao, 1, 3, GL_FLOAT, GL_FALSE,
-                            offsetof(PointVertex, color));
-  glVertexArrayAttribBinding(stroke_vao, 1, 0);
-
-  // Attribute 2: UV (2 floats)
-  glEnableVertexArrayAttrib(stroke_vao, 2);
-  glVertexArrayAttribFormat(stroke_vao, 2, 2, GL_FLOAT, GL_FALSE,
-                            offsetof(PointVertex, uv));
-  glVertexArrayAttribBinding(stroke_vao, 2, 0);
-
-  // Attribute 3: Total Stroke Length (1 floats)
-  glEnableVertexArrayAttrib(stroke_vao, 3);
-  glVertexArrayAttribFormat(stroke_vao, 3, 1, GL_FLOAT, GL_FALSE,
-                            offsetof(PointVertex, thickness));
-  glVertexArrayAttribBinding(stroke_vao, 3, 0);
-
-  // Attribute 3: Total Stroke Length (1 floats)
-  glEnableVertexArrayAttrib(stroke_vao, 4);
-  glVertexArrayAttribFormat(stroke_vao, 4, 1, GL_FLOAT, GL_FALSE,
-                            offsetof(PointVertex, total_stroke_length));
-  glVertexArrayAttribBinding(stroke_vao, 4, 0);
-}
-
 void setup_brush_preview(GLuint &preview_vao, GLuint &preview_vbo) {
   const int segments = 32;
   std::vector<float> vertices;
@@ -569,13 +1049,44 @@ void setup_brush_preview(GLuint &preview_vao, GLuint &preview_vbo) {
   glVertexArrayAttribBinding(preview_vao, 0, 0);
 }
 
+void PaintApp::handle_input(const InputEvent &event) {
+  if (m_recorder)
+    m_recorder->record(event);
+  m_input_state.event_time = event.time;
+
+  // Button, key and resize handlers see the stroke with every sample that
+  // came before them
+  if (event.type != InputEvent::Type::Cursor)
+    apply_staged_samples();
+
+  switch (event.type) {
+  case InputEvent::Type::Cursor:
+    handle_mouse_move(event.value.x, event.value.y);
+    break;
+  case InputEvent::Type::MouseButton:
+    handle_mouse_click(event.code, event.action);
+    break;
+  case InputEvent::Type::Key:
+    handle_key_event(event.code, event.action, event.mods);
+    break;
+  case InputEvent::Type::Scroll:
+    handle_scroll(event.value.x, event.value.y);
+    break;
+  case InputEvent::Type::Resize:
+    handle_viewport_size(static_cast<int>(event.value.x),
+                         static_cast<int>(event.value.y));
+    break;
+  }
+}
+
 // GLFW adapter handlers
 
 void PaintApp::glfw_framebuffer_size_callback(GLFWwindow *window, int width,
                                               int height) {
   auto *app = static_cast<PaintApp *>(glfwGetWindowUserPointer(window));
   if (app) {
-    app->handle_viewport_size(width, height);
+    app->handle_input({InputEvent::Type::Resize, glfwGetTime(), 0, 0, 0,
+                       {width, height}});
   }
 }
 
@@ -583,32 +1094,40 @@ void PaintApp::glfw_scroll_callback(GLFWwindow *window, double xoffset,
                                     double yoffset) {
   auto *app = static_cast<PaintApp *>(glfwGetWindowUserPointer(window));
   if (app) {
-    app->handle_scroll(xoffset, yoffset);
+    app->handle_input({InputEvent::Type::Scroll, glfwGetTime(), 0, 0, 0,
+                       {xoffset, yoffset}});
   }
 }
 
 void PaintApp::glfw_cursor_callback(GLFWwindow *window, double xpos,
                                     double ypos) {
   auto *app = static_cast<PaintApp *>(glfwGetWindowUserPointer(window));
-  if (app)
-    app->handle_mouse_move(xpos, ypos);
+  if (app) {
+    app->handle_input(
+        {InputEvent::Type::Cursor, glfwGetTime(), 0, 0, 0, {xpos, ypos}});
+  }
 }
 
 void PaintApp::glfw_key_callback(GLFWwindow *window, int key, int scancode,
                                  int action, int mods) {
   auto *app = static_cast<PaintApp *>(glfwGetWindowUserPointer(window));
-  if (app)
-    app->handle_key_event(key, action, mods);
+  if (app) {
+    app->handle_input(
+        {InputEvent::Type::Key, glfwGetTime(), key, action, mods});
+  }
 }
 
 void PaintApp::glfw_mouse_button_callback(GLFWwindow *window, int button,
                                           int action, int mods) {
   auto *app = static_cast<PaintApp *>(glfwGetWindowUserPointer(window));
-  if (app)
-    app->handle_mouse_click(button, action);
+  if (app) {
+    app->handle_input(
+        {InputEvent::Type::MouseButton, glfwGetTime(), button, action, mods});
+  }
 }
 
 PaintApp::~PaintApp() {
+  StrokeStyleTable::instance().destroy();
   glDeleteVertexArrays(1, &m_stroke_vao);
 
   glDeleteVertexArrays(1, &m_preview_vao);
@@ -623,4 +1142,9 @@ PaintApp::~PaintApp() {
   glDeleteProgram(m_stroke_shader.ID);
   glDeleteProgram(m_ui_shader.ID);
   glDeleteProgram(m_grid_shader.ID);
+  glDeleteProgram(m_tile_shader.ID);
+
+#if SIMPLE_PAINT_PROFILE
+  FrameProfiler::instance().destroy();
+#endif
 }
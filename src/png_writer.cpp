@@ -0,0 +1,94 @@
+#include "png_writer.h"
+
+#include <zlib.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+void put_u32(std::vector<uint8_t> &out, uint32_t value) {
+  uint8_t bytes[4] = {static_cast<uint8_t>(value >> 24),
+                      static_cast<uint8_t>(value >> 16),
+                      static_cast<uint8_t>(value >> 8),
+                      static_cast<uint8_t>(value)};
+  out.insert(out.end(), bytes, bytes + 4);
+}
+
+// Length, type, data, then the CRC of type and data
+void put_chunk(std::vector<uint8_t> &out, const char type[4],
+               const uint8_t *data, size_t size) {
+  put_u32(out, static_cast<uint32_t>(size));
+  size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  if (size > 0)
+    out.insert(out.end(), data, data + size);
+
+  uLong crc = crc32(0L, Z_NULL, 0);
+  crc = crc32(crc, out.data() + start, static_cast<uInt>(out.size() - start));
+  put_u32(out, static_cast<uint32_t>(crc));
+}
+
+} // namespace
+
+bool encode_png(int width, int height, std::span<const uint8_t> rgba,
+                std::vector<uint8_t> &out, int compression_level) {
+  size_t row_bytes = static_cast<size_t>(width) * 4;
+  if (width <= 0 || height <= 0 || rgba.size() < row_bytes * height)
+    return false;
+
+  // 1. Filtered scanlines: a filter type byte, then each byte minus the
+  // same channel of the pixel to its left
+  std::vector<uint8_t> filtered((row_bytes + 1) * height);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *row = rgba.data() + row_bytes * y;
+    uint8_t *dst = filtered.data() + (row_bytes + 1) * y;
+    dst[0] = 1; // Sub
+    std::memcpy(dst + 1, row, 4);
+    for (size_t x = 4; x < row_bytes; ++x)
+      dst[1 + x] = static_cast<uint8_t>(row[x] - row[x - 4]);
+  }
+
+  // 2. One zlib stream for all of them
+  uLongf compressed_size = compressBound(static_cast<uLong>(filtered.size()));
+  std::vector<uint8_t> compressed(compressed_size);
+  if (compress2(compressed.data(), &compressed_size, filtered.data(),
+                static_cast<uLong>(filtered.size()),
+                compression_level) != Z_OK)
+    return false;
+
+  // 3. Signature and chunks
+  static constexpr uint8_t SIGNATURE[8] = {0x89, 'P',  'N',  'G',
+                                           '\r', '\n', 0x1a, '\n'};
+  out.assign(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+
+  std::vector<uint8_t> header;
+  put_u32(header, static_cast<uint32_t>(width));
+  put_u32(header, static_cast<uint32_t>(height));
+  const uint8_t format[5] = {8, 6, 0, 0, 0}; // 8-bit RGBA, no interlace
+  header.insert(header.end(), format, format + sizeof(format));
+
+  put_chunk(out, "IHDR", header.data(), header.size());
+  put_chunk(out, "IDAT", compressed.data(), compressed_size);
+  put_chunk(out, "IEND", nullptr, 0);
+  return true;
+}
+
+bool write_png(const std::string &path, int width, int height,
+               std::span<const uint8_t> rgba, int compression_level) {
+  std::vector<uint8_t> png;
+  if (!encode_png(width, height, rgba, png, compression_level)) {
+    std::cout << "Failed to encode " << path << std::endl;
+    return false;
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(png.data()),
+             static_cast<std::streamsize>(png.size()));
+  if (!file) {
+    std::cout << "Failed to write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
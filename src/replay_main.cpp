@@ -0,0 +1,399 @@
+// simple-paint-replay: plays an input log recorded with
+// `simple-paint --record` back into the app, and reports frame times.
+//
+//   simple-paint-replay <input log> [--timestep S] [--headless]
+//                       [--document PATH] [--csv PATH] [--predict-ms MS]
+//
+// Frame i renders at log time (i + 1) * timestep, after every event
+// recorded before then, and advances the app by exactly one timestep. Runs
+// get the same input in the same frames, so a recorded session works as a
+// benchmark. Each frame is timed twice: on the CPU, and after glFinish(),
+// so GPU work is included.
+//
+// The app draws into a scratch document (replay.spd, next to the log) that
+// is reset first: to a copy of --document, or to an empty canvas. The
+// document being replayed is never modified. --headless renders into a
+// framebuffer object on an EGL context, with no window or display server.
+// --predict-ms sets the horizon of the predicted stroke tail (0 turns it
+// off); its error against the recorded samples is reported at the end.
+
+#include "frame_profiler.h"
+#include "input_log.h"
+#include "paint.h"
+
+#include <glad/gl.h>
+
+#include <GLFW/glfw3.h>
+
+#if SIMPLE_PAINT_HAS_EGL
+#include "offscreen_context.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char *SCRATCH_DOCUMENT = "replay.spd";
+const char *JOURNAL_EXTENSION = ".journal"; // See StrokeJournal
+
+// Slowest frames listed in the report
+constexpr size_t WORST_FRAME_COUNT = 5;
+
+struct Options {
+  fs::path log;
+  fs::path document; // Starting canvas; empty for a blank one
+  fs::path csv;
+  double timestep = 1.0 / 60.0;
+  double predict_ms = -1.0; // Negative keeps the app's default
+  bool headless = false;
+};
+
+struct FrameTiming {
+  double time;   // Log time the frame renders at, in seconds
+  size_t events; // Dispatched before it
+  double cpu_ms; // Events and render()
+  double gpu_ms; // The same, until glFinish() returns
+};
+
+void print_usage() {
+  std::cout << "usage: simple-paint-replay <input log> [--timestep S] "
+               "[--headless] [--document PATH] [--csv PATH] "
+               "[--predict-ms MS]"
+            << std::endl;
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--timestep" && has_value) {
+      options.timestep = std::atof(argv[++i]);
+      if (options.timestep <= 0.0)
+        return false;
+    } else if (arg == "--document" && has_value) {
+      options.document = argv[++i];
+    } else if (arg == "--csv" && has_value) {
+      options.csv = argv[++i];
+    } else if (arg == "--predict-ms" && has_value) {
+      options.predict_ms = std::atof(argv[++i]);
+      if (options.predict_ms < 0.0)
+        return false;
+    } else if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg.starts_with("--")) {
+      return false;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 1)
+    return false;
+
+  options.log = positional[0];
+  return true;
+}
+
+// Replaces the scratch document (and its journal) with a copy of
+// `document`, or removes it for an empty canvas
+bool reset_document(const fs::path &scratch, const fs::path &document) {
+  fs::path scratch_journal = scratch.string() + JOURNAL_EXTENSION;
+  std::error_code error;
+  fs::remove(scratch, error);
+  fs::remove(scratch_journal, error);
+  if (document.empty())
+    return true;
+
+  fs::path journal = document.string() + JOURNAL_EXTENSION;
+  bool copied = fs::copy_file(document, scratch, error);
+  if (copied && fs::exists(journal))
+    copied = fs::copy_file(journal, scratch_journal, error);
+  if (!copied) {
+    std::cout << "Failed to copy " << document << ": " << error.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+GLFWwindow *create_window(int width, int height) {
+  if (!glfwInit())
+    return nullptr;
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+  // The log decides the size
+  glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+  GLFWwindow *window =
+      glfwCreateWindow(width, height, "Simple Paint (replay)", NULL, NULL);
+  if (!window)
+    return nullptr;
+  glfwMakeContextCurrent(window);
+
+  // Frames are timed, not paced
+  glfwSwapInterval(0);
+
+  if (!gladLoadGL((GLADloadfunc)glfwGetProcAddress)) {
+    glfwDestroyWindow(window);
+    return nullptr;
+  }
+  return window;
+}
+
+// The framebuffer headless frames render into
+class RenderTarget {
+  GLuint m_fbo = 0;
+  GLuint m_color = 0;
+
+public:
+  RenderTarget() { glCreateFramebuffers(1, &m_fbo); }
+  ~RenderTarget() {
+    glDeleteTextures(1, &m_color);
+    glDeleteFramebuffers(1, &m_fbo);
+  }
+
+  RenderTarget(const RenderTarget &) = delete;
+  RenderTarget &operator=(const RenderTarget &) = delete;
+
+  void resize(int width, int height) {
+    glDeleteTextures(1, &m_color);
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_color);
+    glTextureStorage2D(m_color, 1, GL_RGBA8, std::max(width, 1),
+                       std::max(height, 1));
+    glNamedFramebufferTexture(m_fbo, GL_COLOR_ATTACHMENT0, m_color, 0);
+  }
+
+  void bind() const { glBindFramebuffer(GL_FRAMEBUFFER, m_fbo); }
+};
+
+double percentile(std::vector<double> values, double fraction) {
+  if (values.empty())
+    return 0.0;
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(
+      fraction * static_cast<double>(values.size() - 1))];
+}
+
+void print_summary(const char *label, const std::vector<double> &values) {
+  double sum = 0.0;
+  for (double value : values)
+    sum += value;
+  double mean =
+      values.empty() ? 0.0 : sum / static_cast<double>(values.size());
+  std::cout << label << ": mean " << mean << " ms, p50 "
+            << percentile(values, 0.50) << ", p95 " << percentile(values, 0.95)
+            << ", p99 " << percentile(values, 0.99) << ", max "
+            << percentile(values, 1.0) << std::endl;
+}
+
+void print_report(const std::vector<FrameTiming> &frames, double timestep,
+                  double elapsed) {
+  std::vector<double> cpu, gpu;
+  size_t over_budget = 0;
+  for (const FrameTiming &frame : frames) {
+    cpu.push_back(frame.cpu_ms);
+    gpu.push_back(frame.gpu_ms);
+    if (frame.gpu_ms > timestep * 1000.0)
+      over_budget++;
+  }
+
+  std::cout << "replayed " << frames.size() << " frames in " << elapsed
+            << " s (" << timestep * 1000.0 << " ms timestep)" << std::endl;
+  print_summary("cpu", cpu);
+  print_summary("cpu+gpu", gpu);
+  std::cout << over_budget << " frames over the timestep" << std::endl;
+
+  std::vector<size_t> order(frames.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  size_t worst = std::min(WORST_FRAME_COUNT, order.size());
+  std::partial_sort(order.begin(), order.begin() + worst, order.end(),
+                    [&frames](size_t a, size_t b) {
+                      return frames[a].gpu_ms > frames[b].gpu_ms;
+                    });
+  for (size_t i = 0; i < worst; ++i) {
+    const FrameTiming &frame = frames[order[i]];
+    std::cout << "  frame " << order[i] << " at " << frame.time << " s: "
+              << frame.gpu_ms << " ms (cpu " << frame.cpu_ms << " ms, "
+              << frame.events << " events)" << std::endl;
+  }
+}
+
+bool write_csv(const fs::path &path, const std::vector<FrameTiming> &frames) {
+  std::ofstream out(path);
+  out << "frame,time,events,cpu_ms,gpu_ms\n";
+  for (size_t i = 0; i < frames.size(); ++i) {
+    const FrameTiming &frame = frames[i];
+    out << i << ',' << frame.time << ',' << frame.events << ','
+        << frame.cpu_ms << ',' << frame.gpu_ms << '\n';
+  }
+  out.close();
+  if (!out) {
+    std::cout << "Failed to write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  // 1. The log, and a canvas in the state it was recorded against
+  InputLog log;
+  if (!InputLog::read(options.log.string(), log))
+    return EXIT_FAILURE;
+  if (log.width <= 0 || log.height <= 0) {
+    std::cout << "Bad framebuffer size in " << options.log << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  fs::path scratch = options.log.parent_path() / SCRATCH_DOCUMENT;
+  if (!reset_document(scratch, options.document))
+    return EXIT_FAILURE;
+
+  // 2. A context: a window, or an offscreen one. The app reads GLFW's
+  // clock for its own logs, so headless runs initialize it too (where
+  // that fails, those logs show zero times).
+  GLFWwindow *window = nullptr;
+#if SIMPLE_PAINT_HAS_EGL
+  std::unique_ptr<OffscreenContext> context;
+#endif
+  if (options.headless) {
+#if SIMPLE_PAINT_HAS_EGL
+    glfwInit();
+    context = OffscreenContext::create();
+    if (!context)
+      return EXIT_FAILURE;
+    std::cout << "replaying headless on " << context->get_description()
+              << std::endl;
+#else
+    std::cout << "Built without EGL; --headless is not available"
+              << std::endl;
+    return EXIT_FAILURE;
+#endif
+  } else {
+    window = create_window(log.width, log.height);
+    if (!window) {
+      std::cout << "Failed to create a window" << std::endl;
+      glfwTerminate();
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<FrameTiming> frames;
+  auto start = std::chrono::steady_clock::now();
+  {
+    // 3. The app takes no live input; events come from the log only
+    std::unique_ptr<RenderTarget> target;
+    if (options.headless)
+      target = std::make_unique<RenderTarget>();
+
+    std::string document = scratch.string();
+    PaintApp app(nullptr, document.c_str());
+    if (options.predict_ms >= 0.0)
+      app.set_prediction_horizon(options.predict_ms * 1e-3);
+
+    InputEvent initial_size = {InputEvent::Type::Resize};
+    initial_size.value = {log.width, log.height};
+    if (target)
+      target->resize(log.width, log.height);
+    app.handle_input(initial_size);
+
+    // 4. One frame per timestep until the last event has been handled
+    double duration = log.events.empty() ? 0.0 : log.events.back().time;
+    size_t frame_count =
+        static_cast<size_t>(std::floor(duration / options.timestep)) + 1;
+    frames.reserve(frame_count);
+
+    size_t next = 0;
+    for (size_t i = 0; i < frame_count; ++i) {
+      FrameTiming frame = {};
+      frame.time = static_cast<double>(i + 1) * options.timestep;
+      auto frame_start = std::chrono::steady_clock::now();
+
+      {
+        PROFILE_ZONE("replay input");
+        for (; next < log.events.size() && log.events[next].time < frame.time;
+             ++next) {
+          const InputEvent &event = log.events[next];
+          if (event.type == InputEvent::Type::Resize) {
+            int width = static_cast<int>(event.value.x);
+            int height = static_cast<int>(event.value.y);
+            if (target)
+              target->resize(width, height);
+            else
+              glfwSetWindowSize(window, width, height);
+          }
+          app.handle_input(event);
+          frame.events++;
+        }
+      }
+      {
+        PROFILE_ZONE("render");
+        if (target)
+          target->bind();
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        app.render(options.timestep);
+      }
+      frame.cpu_ms = elapsed_ms(frame_start);
+
+      glFinish();
+      frame.gpu_ms = elapsed_ms(frame_start);
+      frames.push_back(frame);
+
+      if (window) {
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+        if (glfwWindowShouldClose(window))
+          break;
+      }
+      PROFILE_FRAME();
+    }
+    app.print_prediction_stats();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  // 5. Report
+  print_report(frames, options.timestep, elapsed.count());
+  bool written = options.csv.empty() || write_csv(options.csv, frames);
+
+#if SIMPLE_PAINT_HAS_EGL
+  context.reset();
+#endif
+  if (window)
+    glfwDestroyWindow(window);
+  glfwTerminate();
+  return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,531 @@
+#include "ribbon_kernel.h"
+#include "geometry.h"
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RIBBON_HAS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RIBBON_TARGET_AVX2
+#else
+#define RIBBON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define RIBBON_HAS_X86 0
+#endif
+
+namespace {
+
+constexpr double MIN_MITER_DOT = 0.1;
+
+int16_t quantize_snorm16(double value) {
+  double q = glm::clamp(value * 32767.0, -32767.0, 32767.0);
+  return static_cast<int16_t>(std::lrint(q));
+}
+
+void write_pair(PointVertex *out, double lx, double ly, double rx, double ry,
+                const RibbonParams &params) {
+  write_ribbon_pair(out, {lx, ly}, {rx, ry}, 0, params);
+}
+
+// Reference implementation; the SIMD paths below follow the same operation
+// order so they agree with it to the last few ulps.
+void joins_scalar(const glm::dvec2 *points, size_t begin, size_t end,
+                  const RibbonParams &params, double *lengths,
+                  PointVertex *out, AABB &bounds) {
+  double radius = params.thickness / 2.0;
+  double miter_limit = radius * 4.0;
+
+  for (size_t i = begin; i < end; ++i) {
+    glm::dvec2 prev = points[i - 1];
+    glm::dvec2 curr = points[i];
+    glm::dvec2 next = points[i + 1];
+
+    glm::dvec2 d1 = curr - prev;
+    glm::dvec2 d2 = next - curr;
+    double len1 = std::sqrt(d1.x * d1.x + d1.y * d1.y);
+    double len2 = std::sqrt(d2.x * d2.x + d2.y * d2.y);
+    lengths[i] = lengths[i - 1] + len1;
+
+    glm::dvec2 t1 = d1 * (1.0 / len1);
+    glm::dvec2 t2 = d2 * (1.0 / len2);
+    glm::dvec2 m(-(t1.y + t2.y), t1.x + t2.x);
+    glm::dvec2 miter = m * (1.0 / std::sqrt(m.x * m.x + m.y * m.y));
+
+    double dot = miter.x * -t1.y + miter.y * t1.x;
+    double length = radius / glm::max(MIN_MITER_DOT, dot);
+    if (length > miter_limit)
+      length = miter_limit;
+
+    glm::dvec2 offset = miter * length;
+    glm::dvec2 left = curr + offset;
+    glm::dvec2 right = curr - offset;
+
+    bounds.min = glm::min(bounds.min, glm::min(left, right));
+    bounds.max = glm::max(bounds.max, glm::max(left, right));
+
+    write_pair(out + 2 * (i - begin), left.x, left.y, right.x, right.y,
+               params);
+  }
+}
+
+// Reference distance kernel over segments [first, count - 1), continuing
+// from `best`. Degenerate segments divide by DBL_MIN instead of zero, like
+// the SIMD paths.
+double distance_scalar(const glm::dvec2 *points, size_t first, size_t count,
+                       glm::dvec2 point, double stop_below, double best) {
+  for (size_t i = first; i + 1 < count; ++i) {
+    glm::dvec2 d = points[i + 1] - points[i];
+    glm::dvec2 f = point - points[i];
+    double dd = glm::max(d.x * d.x + d.y * d.y, DBL_MIN);
+    double t = glm::clamp((f.x * d.x + f.y * d.y) / dd, 0.0, 1.0);
+    glm::dvec2 e = f - d * t;
+    best = glm::min(best, e.x * e.x + e.y * e.y);
+    if (best <= stop_below)
+      break;
+  }
+  return best;
+}
+
+#if RIBBON_HAS_X86
+
+// --- SSE2: two points per iteration ---
+
+void joins_sse2(const glm::dvec2 *points, size_t begin, size_t end,
+                const RibbonParams &params, double *lengths, PointVertex *out,
+                AABB &bounds) {
+  const double *p = &points[0].x;
+  const __m128d radius = _mm_set1_pd(params.thickness / 2.0);
+  const __m128d miter_limit = _mm_set1_pd(params.thickness / 2.0 * 4.0);
+  const __m128d min_dot = _mm_set1_pd(MIN_MITER_DOT);
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d zero = _mm_setzero_pd();
+
+  __m128d min_x = _mm_set1_pd(bounds.min.x);
+  __m128d min_y = _mm_set1_pd(bounds.min.y);
+  __m128d max_x = _mm_set1_pd(bounds.max.x);
+  __m128d max_y = _mm_set1_pd(bounds.max.y);
+
+  size_t i = begin;
+  for (; i + 2 <= end; i += 2) {
+    // Points i-1 .. i+2, deinterleaved into (x, y) lanes
+    __m128d a = _mm_loadu_pd(p + 2 * (i - 1));
+    __m128d b = _mm_loadu_pd(p + 2 * i);
+    __m128d c = _mm_loadu_pd(p + 2 * (i + 1));
+    __m128d d = _mm_loadu_pd(p + 2 * (i + 2));
+
+    __m128d prev_x = _mm_unpacklo_pd(a, b), prev_y = _mm_unpackhi_pd(a, b);
+    __m128d curr_x = _mm_unpacklo_pd(b, c), curr_y = _mm_unpackhi_pd(b, c);
+    __m128d next_x = _mm_unpacklo_pd(c, d), next_y = _mm_unpackhi_pd(c, d);
+
+    // 1. Tangents and segment lengths
+    __m128d d1x = _mm_sub_pd(curr_x, prev_x), d1y = _mm_sub_pd(curr_y, prev_y);
+    __m128d d2x = _mm_sub_pd(next_x, curr_x), d2y = _mm_sub_pd(next_y, curr_y);
+    __m128d len1 = _mm_sqrt_pd(
+        _mm_add_pd(_mm_mul_pd(d1x, d1x), _mm_mul_pd(d1y, d1y)));
+    __m128d len2 = _mm_sqrt_pd(
+        _mm_add_pd(_mm_mul_pd(d2x, d2x), _mm_mul_pd(d2y, d2y)));
+    __m128d inv1 = _mm_div_pd(one, len1);
+    __m128d inv2 = _mm_div_pd(one, len2);
+    __m128d t1x = _mm_mul_pd(d1x, inv1), t1y = _mm_mul_pd(d1y, inv1);
+    __m128d t2x = _mm_mul_pd(d2x, inv2), t2y = _mm_mul_pd(d2y, inv2);
+
+    // 2. Running arc length: inclusive prefix sum of len1
+    __m128d base = _mm_set1_pd(lengths[i - 1]);
+    __m128d scan = _mm_add_pd(len1, _mm_unpacklo_pd(zero, len1));
+    __m128d v = _mm_add_pd(base, scan);
+    _mm_storeu_pd(lengths + i, v);
+
+    // 3. Miter direction and clamped length
+    __m128d mx = _mm_sub_pd(zero, _mm_add_pd(t1y, t2y));
+    __m128d my = _mm_add_pd(t1x, t2x);
+    __m128d minv = _mm_div_pd(
+        one, _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(mx, mx), _mm_mul_pd(my, my))));
+    mx = _mm_mul_pd(mx, minv);
+    my = _mm_mul_pd(my, minv);
+
+    __m128d dot = _mm_add_pd(_mm_mul_pd(mx, _mm_sub_pd(zero, t1y)),
+                             _mm_mul_pd(my, t1x));
+    __m128d length = _mm_div_pd(radius, _mm_max_pd(min_dot, dot));
+    length = _mm_min_pd(length, miter_limit);
+
+    // 4. Ribbon edges and bounds
+    __m128d ox = _mm_mul_pd(mx, length), oy = _mm_mul_pd(my, length);
+    __m128d lx = _mm_add_pd(curr_x, ox), ly = _mm_add_pd(curr_y, oy);
+    __m128d rx = _mm_sub_pd(curr_x, ox), ry = _mm_sub_pd(curr_y, oy);
+
+    min_x = _mm_min_pd(min_x, _mm_min_pd(lx, rx));
+    min_y = _mm_min_pd(min_y, _mm_min_pd(ly, ry));
+    max_x = _mm_max_pd(max_x, _mm_max_pd(lx, rx));
+    max_y = _mm_max_pd(max_y, _mm_max_pd(ly, ry));
+
+    alignas(16) double l_x[2], l_y[2], r_x[2], r_y[2];
+    _mm_store_pd(l_x, lx);
+    _mm_store_pd(l_y, ly);
+    _mm_store_pd(r_x, rx);
+    _mm_store_pd(r_y, ry);
+
+    for (int k = 0; k < 2; ++k)
+      write_pair(out + 2 * (i + k - begin), l_x[k], l_y[k], r_x[k], r_y[k],
+                 params);
+  }
+
+  alignas(16) double lanes[2];
+  _mm_store_pd(lanes, min_x);
+  bounds.min.x = glm::min(lanes[0], lanes[1]);
+  _mm_store_pd(lanes, min_y);
+  bounds.min.y = glm::min(lanes[0], lanes[1]);
+  _mm_store_pd(lanes, max_x);
+  bounds.max.x = glm::max(lanes[0], lanes[1]);
+  _mm_store_pd(lanes, max_y);
+  bounds.max.y = glm::max(lanes[0], lanes[1]);
+
+  joins_scalar(points, i, end, params, lengths, out + 2 * (i - begin),
+               bounds);
+}
+
+// --- AVX2: four points per iteration ---
+
+RIBBON_TARGET_AVX2 inline void load_xy4(const double *p, __m256d &x,
+                                        __m256d &y) {
+  // [x0 y0 x1 y1] [x2 y2 x3 y3] -> [x0 x1 x2 x3] [y0 y1 y2 y3]
+  __m256d a = _mm256_loadu_pd(p);
+  __m256d b = _mm256_loadu_pd(p + 4);
+  x = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+  y = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+RIBBON_TARGET_AVX2 inline double hmin4(__m256d v) {
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, v);
+  return glm::min(glm::min(lanes[0], lanes[1]), glm::min(lanes[2], lanes[3]));
+}
+
+RIBBON_TARGET_AVX2 inline double hmax4(__m256d v) {
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, v);
+  return glm::max(glm::max(lanes[0], lanes[1]), glm::max(lanes[2], lanes[3]));
+}
+
+RIBBON_TARGET_AVX2 void joins_avx2(const glm::dvec2 *points, size_t begin,
+                                   size_t end, const RibbonParams &params,
+                                   double *lengths, PointVertex *out,
+                                   AABB &bounds) {
+  const double *p = &points[0].x;
+  const __m256d radius = _mm256_set1_pd(params.thickness / 2.0);
+  const __m256d miter_limit = _mm256_set1_pd(params.thickness / 2.0 * 4.0);
+  const __m256d min_dot = _mm256_set1_pd(MIN_MITER_DOT);
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d zero = _mm256_setzero_pd();
+
+  __m256d min_x = _mm256_set1_pd(bounds.min.x);
+  __m256d min_y = _mm256_set1_pd(bounds.min.y);
+  __m256d max_x = _mm256_set1_pd(bounds.max.x);
+  __m256d max_y = _mm256_set1_pd(bounds.max.y);
+
+  double base = lengths[begin - 1];
+
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m256d prev_x, prev_y, curr_x, curr_y, next_x, next_y;
+    load_xy4(p + 2 * (i - 1), prev_x, prev_y);
+    load_xy4(p + 2 * i, curr_x, curr_y);
+    load_xy4(p + 2 * (i + 1), next_x, next_y);
+
+    // 1. Tangents and segment lengths
+    __m256d d1x = _mm256_sub_pd(curr_x, prev_x);
+    __m256d d1y = _mm256_sub_pd(curr_y, prev_y);
+    __m256d d2x = _mm256_sub_pd(next_x, curr_x);
+    __m256d d2y = _mm256_sub_pd(next_y, curr_y);
+    __m256d len1 = _mm256_sqrt_pd(
+        _mm256_add_pd(_mm256_mul_pd(d1x, d1x), _mm256_mul_pd(d1y, d1y)));
+    __m256d len2 = _mm256_sqrt_pd(
+        _mm256_add_pd(_mm256_mul_pd(d2x, d2x), _mm256_mul_pd(d2y, d2y)));
+    __m256d inv1 = _mm256_div_pd(one, len1);
+    __m256d inv2 = _mm256_div_pd(one, len2);
+    __m256d t1x = _mm256_mul_pd(d1x, inv1), t1y = _mm256_mul_pd(d1y, inv1);
+    __m256d t2x = _mm256_mul_pd(d2x, inv2), t2y = _mm256_mul_pd(d2y, inv2);
+
+    // 2. Running arc length: inclusive prefix sum of len1 across lanes
+    __m256d shift1 = _mm256_blend_pd(
+        _mm256_permute4x64_pd(len1, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x1);
+    __m256d scan = _mm256_add_pd(len1, shift1);
+    __m256d shift2 = _mm256_blend_pd(
+        _mm256_permute4x64_pd(scan, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x3);
+    scan = _mm256_add_pd(scan, shift2);
+    __m256d v = _mm256_add_pd(_mm256_set1_pd(base), scan);
+    _mm256_storeu_pd(lengths + i, v);
+    base = lengths[i + 3];
+
+    // 3. Miter direction and clamped length
+    __m256d mx = _mm256_sub_pd(zero, _mm256_add_pd(t1y, t2y));
+    __m256d my = _mm256_add_pd(t1x, t2x);
+    __m256d minv = _mm256_div_pd(
+        one, _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(mx, mx),
+                                          _mm256_mul_pd(my, my))));
+    mx = _mm256_mul_pd(mx, minv);
+    my = _mm256_mul_pd(my, minv);
+
+    __m256d dot = _mm256_add_pd(_mm256_mul_pd(mx, _mm256_sub_pd(zero, t1y)),
+                                _mm256_mul_pd(my, t1x));
+    __m256d length = _mm256_div_pd(radius, _mm256_max_pd(min_dot, dot));
+    length = _mm256_min_pd(length, miter_limit);
+
+    // 4. Ribbon edges and bounds
+    __m256d ox = _mm256_mul_pd(mx, length), oy = _mm256_mul_pd(my, length);
+    __m256d lx = _mm256_add_pd(curr_x, ox), ly = _mm256_add_pd(curr_y, oy);
+    __m256d rx = _mm256_sub_pd(curr_x, ox), ry = _mm256_sub_pd(curr_y, oy);
+
+    min_x = _mm256_min_pd(min_x, _mm256_min_pd(lx, rx));
+    min_y = _mm256_min_pd(min_y, _mm256_min_pd(ly, ry));
+    max_x = _mm256_max_pd(max_x, _mm256_max_pd(lx, rx));
+    max_y = _mm256_max_pd(max_y, _mm256_max_pd(ly, ry));
+
+    alignas(32) double l_x[4], l_y[4], r_x[4], r_y[4];
+    _mm256_store_pd(l_x, lx);
+    _mm256_store_pd(l_y, ly);
+    _mm256_store_pd(r_x, rx);
+    _mm256_store_pd(r_y, ry);
+
+    for (int k = 0; k < 4; ++k)
+      write_pair(out + 2 * (i + k - begin), l_x[k], l_y[k], r_x[k], r_y[k],
+                 params);
+  }
+
+  bounds.min = {hmin4(min_x), hmin4(min_y)};
+  bounds.max = {hmax4(max_x), hmax4(max_y)};
+
+  joins_scalar(points, i, end, params, lengths, out + 2 * (i - begin),
+               bounds);
+}
+
+// SSE2 distance kernel: two segments per iteration
+double distance_sse2(const glm::dvec2 *points, size_t first, size_t count,
+                     glm::dvec2 point, double stop_below, double best) {
+  const double *p = &points[0].x;
+  const __m128d px = _mm_set1_pd(point.x), py = _mm_set1_pd(point.y);
+  const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+  const __m128d tiny = _mm_set1_pd(DBL_MIN);
+  const __m128d stop = _mm_set1_pd(stop_below);
+  __m128d nearest = _mm_set1_pd(best);
+
+  size_t i = first;
+  for (; i + 3 <= count; i += 2) {
+    __m128d a = _mm_loadu_pd(p + 2 * i);
+    __m128d b = _mm_loadu_pd(p + 2 * (i + 1));
+    __m128d c = _mm_loadu_pd(p + 2 * (i + 2));
+    __m128d ax = _mm_unpacklo_pd(a, b), ay = _mm_unpackhi_pd(a, b);
+    __m128d bx = _mm_unpacklo_pd(b, c), by = _mm_unpackhi_pd(b, c);
+
+    __m128d dx = _mm_sub_pd(bx, ax), dy = _mm_sub_pd(by, ay);
+    __m128d fx = _mm_sub_pd(px, ax), fy = _mm_sub_pd(py, ay);
+    __m128d dd = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+    __m128d fd = _mm_add_pd(_mm_mul_pd(fx, dx), _mm_mul_pd(fy, dy));
+    __m128d t = _mm_div_pd(fd, _mm_max_pd(dd, tiny));
+    t = _mm_min_pd(_mm_max_pd(t, zero), one);
+
+    __m128d ex = _mm_sub_pd(fx, _mm_mul_pd(dx, t));
+    __m128d ey = _mm_sub_pd(fy, _mm_mul_pd(dy, t));
+    __m128d dist = _mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey));
+    nearest = _mm_min_pd(nearest, dist);
+    if (_mm_movemask_pd(_mm_cmple_pd(dist, stop)))
+      break;
+  }
+
+  alignas(16) double lanes[2];
+  _mm_store_pd(lanes, nearest);
+  best = glm::min(lanes[0], lanes[1]);
+  if (best <= stop_below)
+    return best;
+  return distance_scalar(points, i, count, point, stop_below, best);
+}
+
+// AVX2 distance kernel: four segments per iteration
+RIBBON_TARGET_AVX2 double distance_avx2(const glm::dvec2 *points,
+                                        size_t first, size_t count,
+                                        glm::dvec2 point, double stop_below,
+                                        double best) {
+  const double *p = &points[0].x;
+  const __m256d px = _mm256_set1_pd(point.x), py = _mm256_set1_pd(point.y);
+  const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+  const __m256d tiny = _mm256_set1_pd(DBL_MIN);
+  const __m256d stop = _mm256_set1_pd(stop_below);
+  __m256d nearest = _mm256_set1_pd(best);
+
+  size_t i = first;
+  for (; i + 5 <= count; i += 4) {
+    __m256d ax, ay, bx, by;
+    load_xy4(p + 2 * i, ax, ay);
+    load_xy4(p + 2 * (i + 1), bx, by);
+
+    __m256d dx = _mm256_sub_pd(bx, ax), dy = _mm256_sub_pd(by, ay);
+    __m256d fx = _mm256_sub_pd(px, ax), fy = _mm256_sub_pd(py, ay);
+    __m256d dd = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    __m256d fd = _mm256_add_pd(_mm256_mul_pd(fx, dx), _mm256_mul_pd(fy, dy));
+    __m256d t = _mm256_div_pd(fd, _mm256_max_pd(dd, tiny));
+    t = _mm256_min_pd(_mm256_max_pd(t, zero), one);
+
+    __m256d ex = _mm256_sub_pd(fx, _mm256_mul_pd(dx, t));
+    __m256d ey = _mm256_sub_pd(fy, _mm256_mul_pd(dy, t));
+    __m256d dist = _mm256_add_pd(_mm256_mul_pd(ex, ex), _mm256_mul_pd(ey, ey));
+    nearest = _mm256_min_pd(nearest, dist);
+    if (_mm256_movemask_pd(_mm256_cmp_pd(dist, stop, _CMP_LE_OQ)))
+      break;
+  }
+
+  best = hmin4(nearest);
+  if (best <= stop_below)
+    return best;
+  return distance_scalar(points, i, count, point, stop_below, best);
+}
+
+#endif // RIBBON_HAS_X86
+
+using DistanceFn = double (*)(const glm::dvec2 *, size_t, size_t, glm::dvec2,
+                              double, double);
+
+DistanceFn distance_for(SimdLevel level) {
+#if RIBBON_HAS_X86
+  switch (level) {
+  case SimdLevel::AVX2:
+    return distance_avx2;
+  case SimdLevel::SSE2:
+    return distance_sse2;
+  case SimdLevel::Scalar:
+    break;
+  }
+#endif
+  return distance_scalar;
+}
+
+double distance_with(DistanceFn distance, const glm::dvec2 *points,
+                     size_t count, glm::dvec2 point, double stop_below) {
+  if (count == 0)
+    return std::numeric_limits<double>::infinity();
+  if (count == 1) {
+    glm::dvec2 e = point - points[0];
+    return e.x * e.x + e.y * e.y;
+  }
+  return distance(points, 0, count, point, stop_below,
+                  std::numeric_limits<double>::infinity());
+}
+
+using JoinsFn = void (*)(const glm::dvec2 *, size_t, size_t,
+                         const RibbonParams &, double *, PointVertex *,
+                         AABB &);
+
+// Forced levels are capped to what the CPU supports; running the AVX2 path
+// on a CPU without it would fault
+SimdLevel supported_level(SimdLevel level) {
+  static const SimdLevel detected = detect_simd_level();
+  return std::min(level, detected);
+}
+
+JoinsFn joins_for(SimdLevel level) {
+#if RIBBON_HAS_X86
+  switch (level) {
+  case SimdLevel::AVX2:
+    return joins_avx2;
+  case SimdLevel::SSE2:
+    return joins_sse2;
+  case SimdLevel::Scalar:
+    break;
+  }
+#endif
+  return joins_scalar;
+}
+
+} // namespace
+
+void write_ribbon_pair(PointVertex *out, glm::dvec2 left, glm::dvec2 right,
+                       int cap, const RibbonParams &params) {
+  double scale = 1.0 / params.extent;
+  int8_t cap_q = static_cast<int8_t>(cap * 127);
+
+  out[0] = {{quantize_snorm16((left.x - params.origin.x) * scale),
+             quantize_snorm16((left.y - params.origin.y) * scale)},
+            0,
+            cap_q,
+            0};
+  out[1] = {{quantize_snorm16((right.x - params.origin.x) * scale),
+             quantize_snorm16((right.y - params.origin.y) * scale)},
+            255,
+            cap_q,
+            0};
+}
+
+SimdLevel detect_simd_level() {
+#if RIBBON_HAS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] >= 7) {
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (avx2 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+      return SimdLevel::AVX2;
+  }
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SimdLevel::AVX2;
+#endif
+  // SSE2 is part of the x86-64 baseline
+  return SimdLevel::SSE2;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+const char *simd_level_name(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::AVX2:
+    return "AVX2";
+  case SimdLevel::SSE2:
+    return "SSE2";
+  case SimdLevel::Scalar:
+    break;
+  }
+  return "Scalar";
+}
+
+void build_ribbon_joins(const glm::dvec2 *points, size_t begin, size_t end,
+                        const RibbonParams &params, double *lengths,
+                        PointVertex *out, AABB &bounds) {
+  // Resolved once on first use
+  static const JoinsFn joins = joins_for(detect_simd_level());
+
+  if (begin < end)
+    joins(points, begin, end, params, lengths, out, bounds);
+}
+
+void build_ribbon_joins(SimdLevel level, const glm::dvec2 *points,
+                        size_t begin, size_t end, const RibbonParams &params,
+                        double *lengths, PointVertex *out, AABB &bounds) {
+  if (begin < end) {
+    joins_for(supported_level(level))(points, begin, end, params, lengths,
+                                      out, bounds);
+  }
+}
+
+double polyline_distance_squared(const glm::dvec2 *points, size_t count,
+                                 glm::dvec2 point, double stop_below) {
+  static const DistanceFn distance = distance_for(detect_simd_level());
+  return distance_with(distance, points, count, point, stop_below);
+}
+
+double polyline_distance_squared(SimdLevel level, const glm::dvec2 *points,
+                                 size_t count, glm::dvec2 point,
+                                 double stop_below) {
+  return distance_with(distance_for(supported_level(level)), points, count,
+                       point, stop_below);
+}
@@ -0,0 +1,487 @@
+#include "software_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RASTER_HAS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RASTER_TARGET_AVX2
+#else
+#define RASTER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define RASTER_HAS_X86 0
+#endif
+
+namespace {
+
+constexpr int TILE = SoftwareRasterizer::TILE_SIZE;
+constexpr int TILE_PIXELS = TILE * TILE;
+
+// Prepared strokes per task
+constexpr size_t PREPARE_GRAIN = 64;
+
+using Segment = SoftwareRasterizer::Segment;
+
+// Reference span kernel; the AVX2 path below follows the same operation
+// order, so both produce the same image.
+void span_scalar(const Segment *segments, size_t count, float y, int begin,
+                 int end, float aspect, float radius, glm::vec3 color,
+                 bool is_eraser, float *r, float *g, float *b, float *a) {
+  for (int x = begin; x < end; ++x) {
+    float px = (static_cast<float>(x) + 0.5f) * aspect;
+
+    // 1. Closest point of the centerline
+    float best = std::numeric_limits<float>::infinity();
+    float best_x = 0.0f, best_y = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+      const Segment &s = segments[i];
+      float fx = px - s.ax;
+      float fy = y - s.ay;
+      float t = (fx * s.dx + fy * s.dy) * s.inv_length2;
+      t = std::min(std::max(t, 0.0f), 1.0f);
+      float ex = fx - s.dx * t;
+      float ey = fy - s.dy * t;
+      float d2 = ex * ex + ey * ey;
+      if (d2 < best) {
+        best = d2;
+        best_x = ex;
+        best_y = ey;
+      }
+    }
+
+    // 2. Coverage as in stroke.frag.glsl, fwidth(dist) being the gradient
+    // (e / |e|) measured per pixel step
+    float dist = std::sqrt(best);
+    float softness = 1.0f;
+    if (dist > 0.0f)
+      softness = (std::abs(best_x) * aspect + std::abs(best_y)) / dist;
+    float edge = radius - softness;
+    float t = (dist - edge) / (radius - edge);
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    float alpha = 1.0f - t * t * (3.0f - 2.0f * t);
+    if (!(alpha > 0.0f))
+      continue;
+
+    // 3. The blend functions of StrokeBatch::apply_blend_mode()
+    float keep = 1.0f - alpha;
+    if (is_eraser) {
+      r[x] = r[x] * keep;
+      g[x] = g[x] * keep;
+      b[x] = b[x] * keep;
+      a[x] = a[x] * keep;
+    } else {
+      r[x] = color.r * alpha + r[x] * keep;
+      g[x] = color.g * alpha + g[x] * keep;
+      b[x] = color.b * alpha + b[x] * keep;
+      a[x] = alpha + a[x] * keep;
+    }
+  }
+}
+
+#if RASTER_HAS_X86
+
+// --- AVX2: eight pixels per iteration ---
+
+RASTER_TARGET_AVX2
+void span_avx2(const Segment *segments, size_t count, float y, int begin,
+               int end, float aspect, float radius, glm::vec3 color,
+               bool is_eraser, float *r, float *g, float *b, float *a) {
+  const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 three = _mm256_set1_ps(3.0f);
+  const __m256 infinity =
+      _mm256_set1_ps(std::numeric_limits<float>::infinity());
+  const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  const __m256 v_aspect = _mm256_set1_ps(aspect);
+  const __m256 v_radius = _mm256_set1_ps(radius);
+
+  int x = begin;
+  for (; x + 8 <= end; x += 8) {
+    __m256 px = _mm256_mul_ps(
+        _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)),
+                                    lanes),
+                      half),
+        v_aspect);
+
+    // 1. Closest point of the centerline
+    __m256 best = infinity;
+    __m256 best_x = zero, best_y = zero;
+    for (size_t i = 0; i < count; ++i) {
+      const Segment &s = segments[i];
+      __m256 dx = _mm256_set1_ps(s.dx);
+      __m256 dy = _mm256_set1_ps(s.dy);
+      __m256 fx = _mm256_sub_ps(px, _mm256_set1_ps(s.ax));
+      __m256 fy = _mm256_set1_ps(y - s.ay);
+      __m256 t = _mm256_mul_ps(
+          _mm256_add_ps(_mm256_mul_ps(fx, dx), _mm256_mul_ps(fy, dy)),
+          _mm256_set1_ps(s.inv_length2));
+      t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+      __m256 ex = _mm256_sub_ps(fx, _mm256_mul_ps(dx, t));
+      __m256 ey = _mm256_sub_ps(fy, _mm256_mul_ps(dy, t));
+      __m256 d2 = _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey));
+
+      __m256 closer = _mm256_cmp_ps(d2, best, _CMP_LT_OQ);
+      best = _mm256_blendv_ps(best, d2, closer);
+      best_x = _mm256_blendv_ps(best_x, ex, closer);
+      best_y = _mm256_blendv_ps(best_y, ey, closer);
+    }
+
+    // 2. Coverage
+    __m256 dist = _mm256_sqrt_ps(best);
+    __m256 gradient =
+        _mm256_add_ps(_mm256_mul_ps(_mm256_and_ps(best_x, abs_mask), v_aspect),
+                      _mm256_and_ps(best_y, abs_mask));
+    __m256 softness =
+        _mm256_blendv_ps(one, _mm256_div_ps(gradient, dist),
+                         _mm256_cmp_ps(dist, zero, _CMP_GT_OQ));
+    __m256 edge = _mm256_sub_ps(v_radius, softness);
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(dist, edge),
+                             _mm256_sub_ps(v_radius, edge));
+    t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+    __m256 alpha = _mm256_sub_ps(
+        one, _mm256_mul_ps(_mm256_mul_ps(t, t),
+                           _mm256_sub_ps(three, _mm256_mul_ps(two, t))));
+
+    __m256 covered = _mm256_cmp_ps(alpha, zero, _CMP_GT_OQ);
+    if (_mm256_movemask_ps(covered) == 0)
+      continue;
+    alpha = _mm256_and_ps(alpha, covered);
+
+    // 3. Blend; uncovered lanes have alpha 0 and keep their value exactly
+    __m256 keep = _mm256_sub_ps(one, alpha);
+    __m256 dst_r = _mm256_loadu_ps(r + x);
+    __m256 dst_g = _mm256_loadu_ps(g + x);
+    __m256 dst_b = _mm256_loadu_ps(b + x);
+    __m256 dst_a = _mm256_loadu_ps(a + x);
+    if (is_eraser) {
+      dst_r = _mm256_mul_ps(dst_r, keep);
+      dst_g = _mm256_mul_ps(dst_g, keep);
+      dst_b = _mm256_mul_ps(dst_b, keep);
+      dst_a = _mm256_mul_ps(dst_a, keep);
+    } else {
+      dst_r = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(color.r), alpha),
+                            _mm256_mul_ps(dst_r, keep));
+      dst_g = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(color.g), alpha),
+                            _mm256_mul_ps(dst_g, keep));
+      dst_b = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(color.b), alpha),
+                            _mm256_mul_ps(dst_b, keep));
+      dst_a = _mm256_add_ps(alpha, _mm256_mul_ps(dst_a, keep));
+    }
+    _mm256_storeu_ps(r + x, dst_r);
+    _mm256_storeu_ps(g + x, dst_g);
+    _mm256_storeu_ps(b + x, dst_b);
+    _mm256_storeu_ps(a + x, dst_a);
+  }
+
+  // A partial group at the end goes through the reference kernel
+  if (x < end) {
+    span_scalar(segments, count, y, x, end, aspect, radius, color, is_eraser,
+                r, g, b, a);
+  }
+}
+
+#endif // RASTER_HAS_X86
+
+uint8_t to_unorm8(float value) {
+  return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+} // namespace
+
+void shade_stroke_span(SimdLevel level, const Segment *segments, size_t count,
+                       float y, int begin, int end, float aspect, float radius,
+                       glm::vec3 color, bool is_eraser, float *r, float *g,
+                       float *b, float *a) {
+#if RASTER_HAS_X86
+  if (level == SimdLevel::AVX2) {
+    span_avx2(segments, count, y, begin, end, aspect, radius, color,
+              is_eraser, r, g, b, a);
+    return;
+  }
+#endif
+  span_scalar(segments, count, y, begin, end, aspect, radius, color,
+              is_eraser, r, g, b, a);
+}
+
+SoftwareRasterizer::SoftwareRasterizer(TaskScheduler &scheduler,
+                                       SimdLevel level)
+    : m_scheduler(scheduler), m_level(level) {
+  if (m_level == SimdLevel::AVX2 && detect_simd_level() != SimdLevel::AVX2)
+    m_level = SimdLevel::Scalar;
+}
+
+bool SoftwareRasterizer::render(std::span<const Stroke> strokes,
+                                const AABB &view, int width, int height,
+                                std::vector<uint8_t> &rgba) {
+  return render_into(strokes, view, width, height, rgba);
+}
+
+bool SoftwareRasterizer::render(std::span<const Stroke> strokes,
+                                const AABB &view, int width, int height,
+                                std::vector<glm::vec4> &rgba) {
+  return render_into(strokes, view, width, height, rgba);
+}
+
+template <typename Pixel>
+bool SoftwareRasterizer::render_into(std::span<const Stroke> strokes,
+                                     const AABB &view, int width, int height,
+                                     std::vector<Pixel> &out) {
+  constexpr bool IS_UNORM8 = std::is_same_v<Pixel, uint8_t>;
+  if (width <= 0 || height <= 0)
+    return false;
+
+  // 1. Image units: one per pixel row, so the stroke radius is in pixels
+  double pixel_size = (view.max.y - view.min.y) / static_cast<double>(height);
+  m_view = view;
+  m_width = width;
+  m_height = height;
+  m_pixel_aspect = static_cast<float>(
+      (view.max.x - view.min.x) / static_cast<double>(width) / pixel_size);
+  prepare(strokes);
+
+  // 2. One task per row of tiles: bin, shade, store
+  int row_count = (height + TILE - 1) / TILE;
+  int column_count = (width + TILE - 1) / TILE;
+  m_rows.resize(row_count);
+  for (std::vector<TileBin> &row : m_rows)
+    row.resize(column_count);
+  out.resize(static_cast<size_t>(width) * height * (IS_UNORM8 ? 4 : 1));
+
+  m_scheduler.parallel_for(0, row_count, 1, [&](size_t first, size_t last) {
+    alignas(32) float tile[4 * TILE_PIXELS];
+    for (size_t row = first; row < last; ++row) {
+      bin_row(static_cast<int>(row));
+
+      int y0 = static_cast<int>(row) * TILE;
+      int rows = std::min(TILE, height - y0);
+      for (int column = 0; column < column_count; ++column) {
+        shade_tile(m_rows[row][column], tile);
+
+        int x0 = column * TILE;
+        int columns = std::min(TILE, width - x0);
+        for (int y = 0; y < rows; ++y) {
+          const float *src = tile + y * TILE;
+          size_t base = static_cast<size_t>(y0 + y) * width + x0;
+          for (int x = 0; x < columns; ++x) {
+            float r = src[x];
+            float g = src[x + TILE_PIXELS];
+            float b = src[x + 2 * TILE_PIXELS];
+            float a = src[x + 3 * TILE_PIXELS];
+            if constexpr (IS_UNORM8) {
+              uint8_t *dst = out.data() + 4 * (base + x);
+              dst[0] = to_unorm8(r);
+              dst[1] = to_unorm8(g);
+              dst[2] = to_unorm8(b);
+              dst[3] = to_unorm8(a);
+            } else {
+              out[base + x] = glm::vec4(r, g, b, a);
+            }
+          }
+        }
+      }
+    }
+  });
+  return true;
+}
+
+void SoftwareRasterizer::prepare(std::span<const Stroke> strokes) {
+  m_prepared.resize(strokes.size());
+  m_scheduler.parallel_for(0, strokes.size(), PREPARE_GRAIN,
+                           [&](size_t first, size_t last) {
+                             for (size_t i = first; i < last; ++i)
+                               prepare_stroke(strokes[i], m_prepared[i]);
+                           });
+}
+
+void SoftwareRasterizer::prepare_stroke(const Stroke &stroke,
+                                        PreparedStroke &prepared) const {
+  prepared.points.clear();
+  prepared.chunks.clear();
+  if (stroke.is_empty() || !stroke.get_bounds().intersects(m_view))
+    return;
+
+  // 1. Centerline in image units
+  static thread_local std::vector<glm::dvec2> storage;
+  std::span<const glm::dvec2> centerline = stroke.get_centerline(storage);
+  if (centerline.empty())
+    return;
+
+  double scale = m_height / (m_view.max.y - m_view.min.y);
+  prepared.points.resize(centerline.size());
+  for (size_t i = 0; i < centerline.size(); ++i)
+    prepared.points[i] = glm::vec2((centerline[i] - m_view.min) * scale);
+
+  prepared.radius = static_cast<float>(stroke.get_thickness() * 0.5 * scale);
+  prepared.color = stroke.get_color();
+  prepared.is_eraser = stroke.is_eraser();
+
+  // 2. Culling boxes over runs of segments, grown by the radius
+  size_t segment_count = std::max<size_t>(prepared.points.size() - 1, 1);
+  size_t last_point = prepared.points.size() - 1;
+  for (size_t first = 0; first < segment_count; first += CHUNK_POINTS) {
+    size_t last = std::min(first + CHUNK_POINTS, last_point);
+    Chunk chunk = {prepared.points[first], prepared.points[first]};
+    for (size_t i = first + 1; i <= last; ++i) {
+      chunk.min = glm::min(chunk.min, prepared.points[i]);
+      chunk.max = glm::max(chunk.max, prepared.points[i]);
+    }
+    chunk.min -= prepared.radius;
+    chunk.max += prepared.radius;
+    prepared.chunks.push_back(chunk);
+  }
+
+  prepared.min = prepared.chunks.front().min;
+  prepared.max = prepared.chunks.front().max;
+  for (const Chunk &chunk : prepared.chunks) {
+    prepared.min = glm::min(prepared.min, chunk.min);
+    prepared.max = glm::max(prepared.max, chunk.max);
+  }
+}
+
+void SoftwareRasterizer::bin_row(int row) {
+  std::vector<TileBin> &bins = m_rows[row];
+  for (TileBin &bin : bins) {
+    bin.segments.clear();
+    bin.extents.clear();
+    bin.runs.clear();
+  }
+
+  int column_count = static_cast<int>(bins.size());
+  float tile_width = TILE * m_pixel_aspect;
+  float band_min = static_cast<float>(row * TILE);
+  float band_max = band_min + TILE;
+  float image_max = column_count * tile_width;
+
+  for (size_t index = 0; index < m_prepared.size(); ++index) {
+    const PreparedStroke &stroke = m_prepared[index];
+    if (stroke.points.empty() || stroke.max.y < band_min ||
+        stroke.min.y > band_max || stroke.max.x < 0.0f ||
+        stroke.min.x > image_max)
+      continue;
+
+    const std::vector<glm::vec2> &points = stroke.points;
+    size_t segment_count = std::max<size_t>(points.size() - 1, 1);
+    float radius = stroke.radius;
+
+    for (size_t c = 0; c < stroke.chunks.size(); ++c) {
+      const Chunk &chunk = stroke.chunks[c];
+      if (chunk.max.y < band_min || chunk.min.y > band_max ||
+          chunk.max.x < 0.0f || chunk.min.x > image_max)
+        continue;
+
+      size_t first = c * CHUNK_POINTS;
+      size_t last = std::min(first + CHUNK_POINTS, segment_count);
+      for (size_t i = first; i < last; ++i) {
+        // A single point is a zero-length segment: a dot
+        glm::vec2 start = points[i];
+        glm::vec2 stop = points.size() > 1 ? points[i + 1] : start;
+        glm::vec2 low = glm::min(start, stop) - radius;
+        glm::vec2 high = glm::max(start, stop) + radius;
+        if (high.y < band_min || low.y > band_max || high.x < 0.0f ||
+            low.x > image_max)
+          continue;
+
+        int first_column = std::max(0, static_cast<int>(low.x / tile_width));
+        int last_column = std::min(column_count - 1,
+                                   static_cast<int>(high.x / tile_width));
+
+        glm::vec2 direction = stop - start;
+        float length2 = glm::dot(direction, direction);
+        float inv_length2 = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+
+        for (int column = first_column; column <= last_column; ++column) {
+          TileBin &bin = bins[column];
+          if (bin.runs.empty() || bin.runs.back().stroke != index) {
+            bin.runs.push_back({static_cast<uint32_t>(index),
+                                static_cast<uint32_t>(bin.segments.size()), 0,
+                                TILE, TILE, -1, -1});
+          }
+
+          // Tile coordinates keep float precision independent of the image
+          glm::vec2 origin(column * tile_width, band_min);
+          glm::vec2 a = start - origin;
+          glm::vec2 local_low = low - origin;
+          glm::vec2 local_high = high - origin;
+          bin.segments.push_back(
+              {a.x, a.y, direction.x, direction.y, inv_length2});
+          bin.extents.push_back(
+              {local_low.x, local_low.y, local_high.x, local_high.y});
+
+          // Pixels whose centers the segment's capsule may reach
+          Run &run = bin.runs.back();
+          run.segment_count++;
+          int min_x = static_cast<int>(
+              std::floor(local_low.x / m_pixel_aspect - 0.5f));
+          int max_x = static_cast<int>(
+              std::ceil(local_high.x / m_pixel_aspect - 0.5f));
+          int min_y = static_cast<int>(std::floor(local_low.y - 0.5f));
+          int max_y = static_cast<int>(std::ceil(local_high.y - 0.5f));
+          run.min_x = std::min(run.min_x, std::max(0, min_x));
+          run.max_x = std::max(run.max_x, std::min(TILE - 1, max_x));
+          run.min_y = std::min(run.min_y, std::max(0, min_y));
+          run.max_y = std::max(run.max_y, std::min(TILE - 1, max_y));
+        }
+      }
+    }
+  }
+}
+
+void SoftwareRasterizer::shade_tile(const TileBin &bin, float *tile) const {
+  std::fill(tile, tile + 4 * TILE_PIXELS, 0.0f);
+  float *r = tile;
+  float *g = tile + TILE_PIXELS;
+  float *b = tile + 2 * TILE_PIXELS;
+  float *a = tile + 3 * TILE_PIXELS;
+
+  static thread_local std::vector<Segment> active;
+  for (const Run &run : bin.runs) {
+    const PreparedStroke &stroke = m_prepared[run.stroke];
+    const Segment *segments = bin.segments.data() + run.first_segment;
+    const glm::vec4 *extents = bin.extents.data() + run.first_segment;
+
+    for (int y = run.min_y; y <= run.max_y; ++y) {
+      float center_y = static_cast<float>(y) + 0.5f;
+
+      // 1. Segments within the radius of this row, and their columns.
+      // Any other segment is further than the radius, where coverage is 0.
+      active.clear();
+      float low_x = std::numeric_limits<float>::max();
+      float high_x = std::numeric_limits<float>::lowest();
+      for (uint32_t i = 0; i < run.segment_count; ++i) {
+        const glm::vec4 &extent = extents[i];
+        if (center_y < extent.y || center_y > extent.w)
+          continue;
+        active.push_back(segments[i]);
+        low_x = std::min(low_x, extent.x);
+        high_x = std::max(high_x, extent.z);
+      }
+      if (active.empty())
+        continue;
+
+      // 2. Whole groups of 8 columns, so AVX2 and scalar agree
+      int begin = std::max(
+          run.min_x, static_cast<int>(std::floor(low_x / m_pixel_aspect)));
+      int end = std::min(
+          run.max_x + 1,
+          static_cast<int>(std::ceil(high_x / m_pixel_aspect)) + 1);
+      begin &= ~7;
+      end = std::min(TILE, (end + 7) & ~7);
+      if (begin >= end)
+        continue;
+
+      int offset = y * TILE;
+      shade_stroke_span(m_level, active.data(), active.size(), center_y,
+                        begin, end, m_pixel_aspect, stroke.radius, stroke.color,
+                        stroke.is_eraser, r + offset, g + offset, b + offset,
+                        a + offset);
+    }
+  }
+}
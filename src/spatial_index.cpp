@@ -0,0 +1,216 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Query costs relative to testing one entry in a linear scan, measured with
+// bench_culling: a hash probe misses cache on large documents, and every
+// candidate pays for its stamp, its bounds and its share of the sort
+constexpr double PROBE_COST = 8.0;
+constexpr double VISIT_COST = 1.5;
+constexpr double SORT_COST = 0.15; // Per candidate and doubling
+
+} // namespace
+
+template <typename Fn>
+void SpatialIndex::for_each_cell(const Level &level, const AABB &bounds,
+                                 Fn &&fn) {
+  int64_t x0 = static_cast<int64_t>(std::floor(bounds.min.x / level.cell_size));
+  int64_t y0 = static_cast<int64_t>(std::floor(bounds.min.y / level.cell_size));
+  int64_t x1 = static_cast<int64_t>(std::floor(bounds.max.x / level.cell_size));
+  int64_t y1 = static_cast<int64_t>(std::floor(bounds.max.y / level.cell_size));
+
+  for (int64_t y = y0; y <= y1; ++y) {
+    for (int64_t x = x0; x <= x1; ++x)
+      fn(cell_key(x, y));
+  }
+}
+
+SpatialIndex::SpatialIndex() {
+  double cell_size = BASE_CELL_SIZE;
+  for (Level &level : m_levels) {
+    level.cell_size = cell_size;
+    cell_size *= CELL_GROWTH;
+  }
+}
+
+void SpatialIndex::insert(uint32_t id, const AABB &bounds) {
+  // Removing the last id shrinks the arrays, so do it before sizing them
+  if (id < m_entries.size() && m_entries[id].level >= 0)
+    remove(id);
+
+  if (id >= m_entries.size()) {
+    m_entries.resize(id + 1);
+    m_bounds.resize(id + 1, empty_bounds());
+    m_visit_stamps.resize(id + 1, 0);
+  }
+
+  Entry &entry = m_entries[id];
+  Level &level = m_levels[level_for(bounds)];
+  m_bounds[id] = bounds;
+  entry.level = static_cast<int>(&level - m_levels);
+  entry.member_index = static_cast<uint32_t>(level.members.size());
+  level.members.push_back(id);
+
+  for_each_cell(level, bounds, [&](uint64_t key) {
+    level.cells[key].push_back(id);
+    level.cell_entries++;
+  });
+  m_size++;
+}
+
+void SpatialIndex::remove(uint32_t id) {
+  if (id >= m_entries.size() || m_entries[id].level < 0)
+    return;
+
+  Entry &entry = m_entries[id];
+  Level &level = m_levels[entry.level];
+
+  // 1. Swap-remove from the level's member list
+  uint32_t moved = level.members.back();
+  level.members[entry.member_index] = moved;
+  m_entries[moved].member_index = entry.member_index;
+  level.members.pop_back();
+
+  // 2. Drop it from every cell it touched
+  for_each_cell(level, m_bounds[id], [&](uint64_t key) {
+    auto it = level.cells.find(key);
+    if (it == level.cells.end())
+      return;
+
+    std::vector<uint32_t> &ids = it->second;
+    ids.erase(std::find(ids.begin(), ids.end(), id));
+    level.cell_entries--;
+    if (ids.empty())
+      level.cells.erase(it);
+  });
+
+  entry.level = -1;
+  m_bounds[id] = empty_bounds();
+  m_size--;
+
+  // Undo removes from the back, so keep the id space tight
+  while (!m_entries.empty() && m_entries.back().level < 0) {
+    m_entries.pop_back();
+    m_bounds.pop_back();
+    m_visit_stamps.pop_back();
+  }
+}
+
+void SpatialIndex::clear() {
+  for (Level &level : m_levels) {
+    level.cells.clear();
+    level.members.clear();
+    level.cell_entries = 0;
+  }
+  m_entries.clear();
+  m_bounds.clear();
+  m_visit_stamps.clear();
+  m_size = 0;
+}
+
+void SpatialIndex::query(const AABB &area, std::vector<uint32_t> &out) {
+  // 1. Estimate the work per level: probing the covered cells and their
+  //    ids, or scanning the members when zoomed far enough out that the
+  //    area spans more cells than the level has entries
+  bool scan_level[LEVEL_COUNT];
+  double probes_total = 0.0;
+  double candidates = 0.0;
+  for (int i = 0; i < LEVEL_COUNT; ++i) {
+    const Level &level = m_levels[i];
+    double members = static_cast<double>(level.members.size());
+    double cells_x = std::floor(area.max.x / level.cell_size) -
+                     std::floor(area.min.x / level.cell_size) + 1.0;
+    double cells_y = std::floor(area.max.y / level.cell_size) -
+                     std::floor(area.min.y / level.cell_size) + 1.0;
+    double probes = cells_x * cells_y;
+
+    scan_level[i] = probes > members;
+    if (scan_level[i]) {
+      candidates += members;
+    } else if (!level.cells.empty()) {
+      double covered = std::min(1.0, probes / level.cells.size());
+      probes_total += probes;
+      candidates += covered * level.cell_entries;
+    }
+  }
+
+  // 2. A scan in id order needs no dedupe or sort, so it wins as soon as
+  //    the candidates cost more than testing every entry. Removed ids have
+  //    empty bounds, so the scan reads nothing but m_bounds
+  double index_cost = probes_total * PROBE_COST + candidates * VISIT_COST +
+                      candidates * std::log2(candidates + 1.0) * SORT_COST;
+  if (index_cost >= static_cast<double>(m_size)) {
+    for (uint32_t id = 0; id < m_bounds.size(); ++id) {
+      if (m_bounds[id].intersects(area))
+        out.push_back(id);
+    }
+    return;
+  }
+
+  // A fresh stamp marks ids already reported by this query
+  if (++m_stamp == 0) {
+    std::fill(m_visit_stamps.begin(), m_visit_stamps.end(), 0);
+    m_stamp = 1;
+  }
+
+  size_t first = out.size();
+  auto visit = [&](uint32_t id) {
+    if (m_visit_stamps[id] == m_stamp)
+      return;
+    m_visit_stamps[id] = m_stamp;
+
+    if (m_bounds[id].intersects(area))
+      out.push_back(id);
+  };
+
+  // 3. Gather candidates level by level
+  for (int i = 0; i < LEVEL_COUNT; ++i) {
+    const Level &level = m_levels[i];
+    if (level.members.empty())
+      continue;
+
+    if (scan_level[i]) {
+      for (uint32_t id : level.members)
+        visit(id);
+      continue;
+    }
+
+    for_each_cell(level, area, [&](uint64_t key) {
+      auto it = level.cells.find(key);
+      if (it == level.cells.end())
+        return;
+      for (uint32_t id : it->second)
+        visit(id);
+    });
+  }
+
+  // 4. Back to draw order
+  std::sort(out.begin() + first, out.end());
+}
+
+AABB SpatialIndex::empty_bounds() {
+  double inf = std::numeric_limits<double>::infinity();
+  return {glm::dvec2(inf), glm::dvec2(-inf)};
+}
+
+int SpatialIndex::level_for(const AABB &bounds) {
+  glm::dvec2 extent = bounds.max - bounds.min;
+  double size = std::max(extent.x, extent.y);
+
+  double cell_size = BASE_CELL_SIZE;
+  for (int i = 0; i < LEVEL_COUNT - 1; ++i) {
+    if (size <= cell_size)
+      return i;
+    cell_size *= CELL_GROWTH;
+  }
+  return LEVEL_COUNT - 1;
+}
+
+uint64_t SpatialIndex::cell_key(int64_t x, int64_t y) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) |
+         static_cast<uint32_t>(y);
+}
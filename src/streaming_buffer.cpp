@@ -0,0 +1,114 @@
+#include "streaming_buffer.h"
+
+#include "glad/gl.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t INITIAL_CAPACITY = 1024;
+constexpr GLbitfield MAP_FLAGS =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+} // namespace
+
+StreamingBuffer::StreamingBuffer(size_t element_size)
+    : m_element_size(element_size) {}
+
+StreamingBuffer::~StreamingBuffer() {
+  for (GLsync &fence : m_fences) {
+    if (fence)
+      glDeleteSync(fence);
+  }
+
+  if (m_buffer != 0) {
+    glUnmapNamedBuffer(m_buffer);
+    glDeleteBuffers(1, &m_buffer);
+  }
+}
+
+void StreamingBuffer::invalidate(size_t first) {
+  for (size_t &dirty : m_dirty_from)
+    dirty = std::min(dirty, first);
+}
+
+void StreamingBuffer::update(const void *data, size_t count) {
+  if (count > m_capacity)
+    reallocate(count);
+
+  m_region = (m_region + 1) % REGION_COUNT;
+  wait_for_region(m_region);
+
+  size_t first = std::min(m_dirty_from[m_region], count);
+  if (first < count) {
+    unsigned char *dst = m_mapped + get_offset() + first * m_element_size;
+    const unsigned char *src =
+        static_cast<const unsigned char *>(data) + first * m_element_size;
+    std::memcpy(dst, src, (count - first) * m_element_size);
+  }
+
+  m_dirty_from[m_region] = count;
+  m_count = count;
+}
+
+void StreamingBuffer::end_frame() {
+  if (m_buffer == 0)
+    return;
+
+  if (m_fences[m_region])
+    glDeleteSync(m_fences[m_region]);
+  m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingBuffer::reset() {
+  m_count = 0;
+  invalidate(0);
+}
+
+void StreamingBuffer::wait_for_region(int region) {
+  GLsync &fence = m_fences[region];
+  if (!fence)
+    return;
+
+  // Normally signalled long ago; only blocks if the GPU is frames behind
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  while (true) {
+    GLenum result = glClientWaitSync(fence, flags, 1000000);
+    if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED ||
+        result == GL_WAIT_FAILED)
+      break;
+    flags = 0;
+  }
+
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+void StreamingBuffer::reallocate(size_t min_capacity) {
+  size_t capacity = std::max(m_capacity, INITIAL_CAPACITY);
+  while (capacity < min_capacity)
+    capacity *= 2;
+
+  // The old buffer may still be in use by queued draws; GL keeps its
+  // storage alive until they finish, so no fence wait is needed here.
+  if (m_buffer != 0) {
+    glUnmapNamedBuffer(m_buffer);
+    glDeleteBuffers(1, &m_buffer);
+  }
+  for (GLsync &fence : m_fences) {
+    if (fence)
+      glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  GLsizeiptr size =
+      static_cast<GLsizeiptr>(capacity * m_element_size * REGION_COUNT);
+  glCreateBuffers(1, &m_buffer);
+  glNamedBufferStorage(m_buffer, size, nullptr, MAP_FLAGS);
+  m_mapped = static_cast<unsigned char *>(
+      glMapNamedBufferRange(m_buffer, 0, size, MAP_FLAGS));
+  m_capacity = capacity;
+
+  // Fresh storage: every region needs a full copy once
+  invalidate(0);
+}
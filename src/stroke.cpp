@@ -3,72 +3,251 @@
 #include "glad/gl.h"
 #include "glm/fwd.hpp"
 #include "glm/geometric.hpp"
+#include "ribbon_kernel.h"
+#include "stroke_style.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <limits>
 #include <vector>
 
 Stroke::Stroke()
-    : m_vbo(0), m_color(1.0f), m_thickness(0.01), m_cummulative_distance(0.0),
-      m_bounds({{0.0f, 0.0f}, {0.0f, 0.0f}}), m_is_eraser(false) {
-  m_raw_points.reserve(100);
-  m_render_vertices.reserve(100);
-}
+    : m_color(1.0f), m_thickness(0.01), m_cummulative_distance(0.0),
+      m_bounds({{0.0f, 0.0f}, {0.0f, 0.0f}}), m_is_eraser(false) {}
 
 Stroke::Stroke(glm::vec3 color, double thickness, bool is_eraser)
-    : m_vbo(0), m_color(color), m_thickness(thickness),
-      m_cummulative_distance(0.0), m_bounds({{0.0f, 0.0f}, {0.0f, 0.0f}}),
-      m_is_eraser(is_eraser) {
-  m_raw_points.reserve(100);
-  m_render_vertices.reserve(100);
-}
+    : m_color(color), m_thickness(thickness), m_cummulative_distance(0.0),
+      m_bounds({{0.0f, 0.0f}, {0.0f, 0.0f}}), m_is_eraser(is_eraser) {}
 
 Stroke::~Stroke() {
-  if (m_vbo != 0) {
+  StrokeStyleTable::instance().release(m_style_slot);
 
-    std::cout << "DELETING VBO: " << m_vbo << std::endl;
-    glDeleteBuffers(1, &m_vbo);
-  }
+  if (m_arena)
+    m_arena->free(m_allocation);
 }
 
 Stroke::Stroke(Stroke &&other) noexcept
     : m_raw_points(std::move(other.m_raw_points)),
-      m_render_vertices(std::move(other.m_render_vertices)), m_vbo(other.m_vbo),
-      m_color(other.m_color), m_bounds(other.m_bounds),
-      m_is_eraser(other.m_is_eraser), m_thickness(other.m_thickness) {
-  other.m_vbo = 0;
+      m_packed_points(std::move(other.m_packed_points)),
+      m_mapped_points(other.m_mapped_points),
+      m_mapped_source(std::move(other.m_mapped_source)),
+      m_smooth_points(std::move(other.m_smooth_points)),
+      m_smooth_lengths(std::move(other.m_smooth_lengths)),
+      m_render_vertices(std::move(other.m_render_vertices)),
+      m_lods(std::move(other.m_lods)), m_arena(other.m_arena),
+      m_allocation(other.m_allocation), m_color(other.m_color),
+      m_cummulative_distance(other.m_cummulative_distance),
+      m_bounds(other.m_bounds), m_quant_origin(other.m_quant_origin),
+      m_quant_extent(other.m_quant_extent), m_style_slot(other.m_style_slot),
+      m_dirty_vertex(other.m_dirty_vertex),
+      m_needs_geometry(other.m_needs_geometry),
+      m_is_eraser(other.m_is_eraser), m_thickness(other.m_thickness),
+      m_id(other.m_id) {
+  other.m_arena = nullptr;
+  other.m_allocation = VertexArena::INVALID_HANDLE;
+  other.m_style_slot = StrokeStyleTable::INVALID_SLOT;
 }
 
 Stroke &Stroke::operator=(Stroke &&other) noexcept {
   if (this != &other) {
-    if (m_vbo != 0) {
-      glDeleteBuffers(1, &m_vbo);
-    }
+    if (m_arena)
+      m_arena->free(m_allocation);
+    StrokeStyleTable::instance().release(m_style_slot);
 
     m_raw_points = std::move(other.m_raw_points);
+    m_packed_points = std::move(other.m_packed_points);
+    m_mapped_points = other.m_mapped_points;
+    m_mapped_source = std::move(other.m_mapped_source);
+    m_smooth_points = std::move(other.m_smooth_points);
+    m_smooth_lengths = std::move(other.m_smooth_lengths);
     m_render_vertices = std::move(other.m_render_vertices);
-    m_vbo = other.m_vbo;
+    m_lods = std::move(other.m_lods);
+    m_arena = other.m_arena;
+    m_allocation = other.m_allocation;
     m_color = other.m_color;
+    m_cummulative_distance = other.m_cummulative_distance;
     m_bounds = other.m_bounds;
+    m_quant_origin = other.m_quant_origin;
+    m_quant_extent = other.m_quant_extent;
+    m_style_slot = other.m_style_slot;
+    m_dirty_vertex = other.m_dirty_vertex;
+    m_needs_geometry = other.m_needs_geometry;
     m_is_eraser = other.m_is_eraser;
+    m_id = other.m_id;
     m_thickness = other.m_thickness;
 
-    other.m_vbo = 0;
+    other.m_arena = nullptr;
+    other.m_allocation = VertexArena::INVALID_HANDLE;
+    other.m_style_slot = StrokeStyleTable::INVALID_SLOT;
   }
   return *this;
 }
 
+namespace {
+
+// Endpoint-preserving Chaikin smoothing of `count` points into `out`.
+// `scratch` is used for the intermediate passes so repeated calls do not
+// allocate once both buffers have grown. `points` may decode on the fly.
+template <typename PointIt>
+void chaikin_smooth(PointIt points, size_t count, int iterations,
+                    std::vector<glm::dvec2> &out,
+                    std::vector<glm::dvec2> &scratch) {
+  out.resize(count);
+  std::copy_n(points, count, out.begin());
+
+  for (int i = 0; i < iterations; ++i) {
+    scratch.clear();
+    scratch.push_back(out.front()); // Keep the start
+
+    for (size_t j = 0; j < out.size() - 1; ++j) {
+      glm::dvec2 p0 = out[j];
+      glm::dvec2 p1 = out[j + 1];
+
+      // Cut corners at 25% and 75%
+      scratch.push_back(0.75 * p0 + 0.25 * p1);
+      scratch.push_back(0.25 * p0 + 0.75 * p1);
+    }
+    scratch.push_back(out.back()); // Keep the end
+    out.swap(scratch);
+  }
+}
+
+void write_cap_pair(PointVertex *out, glm::dvec2 origin, glm::dvec2 offset,
+                    int cap, const RibbonParams &params, AABB &bounds) {
+  glm::dvec2 left = origin + offset;
+  glm::dvec2 right = origin - offset;
+
+  write_ribbon_pair(out, left, right, cap, params);
+
+  bounds.min = glm::min(bounds.min, glm::min(left, right));
+  bounds.max = glm::max(bounds.max, glm::max(left, right));
+}
+
+// Vertices of the ribbon through `count` points: a pair per point, plus
+// the pair one radius past each endpoint that closes the cap
+size_t ribbon_vertex_count(size_t count) { return (count + 2) * 2; }
+
+// First vertex of the pair at point `i`
+size_t ribbon_pair_vertex(size_t i) { return (i + 1) * 2; }
+
+// Start cap pairs of the ribbon; also resets `bounds` and the arc length.
+// The cap is its own quad from the endpoint to one radius past it, so the
+// cap coordinate ramps over exactly one radius.
+void write_start_cap(const glm::dvec2 *pts, const RibbonParams &params,
+                     double *lengths, PointVertex *out, AABB &bounds) {
+  double radius = params.thickness / 2.0;
+  glm::dvec2 t = glm::normalize(pts[1] - pts[0]);
+  glm::dvec2 miter_normal = glm::dvec2(-t.y, t.x);
+
+  // Extension for Rounded Cap
+  lengths[0] = 0.0;
+  bounds = {pts[0], pts[0]};
+  write_cap_pair(&out[0], pts[0] - (t * radius), miter_normal * radius, -1,
+                 params, bounds);
+  write_cap_pair(&out[ribbon_pair_vertex(0)], pts[0], miter_normal * radius,
+                 0, params, bounds);
+}
+
+// End cap pairs of the ribbon. Returns the total arc length.
+double write_end_cap(const glm::dvec2 *pts, size_t count,
+                     const RibbonParams &params, double *lengths,
+                     PointVertex *out, AABB &bounds) {
+  double radius = params.thickness / 2.0;
+  size_t last = count - 1;
+  glm::dvec2 t = glm::normalize(pts[last] - pts[last - 1]);
+  glm::dvec2 miter_normal = glm::dvec2(-t.y, t.x);
+  lengths[last] = lengths[last - 1] + glm::distance(pts[last], pts[last - 1]);
+
+  // Extension for Rounded Cap
+  write_cap_pair(&out[ribbon_pair_vertex(last)], pts[last],
+                 miter_normal * radius, 0, params, bounds);
+  write_cap_pair(&out[ribbon_pair_vertex(count)], pts[last] + (t * radius),
+                 miter_normal * radius, 1, params, bounds);
+  return lengths[last];
+}
+
+// Writes the full ribbon (caps and joins) for `count` points, starting at
+// point `from`, and returns the total arc length.
+double tessellate_ribbon(const glm::dvec2 *pts, size_t count, size_t from,
+                         const RibbonParams &params, double *lengths,
+                         PointVertex *out, AABB &bounds) {
+  // 1. Start cap
+  if (from == 0)
+    write_start_cap(pts, params, lengths, out, bounds);
+
+  // 2. Mitered joins (vectorized)
+  size_t begin = glm::max<size_t>(from, 1);
+  build_ribbon_joins(pts, begin, count - 1, params, lengths,
+                     &out[ribbon_pair_vertex(begin)], bounds);
+
+  // 3. End cap
+  return write_end_cap(pts, count, params, lengths, out, bounds);
+}
+
+// Same as tessellate_ribbon(pts, count, 0, ...), with the joins split into
+// ranges of `grain` points that run as parallel tasks.
+double tessellate_ribbon(TaskScheduler &scheduler, size_t grain,
+                         const glm::dvec2 *pts, size_t count,
+                         const RibbonParams &params, double *lengths,
+                         PointVertex *out, AABB &bounds) {
+  // 1. Start cap
+  write_start_cap(pts, params, lengths, out, bounds);
+
+  // 2. Joins. Vertices do not depend on arc length, so every range measures
+  //    it from its own start and is shifted into place afterwards.
+  size_t joins = count - 2;
+  size_t ranges = (joins + grain - 1) / grain;
+  std::vector<std::vector<double>> range_lengths(ranges);
+  std::vector<AABB> range_bounds(ranges);
+
+  scheduler.parallel_for(0, ranges, 1, [&](size_t first, size_t last) {
+    for (size_t r = first; r < last; ++r) {
+      size_t begin = 1 + r * grain;
+      size_t end = glm::min(begin + grain, count - 1);
+
+      // Rebased so the range starts at local point 1 after one neighbour
+      std::vector<double> &local = range_lengths[r];
+      local.assign(end - begin + 1, 0.0);
+      range_bounds[r] = {pts[begin], pts[begin]};
+      build_ribbon_joins(pts + begin - 1, 1, end - begin + 1, params,
+                         local.data(), &out[ribbon_pair_vertex(begin)],
+                         range_bounds[r]);
+    }
+  });
+
+  // 3. Stitch arc lengths and bounds together
+  for (size_t r = 0; r < ranges; ++r) {
+    size_t begin = 1 + r * grain;
+    size_t end = glm::min(begin + grain, count - 1);
+    double base = lengths[begin - 1];
+    for (size_t i = begin; i < end; ++i)
+      lengths[i] = base + range_lengths[r][i - begin + 1];
+
+    bounds.min = glm::min(bounds.min, range_bounds[r].min);
+    bounds.max = glm::max(bounds.max, range_bounds[r].max);
+  }
+
+  // 4. End cap
+  return write_end_cap(pts, count, params, lengths, out, bounds);
+}
+
+} // namespace
+
 void Stroke::add_point(double x, double y) {
   glm::dvec2 curr_point(x, y);
+  detach_points();
 
   if (m_raw_points.empty()) {
     m_raw_points.push_back(curr_point);
-    m_render_vertices.push_back({{static_cast<float>(x), static_cast<float>(y)},
-                                 m_color,
-                                 {0.0f, 0.0f},
-                                 static_cast<float>(m_thickness),
-                                 0.0f});
+    m_bounds = {curr_point, curr_point};
+
+    // The shader rebuilds positions in float, so snap the origin to a float
+    m_quant_origin = glm::dvec2(glm::vec2(curr_point));
+    m_quant_extent = m_thickness * INITIAL_QUANT_EXTENT;
+    tessellate_from(0);
     return;
   }
 
@@ -79,236 +258,612 @@ void Stroke::add_point(double x, double y) {
   }
 
   m_raw_points.push_back(curr_point);
-  if (m_raw_points.size() < 2)
+
+  // Only the last few smooth points (and their ribbon vertices) depend on
+  // the new sample, so the live stroke matches the committed one exactly
+  // at O(1) cost per point.
+  size_t first_changed = update_smooth_tail();
+  tessellate_from(first_changed > 0 ? first_changed - 1 : 0);
+}
+
+void Stroke::add_points(std::span<const glm::dvec2> points) {
+  if (points.empty())
     return;
 
-  glm::dvec2 prev_point = m_raw_points.at(m_raw_points.size() - 2);
-
-  // 1. Update distance
-  m_cummulative_distance += glm::distance(curr_point, prev_point);
-
-  // 2. Math for the ribbon
-  glm::dvec2 tangent = glm::normalize(curr_point - prev_point);
-  glm::dvec2 normal = glm::dvec2(-tangent.y, tangent.x);
-  double w = static_cast<double>(m_thickness / 2.0);
-
-  // 3. Handle the very first segment
-  if (m_render_vertices.empty()) {
-    // We need to place the "Start" vertices at prev_point (v=0)
-    glm::dvec2 start_left = prev_point + (normal * w);
-    glm::dvec2 start_right = prev_point - (normal * w);
-
-    m_render_vertices.push_back(
-        {{static_cast<float>(start_left.x), static_cast<float>(start_left.y)},
-         m_color,
-         {0.0f, 0.0f},
-         static_cast<float>(m_thickness),
-         0.0f});
-    m_render_vertices.push_back(
-        {{static_cast<float>(start_right.x), static_cast<float>(start_right.y)},
-         m_color,
-         {1.0f, 0.0f},
-         static_cast<float>(m_thickness),
-         0.0f});
+  detach_points();
+
+  // The first sample also places the quantization box
+  size_t next = 0;
+  if (m_raw_points.empty()) {
+    add_point(points[0].x, points[0].y);
+    next = 1;
+  }
+
+  // Same filter as add_point(), against the previous kept sample
+  size_t added = 0;
+  for (; next < points.size(); ++next) {
+    if (m_raw_points.size() >= 2 &&
+        glm::distance(points[next], m_raw_points.back()) < (m_thickness / 10))
+      continue;
+    m_raw_points.push_back(points[next]);
+    added++;
   }
+  if (added == 0)
+    return;
+
+  size_t first_changed = update_smooth_tail(added);
+  tessellate_from(first_changed > 0 ? first_changed - 1 : 0);
+}
+
+uint64_t Stroke::next_id() {
+  static std::atomic<uint64_t> counter{1};
+  return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+Stroke Stroke::clone_geometry() const {
+  Stroke clone(m_color, m_thickness, m_is_eraser);
+  clone.m_raw_points = m_raw_points;
+  clone.m_packed_points = m_packed_points;
+  clone.m_mapped_points = m_mapped_points;
+  clone.m_mapped_source = m_mapped_source;
+  clone.m_smooth_points = m_smooth_points;
+  clone.m_smooth_lengths = m_smooth_lengths;
+  clone.m_render_vertices = m_render_vertices;
+  clone.m_lods = m_lods;
+  clone.m_cummulative_distance = m_cummulative_distance;
+  clone.m_bounds = m_bounds;
+  clone.m_quant_origin = m_quant_origin;
+  clone.m_quant_extent = m_quant_extent;
+  clone.m_needs_geometry = m_needs_geometry;
+  clone.m_id = m_id;
+  return clone;
+}
 
-  // 4. Add the "End" vertices for this specific segment
-  glm::dvec2 end_left = curr_point + (normal * w);
-  glm::dvec2 end_right = curr_point - (normal * w);
+void Stroke::adopt_geometry(Stroke &&other) {
+  m_raw_points = std::move(other.m_raw_points);
+  m_packed_points = std::move(other.m_packed_points);
+  m_mapped_points = other.m_mapped_points;
+  m_mapped_source = std::move(other.m_mapped_source);
+  m_smooth_points = std::move(other.m_smooth_points);
+  m_smooth_lengths = std::move(other.m_smooth_lengths);
+  m_render_vertices = std::move(other.m_render_vertices);
+  m_lods = std::move(other.m_lods);
+  m_cummulative_distance = other.m_cummulative_distance;
+  m_bounds = other.m_bounds;
+  m_quant_origin = other.m_quant_origin;
+  m_quant_extent = other.m_quant_extent;
+  m_needs_geometry = other.m_needs_geometry;
+  m_dirty_vertex = 0;
+}
 
-  m_render_vertices.push_back(
-      {{static_cast<float>(end_left.x), static_cast<float>(end_left.y)},
-       m_color,
-       {0.0f, m_cummulative_distance},
-       static_cast<float>(m_thickness),
-       static_cast<float>(m_cummulative_distance)});
-  m_render_vertices.push_back(
-      {{static_cast<float>(end_right.x), static_cast<float>(end_right.y)},
-       m_color,
-       {1.0f, m_cummulative_distance},
-       static_cast<float>(m_thickness),
-       static_cast<float>(m_cummulative_distance)});
+void Stroke::finalize(double simplify_tolerance) {
+  // Geometry is already up to date from add_point(); it only needs a
+  // rebuild if simplification dropped samples, or packing moved them onto
+  // the grid. Rebuilding from the stored points keeps the geometry
+  // reproducible from the document.
+  bool simplified = simplify(simplify_tolerance);
+  bool packed = pack_points();
+  if (simplified || packed)
+    update_geometry();
+  else
+    build_lods();
+}
+
+bool Stroke::simplify(double tolerance) {
+  std::vector<glm::dvec2> decoded;
+  std::span<const glm::dvec2> raw = get_raw_points().contiguous(decoded);
+  std::vector<glm::dvec2> control_points;
+  simplify_polyline(raw.data(), raw.size(), tolerance, control_points);
+
+  if (control_points.size() == raw.size())
+    return false;
+
+  // Committed strokes never grow again, so release the slack too
+  m_raw_points = std::move(control_points);
+  m_raw_points.shrink_to_fit();
+  m_packed_points = {};
+  m_mapped_points = {};
+  m_mapped_source.reset();
+  return true;
 }
 
 void Stroke::clear() {
   m_raw_points.clear();
+  m_packed_points = {};
+  m_mapped_points = {};
+  m_mapped_source.reset();
+  m_needs_geometry = false;
+  m_smooth_points.clear();
+  m_smooth_lengths.clear();
   m_render_vertices.clear();
+  m_lods.clear();
+  m_cummulative_distance = 0.0;
+  m_dirty_vertex = 0;
 }
 
-void Stroke::update_geometry() {
-  if (m_raw_points.size() < 2)
+size_t Stroke::update_smooth_tail(size_t added) {
+  static thread_local std::vector<glm::dvec2> window;
+  static thread_local std::vector<glm::dvec2> scratch;
+
+  // Each pass doubles the point count, so `n` raw points smooth into
+  // `n << k` points, and appending `a` raw points only rewrites the last
+  // `(a + 2) * 2^k - 1` of them. Smoothing the last `a + 3` raw points on
+  // their own reproduces that tail exactly; the start of the window is
+  // distorted by the endpoint rule, but not far enough to reach the part
+  // we keep.
+  const size_t window_points = added + 3;
+  constexpr int k = SMOOTHING_ITERATIONS;
+
+  size_t n = m_raw_points.size();
+  if (n < window_points) {
+    chaikin_smooth(m_raw_points.data(), n, k, window, scratch);
+    m_smooth_points.assign(window.begin(), window.end());
+    return 0;
+  }
+
+  size_t stable = ((n - added) << k) - (size_t{2} << k) + 1;
+  size_t changed = ((added + 2) << k) - 1;
+
+  chaikin_smooth(m_raw_points.data() + n - window_points, window_points, k,
+                 window, scratch);
+
+  m_smooth_points.resize(stable);
+  m_smooth_points.insert(m_smooth_points.end(), window.end() - changed,
+                         window.end());
+  return stable;
+}
+
+void Stroke::update_geometry() { rebuild(nullptr); }
+
+void Stroke::update_geometry(TaskScheduler &scheduler) { rebuild(&scheduler); }
+
+void Stroke::update_geometry(int smoothing_iterations) {
+  rebuild(nullptr, smoothing_iterations);
+}
+
+void Stroke::rebuild(TaskScheduler *scheduler, int smoothing_iterations) {
+  RawPointView raw = get_raw_points();
+  m_needs_geometry = false;
+
+  if (raw.size() < 2) {
+    tessellate_from(0);
     return;
+  }
 
   // 1. Path Smoothing (Chaikin's Algorithm)
   // We create a smoother version of the raw input
-  std::vector<glm::dvec2> smooth_points = m_raw_points;
-  int iterations = 2; // Increase for even smoother curves
-
-  for (int i = 0; i < iterations; ++i) {
-    std::vector<glm::dvec2> new_points;
-    new_points.push_back(smooth_points.front()); // Keep the start
+  std::vector<glm::dvec2> scratch;
+  chaikin_smooth(raw.begin(), raw.size(), smoothing_iterations,
+                 m_smooth_points, scratch);
+
+  // 2. Generate Render Geometry, in parallel ranges if the stroke is long
+  if (scheduler && m_smooth_points.size() >= PARALLEL_GRAIN * 2)
+    tessellate_parallel(*scheduler);
+  else
+    tessellate_from(0);
+  build_lods();
+
+  // A full rebuild means the stroke is no longer being drawn
+  m_smooth_points.shrink_to_fit();
+  m_smooth_lengths.shrink_to_fit();
+  m_render_vertices.shrink_to_fit();
+}
 
-    for (size_t j = 0; j < smooth_points.size() - 1; ++j) {
-      glm::dvec2 p0 = smooth_points[j];
-      glm::dvec2 p1 = smooth_points[j + 1];
+void Stroke::tessellate_from(size_t from) {
+  // Any LOD ribbons stored past the full one are stale now
+  m_lods.clear();
+  m_dirty_vertex = glm::min(m_dirty_vertex,
+                            from == 0 ? 0 : ribbon_pair_vertex(from));
 
-      // Cut corners at 25% and 75%
-      new_points.push_back(0.75 * p0 + 0.25 * p1);
-      new_points.push_back(0.25 * p0 + 0.75 * p1);
-    }
-    new_points.push_back(smooth_points.back()); // Keep the end
-    smooth_points = std::move(new_points);
+  size_t count = m_smooth_points.size();
+  if (count < 2) {
+    m_smooth_lengths.clear();
+    tessellate_dot();
+    return;
   }
 
-  // 2. Generate Render Geometry
+  // Two vertices per smooth point, and two past each end. Only the cap
+  // vertices know they are caps, so earlier vertices never need to be
+  // rewritten as the stroke grows.
+  m_smooth_lengths.resize(count);
+  m_render_vertices.resize(ribbon_vertex_count(count));
+
+  // Bounds only grow while drawing; vertices replaced at the tail stay
+  // within a thickness of the new ones, so this remains a tight fit.
+  m_cummulative_distance = tessellate_ribbon(
+      m_smooth_points.data(), count, from,
+      {m_quant_origin, m_quant_extent, m_thickness}, m_smooth_lengths.data(),
+      m_render_vertices.data(), m_bounds);
+
+  // Positions were clamped if the stroke left its quantization box. Grow the
+  // box and requantize everything; doubling keeps this amortized O(1).
+  if (grow_quantization_box())
+    tessellate_from(0);
+}
+
+void Stroke::tessellate_dot() {
   m_render_vertices.clear();
-  double running_v = 0.0;
-  double radius = m_thickness / 2.0;
-  double miter_limit = radius * 4.0;
-
-  for (size_t i = 0; i < smooth_points.size(); ++i) {
-    glm::dvec2 curr = smooth_points[i];
-    glm::dvec2 miter_normal;
-    double length = radius;
-
-    if (i == 0) {
-      glm::dvec2 t = glm::normalize(smooth_points[1] - curr);
-      miter_normal = glm::dvec2(-t.y, t.x);
-
-      // Extension for Rounded Cap
-      glm::dvec2 cap_origin = curr - (t * radius);
-      m_render_vertices.push_back(
-          {{static_cast<float>((cap_origin + miter_normal * radius).x),
-            static_cast<float>((cap_origin + miter_normal * radius).y)},
-           m_color,
-           {0.0f, static_cast<float>(-radius)},
-           static_cast<float>(m_thickness),
-           0.0f});
-      m_render_vertices.push_back(
-          {{static_cast<float>((cap_origin - miter_normal * radius).x),
-            static_cast<float>((cap_origin - miter_normal * radius).y)},
-           m_color,
-           {1.0f, static_cast<float>(-radius)},
-           static_cast<float>(m_thickness),
-           0.0f});
-    } else if (i == smooth_points.size() - 1) {
-      glm::dvec2 prev = smooth_points[i - 1];
-      running_v += glm::distance(curr, prev);
-      glm::dvec2 t = glm::normalize(curr - prev);
-      miter_normal = glm::dvec2(-t.y, t.x);
-
-      // Extension for Rounded Cap
-      glm::dvec2 cap_origin = curr + (t * radius);
-      m_render_vertices.push_back(
-          {{static_cast<float>((cap_origin + miter_normal * radius).x),
-            static_cast<float>((cap_origin + miter_normal * radius).y)},
-           m_color,
-           {0.0f, static_cast<float>(running_v + radius)},
-           static_cast<float>(m_thickness),
-           0.0f});
-      m_render_vertices.push_back(
-          {{static_cast<float>((cap_origin - miter_normal * radius).x),
-            static_cast<float>((cap_origin - miter_normal * radius).y)},
-           m_color,
-           {1.0f, static_cast<float>(running_v + radius)},
-           static_cast<float>(m_thickness),
-           0.0f});
-    } else {
-      glm::dvec2 prev = smooth_points[i - 1];
-      glm::dvec2 next = smooth_points[i + 1];
-      running_v += glm::distance(curr, prev);
-
-      glm::dvec2 t1 = glm::normalize(curr - prev);
-      glm::dvec2 t2 = glm::normalize(next - curr);
-      glm::dvec2 n1(-t1.y, t1.x);
-      glm::dvec2 n2(-t2.y, t2.x);
-
-      miter_normal = glm::normalize(n1 + n2);
-      double dot = glm::dot(miter_normal, n1);
-      length = radius / glm::max(0.1, dot);
-      if (length > miter_limit)
-        length = miter_limit;
-
-      m_render_vertices.push_back(
-          {{static_cast<float>((curr + miter_normal * length).x),
-            static_cast<float>((curr + miter_normal * length).y)},
-           m_color,
-           {0.0f, static_cast<float>(running_v)},
-           static_cast<float>(m_thickness),
-           0.0f});
-      m_render_vertices.push_back(
-          {{static_cast<float>((curr - miter_normal * length).x),
-            static_cast<float>((curr - miter_normal * length).y)},
-           m_color,
-           {1.0f, static_cast<float>(running_v)},
-           static_cast<float>(m_thickness),
-           0.0f});
+  RawPointView raw = get_raw_points();
+  if (raw.size() != 1)
+    return;
+
+  // Start and end cap pairs on the same point: the caps meet in the middle
+  glm::dvec2 point = raw.front();
+  glm::dvec2 along = {m_thickness / 2.0, 0.0};
+  glm::dvec2 across = {0.0, m_thickness / 2.0};
+  RibbonParams params = {m_quant_origin, m_quant_extent, m_thickness};
+
+  m_bounds = {point, point};
+  m_render_vertices.resize(DOT_VERTEX_COUNT);
+  write_cap_pair(&m_render_vertices[0], point - along, across, -1, params,
+                 m_bounds);
+  write_cap_pair(&m_render_vertices[2], point + along, across, 1, params,
+                 m_bounds);
+}
+
+size_t Stroke::get_base_vertex_count() const {
+  if (m_smooth_points.size() < 2)
+    return get_raw_points().size() == 1 ? DOT_VERTEX_COUNT : 0;
+  return ribbon_vertex_count(m_smooth_points.size());
+}
+
+void Stroke::build_lods() {
+  m_lods.clear();
+  m_render_vertices.resize(get_base_vertex_count());
+
+  if (m_smooth_points.size() < 3)
+    return;
+
+  RibbonParams params = {m_quant_origin, m_quant_extent, m_thickness};
+  std::vector<glm::dvec2> prev = m_smooth_points;
+  std::vector<glm::dvec2> curr;
+  std::vector<double> lengths;
+  AABB bounds;
+
+  // Each level decimates the previous one with a 4x larger tolerance, until
+  // only the two endpoints remain. Levels that barely shrink are skipped.
+  double tolerance = m_thickness * LOD_BASE_TOLERANCE;
+  for (int step = 0; step < MAX_LOD_STEPS && prev.size() > 2; ++step) {
+    simplify_polyline(prev.data(), prev.size(), tolerance, curr);
+
+    bool is_last = curr.size() <= 2;
+    if (is_last || curr.size() * 2 <= prev.size()) {
+      if (is_last)
+        curr = {m_smooth_points.front(), m_smooth_points.back()};
+
+      size_t first = m_render_vertices.size();
+      lengths.resize(curr.size());
+      m_render_vertices.resize(first + ribbon_vertex_count(curr.size()));
+      tessellate_ribbon(curr.data(), curr.size(), 0, params, lengths.data(),
+                        &m_render_vertices[first], bounds);
+
+      m_lods.push_back({static_cast<uint32_t>(first),
+                        static_cast<uint32_t>(ribbon_vertex_count(curr.size())),
+                        tolerance});
+      prev.swap(curr);
     }
-  }
 
-  // 3. Finalize and Bake
-  m_cummulative_distance = running_v;
-
-  float min_x = std::numeric_limits<float>::max();
-  float min_y = std::numeric_limits<float>::max();
-  float max_x = std::numeric_limits<float>::lowest();
-  float max_y = std::numeric_limits<float>::lowest();
-
-  for (auto &v : m_render_vertices) {
-    v.total_stroke_length = m_cummulative_distance;
-
-    if (v.position.x < min_x)
-      min_x = v.position.x;
-    if (v.position.y < min_y)
-      min_y = v.position.y;
-    if (v.position.x > max_x)
-      max_x = v.position.x;
-    if (v.position.y > max_y)
-      max_y = v.position.y;
+    tolerance *= LOD_TOLERANCE_STEP;
   }
+}
 
-  if (m_render_vertices.empty()) {
-    m_bounds = {{0.0f, 0.0f}, {0.0f, 0.0f}};
-  } else {
-    m_bounds = {{min_x, min_y}, {max_x, max_y}};
+size_t Stroke::select_lod(double pixel_size) const {
+  // Under a pixel: the coarsest level, a single capsule (a dot if closed)
+  glm::dvec2 extent = m_bounds.max - m_bounds.min;
+  double size = glm::max(extent.x, extent.y);
+  if (!m_lods.empty() && size < pixel_size)
+    return m_lods.size();
+
+  // A few pixels across, decimation saves little and any change shows
+  if (size < pixel_size * LOD_MIN_PIXELS)
+    return 0;
+
+  // Otherwise the coarsest level whose error stays well under a pixel
+  size_t lod = 0;
+  for (size_t i = 0; i < m_lods.size(); ++i) {
+    if (m_lods[i].tolerance > pixel_size * LOD_MAX_PIXEL_ERROR)
+      break;
+    lod = i + 1;
   }
+  return lod;
+}
+
+LodLevel Stroke::get_lod(size_t lod) const {
+  if (lod > 0 && lod <= m_lods.size())
+    return m_lods[lod - 1];
+  return {0, static_cast<uint32_t>(get_base_vertex_count()), 0.0};
+}
+
+void Stroke::tessellate_parallel(TaskScheduler &scheduler) {
+  m_lods.clear();
+  m_dirty_vertex = 0;
+
+  size_t count = m_smooth_points.size();
+  m_smooth_lengths.resize(count);
+  m_render_vertices.resize(ribbon_vertex_count(count));
+
+  // Same box growth as tessellate_from(), without recursion
+  do {
+    m_cummulative_distance = tessellate_ribbon(
+        scheduler, PARALLEL_GRAIN, m_smooth_points.data(), count,
+        {m_quant_origin, m_quant_extent, m_thickness}, m_smooth_lengths.data(),
+        m_render_vertices.data(), m_bounds);
+  } while (grow_quantization_box());
+}
+
+bool Stroke::grow_quantization_box() {
+  glm::dvec2 reach = glm::max(glm::abs(m_bounds.min - m_quant_origin),
+                              glm::abs(m_bounds.max - m_quant_origin));
+  double needed = glm::max(reach.x, reach.y);
+
+  if (needed <= m_quant_extent)
+    return false;
+
+  while (m_quant_extent < needed)
+    m_quant_extent *= 2.0;
+  return true;
 }
 
 void Stroke::set_color(glm::vec3 color) {
+  // Color lives in the style record only, no vertex needs touching
   m_color = color;
-  std::cout << m_color.r << "," << m_color.g << "," << m_color.b << "\n";
 }
 void Stroke::set_thickness(double thickness) {
   m_thickness = thickness;
 
-  for (PointVertex &point : m_render_vertices) {
-    point.thickness = thickness;
+  // Miter offsets scale with thickness, so the ribbon has to be rebuilt.
+  // The smoothed path itself does not depend on it.
+  tessellate_from(0);
+}
+
+std::span<const glm::dvec2>
+Stroke::get_centerline(std::vector<glm::dvec2> &storage) const {
+  // A single sample has no smooth points while it is drawn as a dot
+  if (!m_needs_geometry && !m_smooth_points.empty())
+    return m_smooth_points;
+
+  RawPointView raw = get_raw_points();
+  if (raw.size() < 2) {
+    storage.assign(raw.begin(), raw.end());
+    return storage;
+  }
+  static thread_local std::vector<glm::dvec2> scratch;
+  chaikin_smooth(raw.begin(), raw.size(), SMOOTHING_ITERATIONS, storage,
+                 scratch);
+  return storage;
+}
+
+bool Stroke::contains_point(double x, double y) const {
+  return hits({x, y});
+}
+
+bool Stroke::hits(glm::dvec2 point, double tolerance) const {
+  if (point.x < m_bounds.min.x - tolerance ||
+      point.x > m_bounds.max.x + tolerance ||
+      point.y < m_bounds.min.y - tolerance ||
+      point.y > m_bounds.max.y + tolerance)
+    return false;
+
+  static thread_local std::vector<glm::dvec2> storage;
+  std::span<const glm::dvec2> centerline = get_centerline(storage);
+  double reach = m_thickness * 0.5 + tolerance;
+  return polyline_distance_squared(centerline.data(), centerline.size(), point,
+                                   reach * reach) <= reach * reach;
+}
+
+double Stroke::distance_to(glm::dvec2 point) const {
+  static thread_local std::vector<glm::dvec2> storage;
+  std::span<const glm::dvec2> centerline = get_centerline(storage);
+  double distance = std::sqrt(polyline_distance_squared(
+      centerline.data(), centerline.size(), point));
+  return glm::max(distance - m_thickness * 0.5, 0.0);
+}
+
+RawPointView Stroke::get_raw_points() const {
+  if (m_mapped_source)
+    return std::span<const glm::dvec2>(m_mapped_points);
+  if (!m_packed_points.empty())
+    return m_packed_points;
+  return std::span<const glm::dvec2>(m_raw_points);
+}
+
+void Stroke::attach_points(std::span<const glm::dvec2> points,
+                           std::shared_ptr<const void> source,
+                           const AABB &bounds) {
+  clear();
+  m_mapped_points = points;
+  m_mapped_source = std::move(source);
+  m_bounds = bounds;
+
+  // Same box add_point() would have ended up with
+  if (!points.empty())
+    m_quant_origin = glm::dvec2(glm::vec2(points.front()));
+  m_quant_extent = m_thickness * INITIAL_QUANT_EXTENT;
+  grow_quantization_box();
+  m_needs_geometry = true;
+}
+
+void Stroke::set_raw_points(std::vector<glm::dvec2> points) {
+  clear();
+  m_raw_points = std::move(points);
+  if (m_raw_points.empty())
+    return;
+
+  glm::dvec2 radius(m_thickness * 0.5);
+  m_bounds = {m_raw_points.front(), m_raw_points.front()};
+  for (const glm::dvec2 &point : m_raw_points) {
+    m_bounds.min = glm::min(m_bounds.min, point);
+    m_bounds.max = glm::max(m_bounds.max, point);
   }
+  m_bounds.min -= radius;
+  m_bounds.max += radius;
+
+  m_quant_origin = glm::dvec2(glm::vec2(m_raw_points.front()));
+  m_quant_extent = m_thickness * INITIAL_QUANT_EXTENT;
+  grow_quantization_box();
+  m_needs_geometry = true;
+}
+
+void Stroke::detach_points() {
+  if (!m_mapped_source && m_packed_points.empty())
+    return;
+
+  RawPointView raw = get_raw_points();
+  m_raw_points.resize(raw.size());
+  std::copy(raw.begin(), raw.end(), m_raw_points.begin());
+  m_packed_points = {};
+  m_mapped_points = {};
+  m_mapped_source.reset();
+}
+
+bool Stroke::pack_points() {
+  RawPointView raw = get_raw_points();
+  if (raw.is_packed() || raw.empty())
+    return false;
+
+  std::vector<glm::dvec2> unused;
+  m_packed_points = PackedPoints(raw.contiguous(unused),
+                                 m_thickness / PACKED_POINT_STEPS);
+  m_raw_points.clear();
+  m_raw_points.shrink_to_fit();
+  m_mapped_points = {};
+  m_mapped_source.reset();
+  return true;
+}
+
+void Stroke::release_geometry() {
+  if (m_arena)
+    m_arena->free(m_allocation);
+  m_arena = nullptr;
+  m_allocation = VertexArena::INVALID_HANDLE;
+  StrokeStyleTable::instance().release(m_style_slot);
+  m_style_slot = StrokeStyleTable::INVALID_SLOT;
+
+  m_smooth_points.clear();
+  m_smooth_points.shrink_to_fit();
+  m_smooth_lengths.clear();
+  m_smooth_lengths.shrink_to_fit();
+  m_render_vertices.clear();
+  m_render_vertices.shrink_to_fit();
+  m_lods.clear();
+  m_lods.shrink_to_fit();
+  pack_points();
+  m_needs_geometry = true;
+}
+
+size_t Stroke::get_memory_size() const {
+  return sizeof(Stroke) + m_raw_points.capacity() * sizeof(glm::dvec2) +
+         m_packed_points.get_byte_size() +
+         m_smooth_points.capacity() * sizeof(glm::dvec2) +
+         m_smooth_lengths.capacity() * sizeof(double) +
+         m_render_vertices.capacity() * sizeof(PointVertex) +
+         m_lods.capacity() * sizeof(LodLevel);
+}
+
+const std::vector<glm::dvec2> &Stroke::get_smooth_points() const {
+  return m_smooth_points;
+}
+
+void Stroke::upload_style() {
+  StrokeStyleTable &styles = StrokeStyleTable::instance();
+  if (m_style_slot == StrokeStyleTable::INVALID_SLOT)
+    m_style_slot = styles.allocate();
+  styles.set(m_style_slot, get_style());
 }
 
-const std::vector<glm::dvec2> &Stroke::get_raw_points() const {
-  return m_raw_points;
+size_t Stroke::take_dirty_vertex() {
+  size_t dirty = m_dirty_vertex;
+  m_dirty_vertex = SIZE_MAX;
+  return dirty;
 }
 
-void Stroke::upload() {
-  if (m_vbo == 0)
-    glCreateBuffers(1, &m_vbo);
+void Stroke::upload(VertexArena &arena) {
+  upload_style();
+  m_dirty_vertex = SIZE_MAX;
 
-  size_t size = m_render_vertices.size() * sizeof(PointVertex);
-  if (size == 0)
+  uint32_t count = static_cast<uint32_t>(m_render_vertices.size());
+
+  // Reuse the current range if the vertex count did not change
+  if (m_arena && m_allocation != VertexArena::INVALID_HANDLE &&
+      (m_arena != &arena || m_arena->get(m_allocation).count != count)) {
+    m_arena->free(m_allocation);
+    m_allocation = VertexArena::INVALID_HANDLE;
+  }
+
+  m_arena = &arena;
+  if (count == 0)
     return;
 
-  glNamedBufferData(m_vbo, size, nullptr, GL_DYNAMIC_DRAW);
-  glNamedBufferSubData(m_vbo, 0, size, m_render_vertices.data());
+  if (m_allocation == VertexArena::INVALID_HANDLE)
+    m_allocation = arena.allocate(count);
+  arena.upload(m_allocation, m_render_vertices.data(), count);
+}
+
+StrokeStyle Stroke::get_style() const {
+  StrokeStyle style = {};
+  style.origin = glm::vec2(m_quant_origin);
+  style.extent = static_cast<float>(m_quant_extent);
+  style.thickness = static_cast<float>(m_thickness);
+  style.color = m_color;
+  style.total_length = static_cast<float>(m_cummulative_distance);
+  style.flags = m_is_eraser ? StrokeStyle::FLAG_ERASER : 0;
+  return style;
 }
 
 void Stroke::draw(GLuint &vao, const Shader &shader) const {
-  glVertexArrayVertexBuffer(vao, 0, m_vbo, 0, sizeof(PointVertex));
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, (GLsizei)m_render_vertices.size());
+  draw(vao, shader, 0);
+}
+
+void Stroke::draw(GLuint &vao, const Shader &, size_t lod) const {
+  DrawArraysIndirectCommand command;
+  GLuint buffer;
+  if (!get_draw_command(lod, command, buffer))
+    return;
+
+  // The style slot travels as the base instance (gl_BaseInstance)
+  glVertexArrayVertexBuffer(vao, 0, buffer, 0, sizeof(PointVertex));
+  glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, command.first,
+                                    command.count, 1, command.base_instance);
+}
+
+bool Stroke::get_draw_command(size_t lod, DrawArraysIndirectCommand &command,
+                              GLuint &buffer) const {
+  if (!m_arena || m_allocation == VertexArena::INVALID_HANDLE)
+    return false;
+
+  LodLevel level = get_lod(lod);
+  VertexArena::Location location = m_arena->get(m_allocation);
+  command = {level.vertex_count, 1, location.offset + level.first_vertex,
+             m_style_slot};
+  buffer = location.buffer;
+  return true;
+}
+
+void Stroke::draw(GLuint &vao, const Shader &,
+                  const StreamingBuffer &stream) const {
+  GLsizei count = static_cast<GLsizei>(
+      glm::min(stream.get_count(), get_base_vertex_count()));
+
+  glVertexArrayVertexBuffer(vao, 0, stream.get_buffer(), stream.get_offset(),
+                            sizeof(PointVertex));
+  glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, count, 1,
+                                    m_style_slot);
 }
 
 glm::vec3 Stroke::get_color() const { return m_color; }
 
 double Stroke::get_thickness() const { return m_thickness; }
 
-bool Stroke::is_empty() const { return m_render_vertices.empty(); }
+bool Stroke::is_empty() const { return get_raw_points().empty(); }
+
+void rebuild_strokes(std::span<Stroke> strokes, TaskScheduler &scheduler) {
+  // Enough chunks per thread for stealing to even out stroke lengths
+  size_t grain = glm::max<size_t>(
+      1, strokes.size() / (scheduler.get_thread_count() * 16));
+
+  scheduler.parallel_for(0, strokes.size(), grain,
+                         [&](size_t first, size_t last) {
+                           for (size_t i = first; i < last; ++i)
+                             strokes[i].update_geometry(scheduler);
+                         });
+}
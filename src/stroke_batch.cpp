@@ -0,0 +1,109 @@
+#include "stroke_batch.h"
+
+#include "glad/gl.h"
+
+void StrokeBatch::begin() {
+  m_commands.clear();
+  m_runs.clear();
+  m_groups.clear();
+  m_stats = {};
+}
+
+size_t StrokeBatch::begin_group() {
+  m_groups.push_back(static_cast<uint32_t>(m_runs.size()));
+  m_group_open = true;
+  return m_groups.size() - 1;
+}
+
+void StrokeBatch::add(const Stroke &stroke, size_t lod) {
+  DrawArraysIndirectCommand command;
+  GLuint buffer;
+  if (!stroke.get_draw_command(lod, command, buffer) || command.count == 0)
+    return;
+
+  BlendMode mode = stroke.is_eraser() ? BlendMode::Eraser : BlendMode::Pen;
+  if (m_groups.empty())
+    begin_group();
+
+  // Extend the current run, or start a new one on any state change
+  if (m_group_open || m_runs.back().mode != mode ||
+      m_runs.back().buffer != buffer) {
+    m_runs.push_back(
+        {mode, buffer, static_cast<uint32_t>(m_commands.size()), 0});
+    m_group_open = false;
+  }
+
+  m_commands.push_back(command);
+  m_runs.back().command_count++;
+  m_stats.strokes++;
+}
+
+void StrokeBatch::upload() {
+  if (m_commands.empty())
+    return;
+
+  m_indirect.invalidate(0);
+  m_indirect.update(m_commands.data(), m_commands.size());
+}
+
+void StrokeBatch::draw_group(GLuint vao, size_t group) {
+  uint32_t first = m_groups[group];
+  uint32_t last = group + 1 < m_groups.size() ? m_groups[group + 1]
+                                              : static_cast<uint32_t>(
+                                                    m_runs.size());
+  if (first == last)
+    return;
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirect.get_buffer());
+
+  // One multi-draw per run, touching state only when it differs
+  const Run *prev = nullptr;
+  for (uint32_t i = first; i < last; ++i) {
+    const Run &run = m_runs[i];
+    if (!prev || prev->mode != run.mode) {
+      apply_blend_mode(run.mode);
+      m_stats.state_changes++;
+    }
+    if (!prev || prev->buffer != run.buffer) {
+      glVertexArrayVertexBuffer(vao, 0, run.buffer, 0, sizeof(PointVertex));
+      m_stats.state_changes++;
+    }
+
+    GLintptr offset =
+        m_indirect.get_offset() +
+        static_cast<GLintptr>(run.first_command *
+                              sizeof(DrawArraysIndirectCommand));
+    glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP,
+                              reinterpret_cast<const void *>(offset),
+                              static_cast<GLsizei>(run.command_count), 0);
+    m_stats.draw_calls++;
+    prev = &run;
+  }
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void StrokeBatch::end_frame() {
+  if (!m_commands.empty())
+    m_indirect.end_frame();
+}
+
+void StrokeBatch::submit(GLuint vao) {
+  if (m_commands.empty())
+    return;
+
+  upload();
+  for (size_t group = 0; group < m_groups.size(); ++group)
+    draw_group(vao, group);
+  end_frame();
+}
+
+void StrokeBatch::apply_blend_mode(BlendMode mode) {
+  if (mode == BlendMode::Eraser) {
+    glBlendFuncSeparate(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO,
+                        GL_ONE_MINUS_SRC_ALPHA);
+  } else {
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                        GL_ONE_MINUS_SRC_ALPHA);
+  }
+}
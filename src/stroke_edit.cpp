@@ -0,0 +1,38 @@
+#include "stroke_edit.h"
+
+size_t replace_strokes(std::vector<Stroke> &strokes,
+                       std::vector<StrokeReplacement> &replacements) {
+  if (replacements.empty())
+    return strokes.size();
+
+  size_t new_size = strokes.size();
+  for (const StrokeReplacement &replacement : replacements)
+    new_size = new_size - replacement.remove_count + replacement.strokes.size();
+
+  std::vector<Stroke> result;
+  result.reserve(new_size);
+
+  size_t next = 0; // First stroke of `strokes` not consumed yet
+  for (StrokeReplacement &replacement : replacements) {
+    for (; next < replacement.index; ++next)
+      result.push_back(std::move(strokes[next]));
+
+    std::vector<Stroke> removed;
+    removed.reserve(replacement.remove_count);
+    for (uint32_t i = 0; i < replacement.remove_count; ++i, ++next)
+      removed.push_back(std::move(strokes[next]));
+
+    // Turn the replacement into its inverse
+    replacement.index = static_cast<uint32_t>(result.size());
+    replacement.remove_count =
+        static_cast<uint32_t>(replacement.strokes.size());
+    for (Stroke &stroke : replacement.strokes)
+      result.push_back(std::move(stroke));
+    replacement.strokes = std::move(removed);
+  }
+  for (; next < strokes.size(); ++next)
+    result.push_back(std::move(strokes[next]));
+
+  strokes = std::move(result);
+  return replacements.front().index;
+}
@@ -0,0 +1,46 @@
+#include "stroke_finalizer.h"
+
+StrokeFinalizer::StrokeFinalizer() : m_worker(&StrokeFinalizer::run, this) {}
+
+StrokeFinalizer::~StrokeFinalizer() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_jobs.clear();
+  }
+  m_wake.notify_one();
+  m_worker.join();
+}
+
+void StrokeFinalizer::submit(Stroke &&clone, double simplify_tolerance) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back({std::move(clone), simplify_tolerance});
+  }
+  m_wake.notify_one();
+}
+
+void StrokeFinalizer::run() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+      if (m_stopping)
+        return;
+
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    job.stroke.finalize(job.simplify_tolerance);
+
+    // The GL thread drains the queue every frame, so a full queue only
+    // means it is a frame behind
+    while (!m_completed.try_push(job.stroke)) {
+      if (m_stopping)
+        return;
+      std::this_thread::yield();
+    }
+  }
+}
@@ -0,0 +1,491 @@
+#include "stroke_journal.h"
+#include "document.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Records and their payloads are whole 8-byte words, so points can be used
+// in place from a word-aligned copy of the file
+constexpr size_t RECORD_ALIGNMENT = 8;
+
+size_t padded(size_t size) {
+  return (size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+}
+
+// FNV-1a over 8-byte words; payload sizes are always multiples of 8
+uint64_t hash_words(const unsigned char *data, size_t size, uint64_t hash) {
+  constexpr uint64_t PRIME = 0x100000001b3ull;
+  for (size_t i = 0; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * PRIME;
+  }
+  for (size_t i = size & ~size_t{7}; i < size; ++i)
+    hash = (hash ^ data[i]) * PRIME;
+  return hash;
+}
+
+uint32_t record_checksum(const JournalRecord &record, uint64_t payload_hash) {
+  uint64_t fields[] = {record.type, record.payload_size, record.sequence};
+  uint64_t hash = hash_words(reinterpret_cast<const unsigned char *>(fields),
+                             sizeof(fields), payload_hash);
+  return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+bool write_all(int fd, const unsigned char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0)
+      return false;
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+void put_bytes(std::vector<unsigned char> &payload, const void *data,
+               size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  payload.insert(payload.end(), bytes, bytes + size);
+}
+
+// A StrokeRecord followed by the stroke's raw points
+void put_stroke(std::vector<unsigned char> &payload, const Stroke &stroke) {
+  static thread_local std::vector<glm::dvec2> decoded;
+  StrokeRecord record = make_stroke_record(stroke, 0);
+  std::span<const glm::dvec2> points =
+      stroke.get_raw_points().contiguous(decoded);
+  put_bytes(payload, &record, sizeof(record));
+  put_bytes(payload, points.data(), points.size_bytes());
+}
+
+// Checks the payload of a Replace record and, with `out`, decodes it into
+// strokes that use the points in place. Replacements must be sorted, must
+// not overlap and must fit in `stroke_count` strokes.
+bool parse_replacements(const unsigned char *payload, size_t size,
+                        size_t stroke_count,
+                        const std::shared_ptr<std::vector<uint64_t>> &words,
+                        std::vector<StrokeReplacement> *out) {
+  JournalReplace replace;
+  if (size < sizeof(replace))
+    return false;
+  std::memcpy(&replace, payload, sizeof(replace));
+
+  size_t offset = sizeof(replace);
+  size_t next_index = 0;
+  for (uint32_t i = 0; i < replace.replacement_count; ++i) {
+    JournalReplacement replacement;
+    if (size - offset < sizeof(replacement))
+      return false;
+    std::memcpy(&replacement, payload + offset, sizeof(replacement));
+    offset += sizeof(replacement);
+
+    if (replacement.index < next_index ||
+        replacement.index > stroke_count ||
+        replacement.remove_count > stroke_count - replacement.index)
+      return false;
+    next_index = static_cast<size_t>(replacement.index) +
+                 replacement.remove_count;
+
+    if (out)
+      out->push_back({replacement.index, replacement.remove_count, {}});
+    for (uint32_t k = 0; k < replacement.insert_count; ++k) {
+      if (size - offset < sizeof(StrokeRecord))
+        return false;
+      const StrokeRecord *record =
+          reinterpret_cast<const StrokeRecord *>(payload + offset);
+      offset += sizeof(StrokeRecord);
+      if ((size - offset) / sizeof(glm::dvec2) < record->point_count)
+        return false;
+
+      const glm::dvec2 *points =
+          reinterpret_cast<const glm::dvec2 *>(payload + offset);
+      offset += record->point_count * sizeof(glm::dvec2);
+      if (out)
+        out->back().strokes.push_back(
+            make_stroke(*record, {points, record->point_count}, words));
+    }
+  }
+  return offset == size;
+}
+
+} // namespace
+
+StrokeJournal::StrokeJournal(std::string document_path)
+    : m_document_path(std::move(document_path)),
+      m_journal_path(m_document_path + ".journal"),
+      m_worker(&StrokeJournal::run, this) {}
+
+StrokeJournal::~StrokeJournal() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_one();
+  m_worker.join();
+
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+void StrokeJournal::append_commit(const Stroke &stroke) {
+  StrokeRecord record = make_stroke_record(stroke, 0);
+  std::vector<glm::dvec2> decoded;
+  std::span<const glm::dvec2> points =
+      stroke.get_raw_points().contiguous(decoded);
+
+  append(JournalRecord::Commit,
+         {reinterpret_cast<const unsigned char *>(&record), sizeof(record)},
+         {reinterpret_cast<const unsigned char *>(points.data()),
+          points.size_bytes()});
+}
+
+void StrokeJournal::append_replace(
+    const std::vector<StrokeReplacement> &replacements, bool clears_redo) {
+  JournalReplace replace = {};
+  replace.flags = clears_redo ? JournalReplace::FLAG_CLEARS_REDO : 0;
+  replace.replacement_count = static_cast<uint32_t>(replacements.size());
+
+  std::vector<unsigned char> payload;
+  put_bytes(payload, &replace, sizeof(replace));
+  for (const StrokeReplacement &replacement : replacements) {
+    JournalReplacement header = {};
+    header.index = replacement.index;
+    header.remove_count = replacement.remove_count;
+    header.insert_count = static_cast<uint32_t>(replacement.strokes.size());
+    put_bytes(payload, &header, sizeof(header));
+
+    for (const Stroke &stroke : replacement.strokes)
+      put_stroke(payload, stroke);
+  }
+
+  append(JournalRecord::Replace, payload);
+}
+
+void StrokeJournal::append_finalized(uint32_t index, const Stroke &stroke) {
+  // The stroke in place: a Replace that keeps the redo stack
+  JournalReplace replace = {0, 1};
+  JournalReplacement header = {index, 1, 1, 0};
+
+  std::vector<unsigned char> payload;
+  put_bytes(payload, &replace, sizeof(replace));
+  put_bytes(payload, &header, sizeof(header));
+  put_stroke(payload, stroke);
+  append(JournalRecord::Replace, payload);
+}
+
+void StrokeJournal::append(JournalRecord::Type type,
+                           std::span<const unsigned char> payload,
+                           std::span<const unsigned char> points) {
+  // Hash outside the lock; this is the only per-point work on this thread
+  uint64_t hash = hash_words(payload.data(), payload.size(), HASH_SEED);
+  hash = hash_words(points.data(), points.size(), hash);
+
+  JournalRecord record = {};
+  record.type = type;
+  record.payload_size = static_cast<uint32_t>(payload.size() + points.size());
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    record.sequence = m_next_sequence++;
+    record.checksum = record_checksum(record, hash);
+
+    size_t offset = m_pending.size();
+    m_pending.resize(offset + sizeof(record) + padded(record.payload_size));
+    unsigned char *out = m_pending.data() + offset;
+
+    std::memcpy(out, &record, sizeof(record));
+    out += sizeof(record);
+    if (!payload.empty())
+      std::memcpy(out, payload.data(), payload.size());
+    out += payload.size();
+    if (!points.empty())
+      std::memcpy(out, points.data(), points.size());
+  }
+  m_wake.notify_one();
+}
+
+void StrokeJournal::request_compaction() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_compaction_requested = true;
+  }
+  m_wake.notify_one();
+}
+
+void StrokeJournal::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_written.wait(lock,
+                 [this] { return m_written_sequence + 1 >= m_next_sequence; });
+}
+
+void StrokeJournal::load(std::vector<Stroke> &strokes,
+                         std::vector<Stroke> &reverted) {
+  flush();
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+
+  uint64_t valid_size = 0;
+  uint64_t sequence = read_state(m_document_path, m_journal_path, strokes,
+                                 reverted, valid_size);
+
+  // Reopen for appending, cutting off a torn tail
+  if (m_fd >= 0)
+    close(m_fd);
+  m_fd = ::open(m_journal_path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (m_fd < 0) {
+    std::cout << "Failed to open journal: " << m_journal_path << std::endl;
+  } else if (valid_size < sizeof(JournalHeader)) {
+    JournalHeader header = {};
+    std::memcpy(header.magic, JournalHeader::MAGIC, sizeof(header.magic));
+    header.version = JournalHeader::VERSION;
+    header.header_size = sizeof(JournalHeader);
+
+    valid_size = sizeof(header);
+    if (ftruncate(m_fd, 0) != 0 ||
+        !write_all(m_fd, reinterpret_cast<const unsigned char *>(&header),
+                   sizeof(header)) ||
+        fdatasync(m_fd) != 0)
+      std::cout << "Failed to initialize journal: " << m_journal_path
+                << std::endl;
+  } else if (ftruncate(m_fd, static_cast<off_t>(valid_size)) != 0) {
+    std::cout << "Failed to truncate journal: " << m_journal_path
+              << std::endl;
+  }
+  if (m_fd >= 0)
+    lseek(m_fd, 0, SEEK_END);
+  m_journal_size = valid_size;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_next_sequence = sequence + 1;
+  m_written_sequence = sequence;
+}
+
+void StrokeJournal::read(const std::string &document_path,
+                         std::vector<Stroke> &strokes,
+                         std::vector<Stroke> &reverted) {
+  uint64_t valid_size;
+  read_state(document_path, document_path + ".journal", strokes, reverted,
+             valid_size);
+}
+
+uint64_t StrokeJournal::read_state(const std::string &document_path,
+                                   const std::string &journal_path,
+                                   std::vector<Stroke> &strokes,
+                                   std::vector<Stroke> &reverted,
+                                   uint64_t &valid_size) {
+  // 1. Snapshot, if there is one
+  uint64_t sequence = 0;
+  if (access(document_path.c_str(), F_OK) == 0) {
+    if (auto document = MappedDocument::open(document_path)) {
+      load_strokes(document, strokes, reverted);
+      sequence = document->get_journal_sequence();
+    }
+  }
+
+  // 2. The journal, copied into words so its points can be used in place
+  valid_size = 0;
+  std::ifstream file(journal_path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return sequence;
+
+  size_t size = static_cast<size_t>(file.tellg());
+  auto words = std::make_shared<std::vector<uint64_t>>(
+      (size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+  const unsigned char *data =
+      reinterpret_cast<const unsigned char *>(words->data());
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(words->data()),
+            static_cast<std::streamsize>(size));
+  if (!file)
+    return sequence;
+
+  const JournalHeader *header = reinterpret_cast<const JournalHeader *>(data);
+  if (size < sizeof(JournalHeader) ||
+      std::memcmp(header->magic, JournalHeader::MAGIC,
+                  sizeof(header->magic)) != 0 ||
+      header->version != JournalHeader::VERSION ||
+      header->header_size != sizeof(JournalHeader)) {
+    std::cout << "Ignoring invalid journal: " << journal_path << std::endl;
+    return sequence;
+  }
+
+  // 3. Replay intact records; the first damaged one ends the journal
+  size_t offset = sizeof(JournalHeader);
+  size_t replayed = 0;
+  while (offset + sizeof(JournalRecord) <= size) {
+    const JournalRecord *record =
+        reinterpret_cast<const JournalRecord *>(data + offset);
+    const unsigned char *payload = data + offset + sizeof(JournalRecord);
+    size_t end = offset + sizeof(JournalRecord) + padded(record->payload_size);
+    if (end > size)
+      break;
+
+    uint64_t hash = hash_words(payload, record->payload_size, HASH_SEED);
+    if (record->checksum != record_checksum(*record, hash))
+      break;
+
+    const StrokeRecord *stroke =
+        reinterpret_cast<const StrokeRecord *>(payload);
+    if (record->type == JournalRecord::Commit &&
+        (record->payload_size < sizeof(StrokeRecord) ||
+         stroke->point_count != (record->payload_size - sizeof(StrokeRecord)) /
+                                    sizeof(glm::dvec2)))
+      break;
+    if (record->type == JournalRecord::Replace &&
+        !parse_replacements(payload, record->payload_size, SIZE_MAX, nullptr,
+                            nullptr))
+      break;
+
+    offset = end;
+
+    // Already part of the snapshot
+    if (record->sequence <= sequence)
+      continue;
+    sequence = record->sequence;
+    ++replayed;
+
+    switch (record->type) {
+    case JournalRecord::Commit: {
+      const glm::dvec2 *points = reinterpret_cast<const glm::dvec2 *>(
+          payload + sizeof(StrokeRecord));
+      reverted.clear();
+      strokes.push_back(
+          make_stroke(*stroke, {points, stroke->point_count}, words));
+      break;
+    }
+    case JournalRecord::Undo:
+      if (!strokes.empty()) {
+        reverted.push_back(std::move(strokes.back()));
+        strokes.pop_back();
+      }
+      break;
+    case JournalRecord::Redo:
+      if (!reverted.empty()) {
+        strokes.push_back(std::move(reverted.back()));
+        reverted.pop_back();
+      }
+      break;
+    case JournalRecord::Replace: {
+      std::vector<StrokeReplacement> replacements;
+      if (!parse_replacements(payload, record->payload_size, strokes.size(),
+                              words, &replacements)) {
+        std::cout << "Skipping journal edit that does not fit the canvas"
+                  << std::endl;
+        break;
+      }
+      JournalReplace replace;
+      std::memcpy(&replace, payload, sizeof(replace));
+      if (replace.flags & JournalReplace::FLAG_CLEARS_REDO)
+        reverted.clear();
+      replace_strokes(strokes, replacements);
+      break;
+    }
+    }
+  }
+
+  if (offset < size)
+    std::cout << "Journal damaged after " << replayed
+              << " records; discarding the rest" << std::endl;
+  valid_size = offset;
+  return sequence;
+}
+
+void StrokeJournal::run() {
+  std::vector<unsigned char> batch;
+
+  while (true) {
+    uint64_t sequence;
+    bool compaction;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this] {
+        return m_stopping || !m_pending.empty() || m_compaction_requested;
+      });
+      if (m_stopping && m_pending.empty())
+        return;
+
+      // Everything appended since the last pass goes out in one write
+      batch.swap(m_pending);
+      sequence = m_next_sequence - 1;
+      compaction = m_compaction_requested;
+      m_compaction_requested = false;
+    }
+
+    if (!batch.empty())
+      write(batch);
+    batch.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_written_sequence = sequence;
+    }
+    m_written.notify_all();
+
+    bool oversized;
+    {
+      std::lock_guard<std::mutex> file_lock(m_file_mutex);
+      oversized = m_journal_size >= COMPACTION_THRESHOLD;
+    }
+    if (compaction || oversized)
+      compact();
+  }
+}
+
+void StrokeJournal::write(const std::vector<unsigned char> &data) {
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  if (m_fd < 0)
+    return;
+
+  if (!write_all(m_fd, data.data(), data.size()) || fdatasync(m_fd) != 0) {
+    std::cout << "Failed to write journal: " << m_journal_path << std::endl;
+    return;
+  }
+  m_journal_size += data.size();
+}
+
+void StrokeJournal::compact() {
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  if (m_fd < 0)
+    return;
+
+  auto start = std::chrono::steady_clock::now();
+
+  // 1. Current state; every appended record has been written by now
+  std::vector<Stroke> strokes;
+  std::vector<Stroke> reverted;
+  uint64_t valid_size = 0;
+  uint64_t sequence = read_state(m_document_path, m_journal_path, strokes,
+                                 reverted, valid_size);
+
+  // 2. New snapshot, durable (file and rename) before the records it
+  // replaces are dropped. If we crash in between, replay skips what the
+  // snapshot already has.
+  if (!save_document(m_document_path, strokes, reverted, sequence))
+    return;
+
+  // 3. Empty the journal
+  if (ftruncate(m_fd, sizeof(JournalHeader)) != 0 || fdatasync(m_fd) != 0) {
+    std::cout << "Failed to truncate journal: " << m_journal_path
+              << std::endl;
+    return;
+  }
+  lseek(m_fd, 0, SEEK_END);
+  m_journal_size = sizeof(JournalHeader);
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "compacted " << strokes.size() + reverted.size()
+            << " strokes into " << m_document_path << " in "
+            << elapsed.count() << " ms" << std::endl;
+}
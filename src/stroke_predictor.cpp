@@ -0,0 +1,126 @@
+#include "stroke_predictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Recent samples must span at least this long to give a velocity
+constexpr double MIN_TIME_SPAN = 0.001; // Seconds
+
+} // namespace
+
+void StrokePredictor::reset() {
+  m_history_next = 0;
+  m_history_size = 0;
+  m_has_prediction = false;
+}
+
+void StrokePredictor::add_sample(glm::dvec2 position, double time) {
+  // 1. Score the prediction that was on screen when this sample arrived
+  if (m_has_prediction && time > m_base && time <= m_base + m_horizon) {
+    float error = static_cast<float>(glm::distance(evaluate(time), position));
+    if (m_errors.size() < ERROR_HISTORY) {
+      m_errors.push_back(error);
+    } else {
+      m_errors[m_errors_next] = error;
+      m_errors_next = (m_errors_next + 1) % ERROR_HISTORY;
+    }
+  }
+
+  m_history[m_history_next] = {position, time};
+  m_history_next = (m_history_next + 1) % HISTORY_SAMPLES;
+  m_history_size = std::min(m_history_size + 1, HISTORY_SAMPLES);
+}
+
+bool StrokePredictor::predict(double horizon, std::vector<glm::dvec2> &points) {
+  m_has_prediction = false;
+  if (m_history_size < 2 || horizon <= 0.0)
+    return false;
+
+  // 1. Recent samples, with times relative to the newest (so t <= 0)
+  const Sample &last =
+      m_history[(m_history_next + HISTORY_SAMPLES - 1) % HISTORY_SAMPLES];
+  double sums[5] = {};         // sum of t^k, k = 0..4
+  glm::dvec2 moments[3] = {};  // sum of p * t^k, k = 0..2
+  double earliest = 0.0;
+  for (size_t i = 0; i < m_history_size; ++i) {
+    const Sample &sample =
+        m_history[(m_history_next + HISTORY_SAMPLES - 1 - i) % HISTORY_SAMPLES];
+    double t = sample.time - last.time;
+    if (t < -HISTORY_WINDOW)
+      break;
+
+    glm::dvec2 p = sample.position - last.position;
+    double power = 1.0;
+    for (int k = 0; k < 5; ++k) {
+      sums[k] += power;
+      if (k < 3)
+        moments[k] += p * power;
+      power *= t;
+    }
+    earliest = t;
+  }
+  if (sums[0] < 2.0 || -earliest < MIN_TIME_SPAN)
+    return false;
+
+  // 2. Least squares: a quadratic from three or more samples, a line from
+  // two. The normal equations are small enough for Cramer's rule; only the
+  // velocity and acceleration terms are needed, as the curve is moved onto
+  // the newest sample anyway.
+  const double *s = sums;
+  glm::dvec2 c1, c2 = {0.0, 0.0};
+  double det3 = s[0] * (s[2] * s[4] - s[3] * s[3]) -
+                s[1] * (s[1] * s[4] - s[3] * s[2]) +
+                s[2] * (s[1] * s[3] - s[2] * s[2]);
+  if (s[0] >= 3.0 && std::abs(det3) > 1e-12 * std::abs(s[0] * s[2] * s[4])) {
+    glm::dvec2 b0 = moments[0], b1 = moments[1], b2 = moments[2];
+    c1 = (s[0] * (b1 * s[4] - b2 * s[3]) - b0 * (s[1] * s[4] - s[3] * s[2]) +
+          s[2] * (b2 * s[1] - b1 * s[2])) /
+         det3;
+    c2 = (s[0] * (b2 * s[2] - b1 * s[3]) - s[1] * (b2 * s[1] - b1 * s[2]) +
+          b0 * (s[1] * s[3] - s[2] * s[2])) /
+         det3;
+  } else {
+    double det2 = s[0] * s[2] - s[1] * s[1];
+    if (std::abs(det2) <= 1e-12 * std::abs(s[0] * s[2]))
+      return false;
+    c1 = (moments[1] * s[0] - moments[0] * s[1]) / det2;
+  }
+
+  // 3. The fit through the newest sample, then points along it
+  m_has_prediction = true;
+  m_base = last.time;
+  m_horizon = std::min(horizon, MAX_HORIZON);
+  m_origin = last.position;
+  m_c1 = c1;
+  m_c2 = c2;
+
+  for (double t = TAIL_STEP; t < m_horizon; t += TAIL_STEP)
+    points.push_back(evaluate(m_base + t));
+  points.push_back(evaluate(m_base + m_horizon));
+  return true;
+}
+
+glm::dvec2 StrokePredictor::evaluate(double time) const {
+  double t = time - m_base;
+  return m_origin + m_c1 * t + m_c2 * (t * t);
+}
+
+StrokePredictor::ErrorStats StrokePredictor::get_error_stats() const {
+  if (m_errors.empty())
+    return {0, 0.0, 0.0, 0.0};
+
+  std::vector<float> sorted = m_errors;
+  std::sort(sorted.begin(), sorted.end());
+  double sum = 0.0;
+  for (float error : sorted)
+    sum += error;
+  return {sorted.size(), sum / static_cast<double>(sorted.size()),
+          sorted[(sorted.size() - 1) * 95 / 100], sorted.back()};
+}
+
+void StrokePredictor::clear_error_stats() {
+  m_errors.clear();
+  m_errors_next = 0;
+}
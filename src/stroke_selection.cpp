@@ -0,0 +1,163 @@
+#include "stroke_selection.h"
+#include "ribbon_kernel.h"
+
+#include <algorithm>
+
+namespace {
+
+bool contains(const AABB &outer, const AABB &inner) {
+  return inner.min.x >= outer.min.x && inner.min.y >= outer.min.y &&
+         inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+double rect_distance_squared(const AABB &rect, glm::dvec2 point) {
+  glm::dvec2 outside = glm::max(glm::max(rect.min - point, point - rect.max),
+                                glm::dvec2(0.0));
+  return glm::dot(outside, outside);
+}
+
+// Liang-Barsky: does the segment [a, b] cross the rectangle?
+bool segment_crosses_rect(glm::dvec2 a, glm::dvec2 b, const AABB &rect) {
+  glm::dvec2 d = b - a;
+  double t0 = 0.0;
+  double t1 = 1.0;
+  double p[4] = {-d.x, d.x, -d.y, d.y};
+  double q[4] = {a.x - rect.min.x, rect.max.x - a.x, a.y - rect.min.y,
+                 rect.max.y - a.y};
+
+  for (int i = 0; i < 4; ++i) {
+    if (p[i] == 0.0) {
+      if (q[i] < 0.0)
+        return false;
+      continue;
+    }
+    double t = q[i] / p[i];
+    if (p[i] < 0.0)
+      t0 = std::max(t0, t);
+    else
+      t1 = std::min(t1, t);
+    if (t0 > t1)
+      return false;
+  }
+  return true;
+}
+
+// The closest points of a segment and a rectangle that do not intersect
+// are a segment endpoint or a rectangle corner, so the ribbon touches the
+// rectangle iff one of those is within reach of the other shape.
+bool ribbon_touches_rect(std::span<const glm::dvec2> centerline,
+                         double radius, const AABB &rect) {
+  double reach2 = radius * radius;
+  for (const glm::dvec2 &point : centerline) {
+    if (rect_distance_squared(rect, point) <= reach2)
+      return true;
+  }
+  for (size_t i = 0; i + 1 < centerline.size(); ++i) {
+    if (segment_crosses_rect(centerline[i], centerline[i + 1], rect))
+      return true;
+  }
+
+  glm::dvec2 corners[4] = {rect.min,
+                           {rect.max.x, rect.min.y},
+                           rect.max,
+                           {rect.min.x, rect.max.y}};
+  for (const glm::dvec2 &corner : corners) {
+    if (polyline_distance_squared(centerline.data(), centerline.size(), corner,
+                                  reach2) <= reach2)
+      return true;
+  }
+  return false;
+}
+
+bool inside_polygon(std::span<const glm::dvec2> polygon, glm::dvec2 point) {
+  bool inside = false;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    glm::dvec2 a = polygon[i];
+    glm::dvec2 b = polygon[j];
+    if ((a.y > point.y) != (b.y > point.y) &&
+        point.x < a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y))
+      inside = !inside;
+  }
+  return inside;
+}
+
+} // namespace
+
+bool pick_stroke(std::span<const Stroke> strokes, SpatialIndex &index,
+                 glm::dvec2 point, double tolerance, uint32_t &picked) {
+  static thread_local std::vector<uint32_t> candidates;
+  candidates.clear();
+  index.query({point - glm::dvec2(tolerance), point + glm::dvec2(tolerance)},
+              candidates);
+
+  // Topmost first: later strokes are drawn over earlier ones
+  for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+    const Stroke &stroke = strokes[*it];
+    if (stroke.is_eraser()) {
+      if (stroke.hits(point))
+        return false;
+      continue;
+    }
+    if (stroke.hits(point, tolerance)) {
+      picked = *it;
+      return true;
+    }
+  }
+  return false;
+}
+
+void select_in_rect(std::span<const Stroke> strokes, SpatialIndex &index,
+                    const AABB &area, std::vector<uint32_t> &out) {
+  static thread_local std::vector<uint32_t> candidates;
+  static thread_local std::vector<glm::dvec2> storage;
+  candidates.clear();
+  index.query(area, candidates);
+
+  for (uint32_t id : candidates) {
+    const Stroke &stroke = strokes[id];
+    if (stroke.is_eraser())
+      continue;
+
+    if (contains(area, stroke.get_bounds()) ||
+        ribbon_touches_rect(stroke.get_centerline(storage),
+                            stroke.get_thickness() * 0.5, area))
+      out.push_back(id);
+  }
+}
+
+void select_in_lasso(std::span<const Stroke> strokes, SpatialIndex &index,
+                     std::span<const glm::dvec2> lasso,
+                     std::vector<uint32_t> &out) {
+  if (lasso.size() < 3)
+    return;
+
+  static thread_local std::vector<uint32_t> candidates;
+  static thread_local std::vector<glm::dvec2> storage;
+
+  AABB area = {lasso.front(), lasso.front()};
+  for (const glm::dvec2 &point : lasso) {
+    area.min = glm::min(area.min, point);
+    area.max = glm::max(area.max, point);
+  }
+  candidates.clear();
+  index.query(area, candidates);
+
+  for (uint32_t id : candidates) {
+    const Stroke &stroke = strokes[id];
+    if (stroke.is_eraser())
+      continue;
+
+    // An enclosed centerline keeps the ribbon within radius of the area
+    glm::dvec2 radius(stroke.get_thickness() * 0.5);
+    if (!contains({area.min - radius, area.max + radius}, stroke.get_bounds()))
+      continue;
+
+    std::span<const glm::dvec2> centerline = stroke.get_centerline(storage);
+    if (!centerline.empty() &&
+        std::all_of(centerline.begin(), centerline.end(),
+                    [&](glm::dvec2 point) {
+                      return inside_polygon(lasso, point);
+                    }))
+      out.push_back(id);
+  }
+}
@@ -0,0 +1,66 @@
+#include "stroke_style.h"
+
+#include "glad/gl.h"
+#include <algorithm>
+
+StrokeStyleTable &StrokeStyleTable::instance() {
+  static StrokeStyleTable table;
+  return table;
+}
+
+uint32_t StrokeStyleTable::allocate() {
+  if (!m_free_slots.empty()) {
+    uint32_t slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    return slot;
+  }
+
+  m_styles.push_back({});
+  return static_cast<uint32_t>(m_styles.size() - 1);
+}
+
+void StrokeStyleTable::release(uint32_t slot) {
+  if (slot == INVALID_SLOT)
+    return;
+
+  m_free_slots.push_back(slot);
+}
+
+void StrokeStyleTable::set(uint32_t slot, const StrokeStyle &style) {
+  m_styles[slot] = style;
+  m_dirty_begin = std::min<size_t>(m_dirty_begin, slot);
+  m_dirty_end = std::max<size_t>(m_dirty_end, slot + 1);
+}
+
+void StrokeStyleTable::bind() {
+  if (m_ssbo == 0)
+    glCreateBuffers(1, &m_ssbo);
+
+  if (m_styles.size() > m_gpu_capacity) {
+    // Grow geometrically and re-upload everything
+    m_gpu_capacity = std::max<size_t>(m_styles.size(), m_gpu_capacity * 2);
+    m_gpu_capacity = std::max<size_t>(m_gpu_capacity, 64);
+
+    glNamedBufferData(m_ssbo, m_gpu_capacity * sizeof(StrokeStyle), nullptr,
+                      GL_DYNAMIC_DRAW);
+    glNamedBufferSubData(m_ssbo, 0, m_styles.size() * sizeof(StrokeStyle),
+                         m_styles.data());
+  } else if (m_dirty_begin < m_dirty_end) {
+    glNamedBufferSubData(m_ssbo, m_dirty_begin * sizeof(StrokeStyle),
+                         (m_dirty_end - m_dirty_begin) * sizeof(StrokeStyle),
+                         m_styles.data() + m_dirty_begin);
+  }
+
+  m_dirty_begin = SIZE_MAX;
+  m_dirty_end = 0;
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, m_ssbo);
+}
+
+void StrokeStyleTable::destroy() {
+  if (m_ssbo != 0) {
+    glDeleteBuffers(1, &m_ssbo);
+    m_ssbo = 0;
+  }
+  m_gpu_capacity = 0;
+}
@@ -0,0 +1,122 @@
+#include "task_scheduler.h"
+
+namespace {
+
+// Queue of the pool the current thread works for, if any
+thread_local const TaskScheduler *t_owner = nullptr;
+thread_local size_t t_queue = 0;
+
+// Spins before a worker goes to sleep, to catch bursts of small tasks
+constexpr int IDLE_SPINS = 64;
+
+} // namespace
+
+unsigned TaskScheduler::default_worker_count() {
+  unsigned hardware = std::thread::hardware_concurrency();
+  return hardware > 1 ? hardware - 1 : 0;
+}
+
+TaskScheduler::TaskScheduler(unsigned worker_count) {
+  for (unsigned i = 0; i <= worker_count; ++i)
+    m_queues.push_back(std::make_unique<WorkQueue>());
+
+  for (unsigned i = 0; i < worker_count; ++i)
+    m_workers.emplace_back(&TaskScheduler::worker_loop, this, i);
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    m_stopping = true;
+  }
+  m_sleep.notify_all();
+
+  for (std::thread &worker : m_workers)
+    worker.join();
+}
+
+void TaskScheduler::spawn(TaskGroup &group, Task fn) {
+  group.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+  WorkQueue &queue = *m_queues[current_queue()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back({std::move(fn), &group});
+  }
+  m_queued.fetch_add(1, std::memory_order_release);
+
+  // Taking the lock orders this with a worker that is about to sleep
+  { std::lock_guard<std::mutex> lock(m_sleep_mutex); }
+  m_sleep.notify_one();
+}
+
+void TaskScheduler::wait(TaskGroup &group) {
+  size_t home = current_queue();
+  while (!group.is_done()) {
+    if (!run_one(home))
+      std::this_thread::yield();
+  }
+}
+
+size_t TaskScheduler::current_queue() const {
+  return t_owner == this ? t_queue : m_queues.size() - 1;
+}
+
+bool TaskScheduler::run_one(size_t home) {
+  QueuedTask task;
+  bool found = false;
+
+  // 1. Newest task of our own queue
+  {
+    WorkQueue &own = *m_queues[home];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      found = true;
+    }
+  }
+
+  // 2. Otherwise steal the oldest task of another queue
+  for (size_t i = 1; !found && i < m_queues.size(); ++i) {
+    WorkQueue &victim = *m_queues[(home + i) % m_queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      found = true;
+    }
+  }
+
+  if (!found)
+    return false;
+
+  m_queued.fetch_sub(1, std::memory_order_relaxed);
+  task.fn();
+  task.group->m_pending.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+void TaskScheduler::worker_loop(size_t index) {
+  t_owner = this;
+  t_queue = index;
+
+  int idle = 0;
+  while (!m_stopping.load(std::memory_order_relaxed)) {
+    if (run_one(index)) {
+      idle = 0;
+      continue;
+    }
+
+    if (++idle < IDLE_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+    m_sleep.wait(lock, [this] {
+      return m_stopping || m_queued.load(std::memory_order_acquire) > 0;
+    });
+    idle = 0;
+  }
+}
@@ -0,0 +1,295 @@
+// simple-paint-thumbnail: renders every document in a directory to a PNG,
+// without a window or display server.
+//
+//   simple-paint-thumbnail <input dir> <output dir> [--size N]
+//                          [--background RRGGBB|transparent] [--margin F]
+//                          [--software]
+//
+// One GL context renders the documents one after another; their PNGs are
+// composited and compressed on the task pool while the next one renders.
+// Without a GL context (or with --software) the CPU rasterizer draws them.
+
+#include "canvas_renderer.h"
+#include "png_writer.h"
+#include "software_rasterizer.h"
+#include "stroke.h"
+#include "stroke_journal.h"
+#include "task_scheduler.h"
+#include "vertex_arena.h"
+
+#include <glm/glm.hpp>
+
+#if SIMPLE_PAINT_HAS_EGL
+#include "offscreen_context.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef ASSETS_PATH
+#define ASSETS_PATH "./assets"
+#endif
+
+#ifndef SHADER_PATH
+#define SHADER_PATH ASSETS_PATH "/shaders"
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char *STROKE_VERTEX_SHADER_PATH = SHADER_PATH "/stroke.vert.glsl";
+const char *STROKE_FRAGMENT_SHADER_PATH = SHADER_PATH "/stroke.frag.glsl";
+const char *DOCUMENT_EXTENSION = ".spd";
+
+// Vertices per shared arena block, as in the app
+constexpr uint32_t ARENA_BLOCK_VERTICES = 1u << 20;
+
+struct Options {
+  fs::path input;
+  fs::path output;
+  int size = 512;                             // Longer image side, in pixels
+  double margin = 0.02;                       // Of the drawing, per side
+  glm::vec4 background = {0.0, 0.0, 0.0, 1.0}; // Straight alpha
+  bool software = false;                       // Skip the GL context
+};
+
+void print_usage() {
+  std::cout << "usage: simple-paint-thumbnail <input dir> <output dir> "
+               "[--size N] [--background RRGGBB|transparent] [--margin F] "
+               "[--software]"
+            << std::endl;
+}
+
+bool parse_color(const std::string &text, glm::vec4 &color) {
+  if (text == "transparent") {
+    color = {0.0f, 0.0f, 0.0f, 0.0f};
+    return true;
+  }
+  if (text.size() != 6 ||
+      text.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+    return false;
+
+  unsigned long rgb = std::stoul(text, nullptr, 16);
+  color = {static_cast<float>((rgb >> 16) & 0xff) / 255.0f,
+           static_cast<float>((rgb >> 8) & 0xff) / 255.0f,
+           static_cast<float>(rgb & 0xff) / 255.0f, 1.0f};
+  return true;
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--size" && has_value) {
+      options.size = std::atoi(argv[++i]);
+      if (options.size <= 0)
+        return false;
+    } else if (arg == "--margin" && has_value) {
+      options.margin = std::atof(argv[++i]);
+      if (options.margin < 0.0)
+        return false;
+    } else if (arg == "--background" && has_value) {
+      if (!parse_color(argv[++i], options.background))
+        return false;
+    } else if (arg == "--software") {
+      options.software = true;
+    } else if (arg.starts_with("--")) {
+      return false;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 2)
+    return false;
+
+  options.input = positional[0];
+  options.output = positional[1];
+  return true;
+}
+
+// Puts the premultiplied image over `background` and converts it to the
+// straight alpha a PNG stores
+void flatten(std::vector<uint8_t> &rgba, glm::vec4 background) {
+  glm::vec3 under = glm::vec3(background) * background.a;
+  for (size_t i = 0; i + 4 <= rgba.size(); i += 4) {
+    float alpha = rgba[i + 3] / 255.0f;
+    float out_alpha = alpha + background.a * (1.0f - alpha);
+
+    for (int c = 0; c < 3; ++c) {
+      float color = rgba[i + c] / 255.0f + under[c] * (1.0f - alpha);
+      if (out_alpha > 0.0f)
+        color /= out_alpha;
+      rgba[i + c] = static_cast<uint8_t>(
+          glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    rgba[i + 3] = static_cast<uint8_t>(out_alpha * 255.0f + 0.5f);
+  }
+}
+
+// Everything drawn plus the margin, and the image size that keeps its
+// aspect with the longer side at `size` pixels
+AABB fit_view(const std::vector<Stroke> &strokes, const Options &options,
+              int size, int &width, int &height) {
+  AABB view = {{-1.0, -1.0}, {1.0, 1.0}};
+  if (!strokes.empty()) {
+    view = strokes.front().get_bounds();
+    for (const Stroke &stroke : strokes) {
+      view.min = glm::min(view.min, stroke.get_bounds().min);
+      view.max = glm::max(view.max, stroke.get_bounds().max);
+    }
+  }
+
+  glm::dvec2 extent = view.max - view.min;
+  double side = glm::max(glm::max(extent.x, extent.y), 1e-9);
+  glm::dvec2 margin = glm::dvec2(side * options.margin);
+  view.min -= margin;
+  view.max += margin;
+  extent = view.max - view.min;
+
+  double scale = size / glm::max(extent.x, extent.y);
+  width = glm::max(1, static_cast<int>(extent.x * scale + 0.5));
+  height = glm::max(1, static_cast<int>(extent.y * scale + 0.5));
+  return view;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  // 1. Documents to render, in name order
+  std::vector<fs::path> documents;
+  std::error_code error;
+  for (const fs::directory_entry &entry :
+       fs::directory_iterator(options.input, error)) {
+    if (entry.is_regular_file() &&
+        entry.path().extension() == DOCUMENT_EXTENSION)
+      documents.push_back(entry.path());
+  }
+  if (error) {
+    std::cout << "Failed to read " << options.input << ": " << error.message()
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::sort(documents.begin(), documents.end());
+
+  fs::create_directories(options.output, error);
+  if (error) {
+    std::cout << "Failed to create " << options.output << ": "
+              << error.message() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // 2. One context for every document, or the CPU if there is none
+  TaskScheduler scheduler;
+  std::string backend;
+#if SIMPLE_PAINT_HAS_EGL
+  std::unique_ptr<OffscreenContext> context;
+  if (!options.software) {
+    context = OffscreenContext::create();
+    if (context)
+      backend = context->get_description();
+    else
+      std::cout << "Falling back to the software rasterizer" << std::endl;
+  }
+#endif
+  if (backend.empty()) {
+    backend = std::string("the software rasterizer (") +
+              simd_level_name(detect_simd_level()) + ")";
+  }
+  std::cout << "rendering " << documents.size() << " documents with "
+            << backend << std::endl;
+
+  auto start = std::chrono::steady_clock::now();
+  TaskScheduler::TaskGroup encoding;
+  std::atomic<size_t> failures{0};
+  {
+    // Declared before the strokes so it outlives their allocations
+    VertexArena arena{sizeof(PointVertex), ARENA_BLOCK_VERTICES};
+    std::unique_ptr<CanvasRenderer> renderer;
+#if SIMPLE_PAINT_HAS_EGL
+    if (context) {
+      renderer = std::make_unique<CanvasRenderer>(STROKE_VERTEX_SHADER_PATH,
+                                                  STROKE_FRAGMENT_SHADER_PATH);
+    }
+#endif
+    SoftwareRasterizer rasterizer(scheduler);
+    int size = options.size;
+    if (renderer)
+      size = glm::min(size, CanvasRenderer::get_max_size());
+
+    std::vector<Stroke> strokes;
+    std::vector<Stroke> reverted;
+    for (const fs::path &document : documents) {
+      // 3. Snapshot plus journal, read only
+      strokes.clear();
+      reverted.clear();
+      StrokeJournal::read(document.string(), strokes, reverted);
+      reverted.clear();
+
+      int width, height;
+      AABB view = fit_view(strokes, options, size, width, height);
+
+      // 4. On the GPU: geometry on every core, uploaded in one batch, then
+      // drawn. The CPU draws straight from the centerlines.
+      auto pixels = std::make_shared<std::vector<uint8_t>>();
+      bool rendered;
+      if (renderer) {
+        rebuild_strokes(strokes, scheduler);
+        arena.begin_batch();
+        for (Stroke &stroke : strokes)
+          stroke.upload(arena);
+        arena.end_batch();
+
+        rendered = renderer->render(strokes, view, width, height);
+        if (rendered)
+          renderer->read_pixels(*pixels);
+      } else {
+        rendered = rasterizer.render(strokes, view, width, height, *pixels);
+      }
+      if (!rendered) {
+        std::cout << "Failed to render " << document << std::endl;
+        failures++;
+        continue;
+      }
+
+      // 5. Encoding overlaps with the next document
+      fs::path target =
+          options.output / document.filename().replace_extension(".png");
+      glm::vec4 background = options.background;
+
+      scheduler.spawn(encoding, [pixels, target, width, height, background,
+                                 &failures] {
+        flatten(*pixels, background);
+        if (!write_png(target.string(), width, height, *pixels))
+          failures++;
+      });
+
+      strokes.clear();
+      arena.collect();
+    }
+  }
+  scheduler.wait(encoding);
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "rendered " << documents.size() - failures << " / "
+            << documents.size() << " documents in " << elapsed.count()
+            << " s on " << scheduler.get_thread_count() << " threads"
+            << std::endl;
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
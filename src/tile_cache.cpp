@@ -0,0 +1,165 @@
+#include "tile_cache.h"
+
+#include "glad/gl.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+TileCache::TileCache(const std::vector<Stroke> &strokes, SpatialIndex &index,
+                     size_t budget_bytes)
+    : m_strokes(strokes), m_index(index),
+      m_capacity(std::max<size_t>(budget_bytes / TILE_BYTES, 1)) {}
+
+TileCache::~TileCache() { clear(); }
+
+bool TileCache::draw(const AABB &view, double pixel_size,
+                     const glm::mat4 &projection, const Shader &stroke_shader,
+                     GLuint stroke_vao, const Shader &tile_shader) {
+  // 1. Zoom bucket: the largest power-of-two texel not above a pixel
+  int level = static_cast<int>(std::floor(std::log2(pixel_size)));
+  double texel_size = std::ldexp(1.0, level);
+  double tile_size = texel_size * TILE_PIXELS;
+
+  int64_t x0 = static_cast<int64_t>(std::floor(view.min.x / tile_size));
+  int64_t y0 = static_cast<int64_t>(std::floor(view.min.y / tile_size));
+  int64_t x1 = static_cast<int64_t>(std::floor(view.max.x / tile_size));
+  int64_t y1 = static_cast<int64_t>(std::floor(view.max.y / tile_size));
+
+  // Every visible tile has to stay resident until it is composited
+  if (static_cast<size_t>((x1 - x0 + 1) * (y1 - y0 + 1)) > m_capacity)
+    return false;
+
+  // 2. Look up (or recycle) the visible tiles
+  m_frame_tiles.clear();
+  m_dirty_tiles.clear();
+  for (int64_t y = y0; y <= y1; ++y) {
+    for (int64_t x = x0; x <= x1; ++x) {
+      Tile &tile = acquire(
+          {level, static_cast<int32_t>(x), static_cast<int32_t>(y)}, tile_size);
+      m_frame_tiles.push_back(&tile);
+      if (tile.dirty)
+        m_dirty_tiles.push_back(&tile);
+    }
+  }
+
+  // 3. Rasterize what is missing or stale
+  render_tiles(texel_size, stroke_shader, stroke_vao);
+
+  // 4. Composite: one textured quad per tile
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  tile_shader.use();
+  tile_shader.setMat4("u_projection", projection);
+  for (const Tile *tile : m_frame_tiles) {
+    glm::mat4 model = glm::translate(
+        glm::mat4(1.0f), glm::vec3(glm::vec2(tile->bounds.min), 0.0f));
+    model = glm::scale(model, glm::vec3(static_cast<float>(tile_size),
+                                        static_cast<float>(tile_size), 1.0f));
+
+    tile_shader.setMat4("u_model", model);
+    glBindTextureUnit(0, tile->texture);
+    draw_quad();
+  }
+
+  return true;
+}
+
+void TileCache::invalidate(const AABB &bounds) {
+  for (Tile &tile : m_tiles) {
+    if (tile.bounds.intersects(bounds))
+      tile.dirty = true;
+  }
+}
+
+void TileCache::clear() {
+  for (Tile &tile : m_tiles) {
+    glDeleteFramebuffers(1, &tile.fbo);
+    glDeleteTextures(1, &tile.texture);
+  }
+  m_tiles.clear();
+  m_lookup.clear();
+}
+
+TileCache::Tile &TileCache::acquire(const TileKey &key, double tile_size) {
+  auto found = m_lookup.find(key);
+  if (found != m_lookup.end()) {
+    m_tiles.splice(m_tiles.begin(), m_tiles, found->second);
+    return m_tiles.front();
+  }
+
+  if (m_tiles.size() < m_capacity) {
+    // Grow the pool
+    Tile &tile = m_tiles.emplace_front();
+    glCreateTextures(GL_TEXTURE_2D, 1, &tile.texture);
+    glTextureStorage2D(tile.texture, 1, GL_RGBA8, TILE_PIXELS, TILE_PIXELS);
+    glTextureParameteri(tile.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(tile.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(tile.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(tile.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glCreateFramebuffers(1, &tile.fbo);
+    glNamedFramebufferTexture(tile.fbo, GL_COLOR_ATTACHMENT0, tile.texture, 0);
+  } else {
+    // Recycle the least recently used tile
+    m_tiles.splice(m_tiles.begin(), m_tiles, std::prev(m_tiles.end()));
+    m_lookup.erase(m_tiles.front().key);
+  }
+
+  Tile &tile = m_tiles.front();
+  tile.key = key;
+  tile.bounds.min = {key.x * tile_size, key.y * tile_size};
+  tile.bounds.max = tile.bounds.min + glm::dvec2(tile_size);
+  tile.dirty = true;
+  m_lookup[key] = m_tiles.begin();
+  return tile;
+}
+
+void TileCache::render_tiles(double texel_size, const Shader &stroke_shader,
+                             GLuint stroke_vao) {
+  m_rendered_last_frame = m_dirty_tiles.size();
+  if (m_dirty_tiles.empty())
+    return;
+
+  // 1. One command group per tile, uploaded together
+  m_batch.begin();
+  for (const Tile *tile : m_dirty_tiles) {
+    m_batch.begin_group();
+
+    m_visible.clear();
+    m_index.query(tile->bounds, m_visible);
+    for (uint32_t index : m_visible) {
+      const Stroke &stroke = m_strokes[index];
+      m_batch.add(stroke, stroke.select_lod(texel_size));
+    }
+  }
+  m_batch.upload();
+
+  // 2. Draw each group into its tile
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glViewport(0, 0, TILE_PIXELS, TILE_PIXELS);
+
+  stroke_shader.use();
+  glBindVertexArray(stroke_vao);
+
+  const GLfloat transparent[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (size_t i = 0; i < m_dirty_tiles.size(); ++i) {
+    Tile *tile = m_dirty_tiles[i];
+    glBindFramebuffer(GL_FRAMEBUFFER, tile->fbo);
+    glClearNamedFramebufferfv(tile->fbo, GL_COLOR, 0, transparent);
+
+    glm::mat4 projection = glm::ortho(
+        static_cast<float>(tile->bounds.min.x),
+        static_cast<float>(tile->bounds.max.x),
+        static_cast<float>(tile->bounds.min.y),
+        static_cast<float>(tile->bounds.max.y), -1.0f, 1.0f);
+    stroke_shader.setMat4("u_projection", projection);
+
+    m_batch.draw_group(stroke_vao, i);
+    tile->dirty = false;
+  }
+  m_batch.end_frame();
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
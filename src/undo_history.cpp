@@ -0,0 +1,118 @@
+#include "undo_history.h"
+
+#include <iostream>
+#include <memory>
+
+UndoHistory::UndoHistory(size_t budget) : m_budget(budget) {}
+
+UndoHistory::~UndoHistory() {
+  if (m_spill_file)
+    std::fclose(m_spill_file); // Deleted by the system on close
+}
+
+void UndoHistory::push(Stroke &&stroke) {
+  stroke.release_geometry();
+  m_resident_bytes += stroke.get_memory_size();
+  m_resident.push_back(std::move(stroke));
+  enforce_budget();
+}
+
+Stroke UndoHistory::pop() {
+  if (m_resident.empty())
+    return unspill_newest();
+
+  Stroke stroke = std::move(m_resident.back());
+  m_resident.pop_back();
+  m_resident_bytes -= stroke.get_memory_size();
+  return stroke;
+}
+
+void UndoHistory::clear() {
+  m_resident.clear();
+  m_spilled.clear();
+  m_resident_bytes = 0;
+  m_spill_size = 0; // Old contents are overwritten as needed
+}
+
+bool UndoHistory::adopt_geometry(Stroke &&finished) {
+  for (auto it = m_resident.rbegin(); it != m_resident.rend(); ++it) {
+    if (it->get_id() != finished.get_id())
+      continue;
+
+    m_resident_bytes -= it->get_memory_size();
+    it->adopt_geometry(std::move(finished));
+    it->release_geometry();
+    m_resident_bytes += it->get_memory_size();
+    return true;
+  }
+  return false;
+}
+
+void UndoHistory::set_budget(size_t bytes) {
+  m_budget = bytes;
+  enforce_budget();
+}
+
+void UndoHistory::enforce_budget() {
+  while (m_resident_bytes > m_budget && !m_resident.empty()) {
+    if (!spill_oldest())
+      return;
+  }
+}
+
+bool UndoHistory::spill_oldest() {
+  if (!m_spill_file) {
+    m_spill_file = std::tmpfile();
+    if (!m_spill_file) {
+      std::cout << "Failed to create undo spill file; keeping history in "
+                   "memory"
+                << std::endl;
+      m_budget = SIZE_MAX;
+      return false;
+    }
+  }
+
+  // 1. Append the points after the strokes spilled before
+  Stroke &stroke = m_resident.front();
+  std::span<const glm::dvec2> points =
+      stroke.get_raw_points().contiguous(m_scratch);
+
+  if (std::fseek(m_spill_file, static_cast<long>(m_spill_size), SEEK_SET) !=
+          0 ||
+      std::fwrite(points.data(), sizeof(glm::dvec2), points.size(),
+                  m_spill_file) != points.size()) {
+    std::cout << "Failed to spill undo history; keeping it in memory"
+              << std::endl;
+    m_budget = SIZE_MAX;
+    return false;
+  }
+
+  // 2. Only the table entry stays in memory
+  m_spilled.push_back({make_stroke_record(stroke, 0), m_spill_size});
+  m_spill_size += points.size_bytes();
+  m_resident_bytes -= stroke.get_memory_size();
+  m_resident.pop_front();
+  return true;
+}
+
+Stroke UndoHistory::unspill_newest() {
+  SpilledStroke spilled = m_spilled.back();
+  m_spilled.pop_back();
+  m_spill_size = spilled.offset;
+
+  auto points = std::make_shared<std::vector<glm::dvec2>>(
+      spilled.record.point_count);
+  std::fflush(m_spill_file);
+  if (std::fseek(m_spill_file, static_cast<long>(spilled.offset),
+                 SEEK_SET) != 0 ||
+      std::fread(points->data(), sizeof(glm::dvec2), points->size(),
+                 m_spill_file) != points->size()) {
+    std::cout << "Failed to read back undo history" << std::endl;
+    points->clear();
+  }
+
+  // Attached to the buffer only until packed again
+  Stroke stroke = make_stroke(spilled.record, *points, points);
+  stroke.pack_points();
+  return stroke;
+}
@@ -0,0 +1,184 @@
+#include "vector_eraser.h"
+#include "geometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// A range of centerline parameters s = i + t, t along raw segment i
+struct Interval {
+  double begin;
+  double end;
+};
+
+struct EraserSegment {
+  glm::dvec2 a;
+  glm::dvec2 b;
+  AABB bounds; // Of the capsule
+};
+
+// Pieces shorter than this (in segment parameters) are rounding leftovers
+constexpr double MIN_PIECE_PARAMETER = 1e-6;
+
+double cross(glm::dvec2 a, glm::dvec2 b) { return a.x * b.y - a.y * b.x; }
+
+// Narrows [t0, t1] to where lo <= f0 + f1 * t <= hi. Returns false if
+// nothing is left.
+bool clip_linear(double f0, double f1, double lo, double hi, double &t0,
+                 double &t1) {
+  if (f1 == 0.0)
+    return f0 >= lo && f0 <= hi;
+
+  double a = (lo - f0) / f1;
+  double b = (hi - f0) / f1;
+  if (a > b)
+    std::swap(a, b);
+  t0 = std::max(t0, a);
+  t1 = std::min(t1, b);
+  return t0 <= t1;
+}
+
+// Widens [t0, t1] by the parameters where p + t * d is inside the circle
+void add_circle(glm::dvec2 p, glm::dvec2 d, glm::dvec2 center, double radius,
+                double &t0, double &t1) {
+  glm::dvec2 f = p - center;
+  double a = glm::dot(d, d);
+  double b = glm::dot(f, d);
+  double c = glm::dot(f, f) - radius * radius;
+
+  if (a == 0.0) {
+    if (c <= 0.0) {
+      t0 = -std::numeric_limits<double>::infinity();
+      t1 = std::numeric_limits<double>::infinity();
+    }
+    return;
+  }
+
+  double discriminant = b * b - a * c;
+  if (discriminant < 0.0)
+    return;
+  double root = std::sqrt(discriminant);
+  t0 = std::min(t0, (-b - root) / a);
+  t1 = std::max(t1, (-b + root) / a);
+}
+
+// Parameters t where p + t * d lies inside the capsule of `radius` around
+// [a, b]. The capsule is convex, so this is one interval: the union of
+// the ranges inside its end circles and inside the band between them.
+bool capsule_interval(glm::dvec2 p, glm::dvec2 d, glm::dvec2 a, glm::dvec2 b,
+                      double radius, Interval &out) {
+  double t0 = std::numeric_limits<double>::infinity();
+  double t1 = -std::numeric_limits<double>::infinity();
+  add_circle(p, d, a, radius, t0, t1);
+  add_circle(p, d, b, radius, t0, t1);
+
+  glm::dvec2 axis = b - a;
+  double length2 = glm::dot(axis, axis);
+  if (length2 > 0.0) {
+    glm::dvec2 f = p - a;
+    double reach = radius * std::sqrt(length2);
+    double s0 = -std::numeric_limits<double>::infinity();
+    double s1 = std::numeric_limits<double>::infinity();
+    if (clip_linear(cross(axis, f), cross(axis, d), -reach, reach, s0, s1) &&
+        clip_linear(glm::dot(axis, f), glm::dot(axis, d), 0.0, length2, s0,
+                    s1)) {
+      t0 = std::min(t0, s0);
+      t1 = std::max(t1, s1);
+    }
+  }
+
+  if (t0 > t1)
+    return false;
+  out = {t0, t1};
+  return true;
+}
+
+} // namespace
+
+bool erase_along_path(const RawPointView &points,
+                      std::span<const glm::dvec2> path, double radius,
+                      std::vector<std::vector<glm::dvec2>> &pieces) {
+  static thread_local std::vector<glm::dvec2> storage;
+  static thread_local std::vector<EraserSegment> segments;
+  static thread_local std::vector<Interval> erased;
+
+  pieces.clear();
+  std::span<const glm::dvec2> raw = points.contiguous(storage);
+  if (raw.empty() || path.empty())
+    return false;
+
+  // 1. Eraser capsules; a single sample is a dot
+  segments.clear();
+  for (size_t i = 0; i == 0 || i + 1 < path.size(); ++i) {
+    glm::dvec2 a = path[i];
+    glm::dvec2 b = path[std::min(i + 1, path.size() - 1)];
+    segments.push_back({a, b,
+                        {glm::min(a, b) - glm::dvec2(radius),
+                         glm::max(a, b) + glm::dvec2(radius)}});
+  }
+
+  if (raw.size() == 1) {
+    Interval unused;
+    for (const EraserSegment &segment : segments) {
+      if (capsule_interval(raw[0], glm::dvec2(0.0), segment.a, segment.b,
+                           radius, unused))
+        return true; // A dot is erased whole
+    }
+    return false;
+  }
+
+  // 2. Erased parameter ranges, segment by segment
+  erased.clear();
+  for (size_t i = 0; i + 1 < raw.size(); ++i) {
+    glm::dvec2 p = raw[i];
+    glm::dvec2 d = raw[i + 1] - p;
+    AABB bounds = {glm::min(p, raw[i + 1]), glm::max(p, raw[i + 1])};
+
+    for (const EraserSegment &segment : segments) {
+      Interval t;
+      if (!segment.bounds.intersects(bounds) ||
+          !capsule_interval(p, d, segment.a, segment.b, radius, t))
+        continue;
+
+      t.begin = std::max(t.begin, 0.0);
+      t.end = std::min(t.end, 1.0);
+      if (t.begin <= t.end)
+        erased.push_back({static_cast<double>(i) + t.begin,
+                          static_cast<double>(i) + t.end});
+    }
+  }
+  if (erased.empty())
+    return false;
+
+  // 3. What is left between the merged ranges are the pieces
+  std::sort(erased.begin(), erased.end(),
+            [](const Interval &a, const Interval &b) {
+              return a.begin < b.begin;
+            });
+
+  size_t last = raw.size() - 1;
+  auto point_at = [&](double s) {
+    size_t i = std::min(static_cast<size_t>(s), last - 1);
+    return glm::mix(raw[i], raw[i + 1], s - static_cast<double>(i));
+  };
+  auto keep = [&](double from, double to) {
+    if (to - from <= MIN_PIECE_PARAMETER)
+      return;
+    std::vector<glm::dvec2> &piece = pieces.emplace_back();
+    piece.push_back(point_at(from));
+    for (size_t k = static_cast<size_t>(from) + 1;
+         static_cast<double>(k) < to; ++k)
+      piece.push_back(raw[k]);
+    piece.push_back(point_at(to));
+  };
+
+  double cursor = 0.0;
+  for (const Interval &interval : erased) {
+    keep(cursor, interval.begin);
+    cursor = std::max(cursor, interval.end);
+  }
+  keep(cursor, static_cast<double>(last));
+  return true;
+}
@@ -0,0 +1,310 @@
+#include "vertex_arena.h"
+
+#include "glad/gl.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Compact a block once at least this share of it is free...
+constexpr double DEFRAG_MIN_FREE = 0.25;
+// ...and the largest free range holds less than half of that free space
+constexpr double DEFRAG_MIN_FRAGMENTATION = 0.5;
+
+} // namespace
+
+VertexArena::VertexArena(size_t element_size, uint32_t block_elements)
+    : m_element_size(element_size), m_block_elements(block_elements) {}
+
+VertexArena::~VertexArena() {
+  for (Block &block : m_blocks) {
+    if (block.buffer != 0)
+      glDeleteBuffers(1, &block.buffer);
+  }
+}
+
+VertexArena::Handle VertexArena::allocate(uint32_t count) {
+  if (count == 0)
+    return INVALID_HANDLE;
+
+  // 1. First fit in an existing block
+  uint32_t block = UINT32_MAX;
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+    if (allocate_in(i, count, offset)) {
+      block = i;
+      break;
+    }
+  }
+
+  // 2. Otherwise a new block, oversized allocations get their own
+  if (block == UINT32_MAX) {
+    block = create_block(std::max(m_block_elements, count));
+    allocate_in(block, count, offset);
+  }
+
+  Handle handle;
+  if (!m_free_handles.empty()) {
+    handle = m_free_handles.back();
+    m_free_handles.pop_back();
+  } else {
+    handle = static_cast<Handle>(m_allocations.size());
+    m_allocations.push_back({});
+  }
+
+  m_allocations[handle] = {block, offset, count};
+  m_stats.total_allocations++;
+  return handle;
+}
+
+void VertexArena::free(Handle handle) {
+  if (handle == INVALID_HANDLE)
+    return;
+
+  Allocation &alloc = m_allocations[handle];
+  Block &block = m_blocks[alloc.block];
+  release_range(block, alloc.offset, alloc.count);
+
+  alloc = {};
+  m_free_handles.push_back(handle);
+  m_stats.total_frees++;
+
+  // Give empty blocks back to the driver, but keep one around
+  size_t live_blocks = std::count_if(m_blocks.begin(), m_blocks.end(),
+                                     [](const Block &b) { return b.buffer; });
+  if (block.used == 0 && live_blocks > 1) {
+    glDeleteBuffers(1, &block.buffer);
+    block = {};
+  }
+}
+
+void VertexArena::upload(Handle handle, const void *data, uint32_t count,
+                         uint32_t first) {
+  if (m_batching) {
+    size_t bytes = count * m_element_size;
+    m_staged.push_back({handle, first, count, m_staging.size()});
+    m_staging.insert(m_staging.end(), static_cast<const unsigned char *>(data),
+                     static_cast<const unsigned char *>(data) + bytes);
+    return;
+  }
+
+  const Allocation &alloc = m_allocations[handle];
+  glNamedBufferSubData(
+      m_blocks[alloc.block].buffer,
+      static_cast<GLintptr>((alloc.offset + first) * m_element_size),
+      static_cast<GLsizeiptr>(count * m_element_size), data);
+  m_stats.upload_calls++;
+}
+
+void VertexArena::end_batch() {
+  m_batching = false;
+
+  // 1. Sort by destination
+  std::sort(m_staged.begin(), m_staged.end(),
+            [this](const StagedUpload &a, const StagedUpload &b) {
+              const Allocation &x = m_allocations[a.handle];
+              const Allocation &y = m_allocations[b.handle];
+              if (x.block != y.block)
+                return x.block < y.block;
+              return x.offset + a.first < y.offset + b.first;
+            });
+
+  // 2. One call per run of back-to-back ranges in the same block
+  for (size_t i = 0; i < m_staged.size();) {
+    const Allocation &start = m_allocations[m_staged[i].handle];
+    uint32_t first = start.offset + m_staged[i].first;
+    uint32_t end = first + m_staged[i].count;
+
+    size_t j = i + 1;
+    while (j < m_staged.size()) {
+      const Allocation &next = m_allocations[m_staged[j].handle];
+      if (next.block != start.block || next.offset + m_staged[j].first != end)
+        break;
+      end += m_staged[j].count;
+      ++j;
+    }
+
+    const unsigned char *data = m_staging.data() + m_staged[i].data;
+    if (j > i + 1) {
+      m_run.clear();
+      for (size_t k = i; k < j; ++k) {
+        const unsigned char *range = m_staging.data() + m_staged[k].data;
+        m_run.insert(m_run.end(), range,
+                     range + m_staged[k].count * m_element_size);
+      }
+      data = m_run.data();
+    }
+
+    glNamedBufferSubData(m_blocks[start.block].buffer,
+                         static_cast<GLintptr>(first * m_element_size),
+                         static_cast<GLsizeiptr>((end - first) *
+                                                 m_element_size),
+                         data);
+    m_stats.upload_calls++;
+    i = j;
+  }
+
+  m_staged.clear();
+  m_staging.clear();
+}
+
+VertexArena::Location VertexArena::get(Handle handle) const {
+  const Allocation &alloc = m_allocations[handle];
+  return {m_blocks[alloc.block].buffer, alloc.offset, alloc.count};
+}
+
+GLint VertexArena::bind(GLuint vao, Handle handle) {
+  Location loc = get(handle);
+  glVertexArrayVertexBuffer(vao, 0, loc.buffer, 0,
+                            static_cast<GLsizei>(m_element_size));
+  return static_cast<GLint>(loc.offset);
+}
+
+void VertexArena::collect() {
+  for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+    Block &block = m_blocks[i];
+    if (!block.needs_check || block.buffer == 0)
+      continue;
+    block.needs_check = false;
+
+    uint32_t free = block.capacity - block.used;
+    uint32_t largest = 0;
+    for (auto &[_, size] : block.free_ranges)
+      largest = std::max(largest, size);
+
+    double fragmentation = free == 0 ? 0.0 : 1.0 - (double)largest / free;
+    if (free >= block.capacity * DEFRAG_MIN_FREE &&
+        fragmentation > DEFRAG_MIN_FRAGMENTATION) {
+      compact(i);
+      return; // One block per call keeps the frame cost bounded
+    }
+  }
+}
+
+ArenaStats VertexArena::get_stats() const {
+  ArenaStats stats = m_stats;
+  stats.block_count = 0;
+  stats.capacity = 0;
+  stats.used = 0;
+  stats.largest_free = 0;
+
+  for (const Block &block : m_blocks) {
+    if (block.buffer == 0)
+      continue;
+
+    stats.block_count++;
+    stats.capacity += block.capacity;
+    stats.used += block.used;
+    for (auto &[_, size] : block.free_ranges)
+      stats.largest_free = std::max<size_t>(stats.largest_free, size);
+  }
+
+  stats.live_allocations = m_allocations.size() - m_free_handles.size();
+  return stats;
+}
+
+uint32_t VertexArena::create_block(uint32_t capacity) {
+  // Reuse the slot of a released block so block indices stay stable
+  uint32_t index = 0;
+  while (index < m_blocks.size() && m_blocks[index].buffer != 0)
+    ++index;
+  if (index == m_blocks.size())
+    m_blocks.push_back({});
+
+  Block &block = m_blocks[index];
+  glCreateBuffers(1, &block.buffer);
+  glNamedBufferStorage(block.buffer,
+                       static_cast<GLsizeiptr>(capacity * m_element_size),
+                       nullptr, GL_DYNAMIC_STORAGE_BIT);
+  block.capacity = capacity;
+  block.used = 0;
+  block.free_ranges = {{0, capacity}};
+  return index;
+}
+
+bool VertexArena::allocate_in(uint32_t index, uint32_t count,
+                              uint32_t &offset) {
+  Block &block = m_blocks[index];
+  if (block.buffer == 0 || block.capacity - block.used < count)
+    return false;
+
+  for (auto it = block.free_ranges.begin(); it != block.free_ranges.end();
+       ++it) {
+    auto [range_offset, range_size] = *it;
+    if (range_size < count)
+      continue;
+
+    block.free_ranges.erase(it);
+    if (range_size > count)
+      block.free_ranges.emplace(range_offset + count, range_size - count);
+
+    block.used += count;
+    offset = range_offset;
+    return true;
+  }
+  return false;
+}
+
+void VertexArena::release_range(Block &block, uint32_t offset,
+                                uint32_t count) {
+  block.used -= count;
+  block.needs_check = true;
+
+  // Coalesce with the free neighbours on both sides
+  auto next = block.free_ranges.lower_bound(offset);
+  if (next != block.free_ranges.end() && offset + count == next->first) {
+    count += next->second;
+    next = block.free_ranges.erase(next);
+  }
+
+  if (next != block.free_ranges.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += count;
+      return;
+    }
+  }
+
+  block.free_ranges.emplace(offset, count);
+}
+
+void VertexArena::compact(uint32_t index) {
+  Block &block = m_blocks[index];
+
+  std::vector<Handle> live;
+  for (Handle h = 0; h < m_allocations.size(); ++h) {
+    if (m_allocations[h].count > 0 && m_allocations[h].block == index)
+      live.push_back(h);
+  }
+  std::sort(live.begin(), live.end(), [this](Handle a, Handle b) {
+    return m_allocations[a].offset < m_allocations[b].offset;
+  });
+
+  // Copy into fresh storage: ranges inside one buffer may not overlap, and
+  // sliding allocations down in place would
+  GLuint target;
+  glCreateBuffers(1, &target);
+  glNamedBufferStorage(target,
+                       static_cast<GLsizeiptr>(block.capacity * m_element_size),
+                       nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+  uint32_t cursor = 0;
+  for (Handle h : live) {
+    Allocation &alloc = m_allocations[h];
+    glCopyNamedBufferSubData(
+        block.buffer, target,
+        static_cast<GLintptr>(alloc.offset * m_element_size),
+        static_cast<GLintptr>(cursor * m_element_size),
+        static_cast<GLsizeiptr>(alloc.count * m_element_size));
+    alloc.offset = cursor;
+    cursor += alloc.count;
+  }
+
+  glDeleteBuffers(1, &block.buffer);
+  block.buffer = target;
+  block.free_ranges.clear();
+  if (cursor < block.capacity)
+    block.free_ranges.emplace(cursor, block.capacity - cursor);
+
+  m_stats.defragmentations++;
+}
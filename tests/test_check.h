@@ -0,0 +1,25 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the CTest executables: a failed CHECK prints where it
+// failed and keeps going, and main() returns test_result().
+inline int &test_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::cout << "FAILED: " << #condition << " (" << __FILE__ << ":"         \
+                << __LINE__ << ")" << std::endl;                               \
+      test_failures()++;                                                       \
+    }                                                                          \
+  } while (false)
+
+inline int test_result() {
+  if (test_failures() > 0)
+    std::cout << test_failures() << " check(s) failed" << std::endl;
+  return test_failures() == 0 ? 0 : 1;
+}
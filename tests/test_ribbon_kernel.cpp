@@ -0,0 +1,124 @@
+// The SSE2 and AVX2 ribbon kernels against the scalar reference, on seeded
+// random polylines. Levels the CPU lacks fall back, so this runs anywhere.
+
+#include "geometry.h"
+#include "ribbon_kernel.h"
+#include "test_check.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr SimdLevel SIMD_LEVELS[] = {SimdLevel::SSE2, SimdLevel::AVX2};
+
+// A random walk with sharp turns and uneven spacing, like raw pointer input
+std::vector<glm::dvec2> random_polyline(std::mt19937 &rng, size_t count) {
+  std::uniform_real_distribution<double> turn(-2.5, 2.5);
+  std::uniform_real_distribution<double> step(0.0005, 0.02);
+
+  std::vector<glm::dvec2> points = {{0.0, 0.0}};
+  double heading = 0.0;
+  while (points.size() < count) {
+    heading += turn(rng);
+    points.push_back(points.back() +
+                     step(rng) * glm::dvec2(std::cos(heading),
+                                            std::sin(heading)));
+  }
+  return points;
+}
+
+bool near(double a, double b, double tolerance) {
+  return std::abs(a - b) <= tolerance * glm::max(1.0, std::abs(b));
+}
+
+void check_joins(SimdLevel level, const std::vector<glm::dvec2> &points,
+                 size_t begin, size_t end) {
+  RibbonParams params = {points[0], 0.5, 0.02};
+  size_t pairs = end - begin;
+
+  std::vector<double> lengths(points.size(), 0.0);
+  std::vector<double> expected_lengths(points.size(), 0.0);
+  lengths[begin - 1] = expected_lengths[begin - 1] = 0.25;
+
+  std::vector<PointVertex> out(pairs * 2);
+  std::vector<PointVertex> expected(pairs * 2);
+  AABB bounds = {points[begin], points[begin]};
+  AABB expected_bounds = bounds;
+
+  build_ribbon_joins(SimdLevel::Scalar, points.data(), begin, end, params,
+                     expected_lengths.data(), expected.data(),
+                     expected_bounds);
+  build_ribbon_joins(level, points.data(), begin, end, params, lengths.data(),
+                     out.data(), bounds);
+
+  // Positions follow the scalar operation order, so at most a rounding step
+  // of the snorm16 quantization apart
+  for (size_t i = 0; i < out.size(); ++i) {
+    CHECK(std::abs(out[i].position[0] - expected[i].position[0]) <= 1);
+    CHECK(std::abs(out[i].position[1] - expected[i].position[1]) <= 1);
+    CHECK(out[i].side == expected[i].side);
+    CHECK(out[i].cap == expected[i].cap);
+  }
+
+  // Arc lengths come from a reassociated prefix sum
+  for (size_t i = begin; i < end; ++i)
+    CHECK(near(lengths[i], expected_lengths[i], 1e-9));
+
+  CHECK(near(bounds.min.x, expected_bounds.min.x, 1e-12));
+  CHECK(near(bounds.min.y, expected_bounds.min.y, 1e-12));
+  CHECK(near(bounds.max.x, expected_bounds.max.x, 1e-12));
+  CHECK(near(bounds.max.y, expected_bounds.max.y, 1e-12));
+}
+
+void check_distance(SimdLevel level, const std::vector<glm::dvec2> &points,
+                    glm::dvec2 query, double stop_below) {
+  double expected = polyline_distance_squared(SimdLevel::Scalar, points.data(),
+                                              points.size(), query);
+  double distance = polyline_distance_squared(level, points.data(),
+                                              points.size(), query, stop_below);
+
+  // An early stop may return any distance under the threshold
+  if (stop_below >= 0.0 && expected <= stop_below)
+    CHECK(distance <= stop_below * (1.0 + 1e-12));
+  else
+    CHECK(near(distance, expected, 1e-9));
+}
+
+} // namespace
+
+int main() {
+  std::cout << "CPU SIMD level: " << simd_level_name(detect_simd_level())
+            << std::endl;
+
+  std::mt19937 rng(20240601);
+  std::uniform_real_distribution<double> coordinate(-0.2, 0.3);
+
+  for (int trial = 0; trial < 200; ++trial) {
+    // Short polylines exercise the remainder loops after the 2- and 4-wide
+    // bodies, long ones the bodies themselves
+    size_t count = 3 + static_cast<size_t>(rng() % (trial < 100 ? 12 : 400));
+    std::vector<glm::dvec2> points = random_polyline(rng, count);
+
+    size_t begin = 1 + rng() % (count - 2);
+    size_t end = begin + 1 + rng() % (count - 1 - begin);
+    double stop_below = (trial % 3 == 0) ? -1.0 : 1e-4 * (trial % 7);
+
+    for (SimdLevel level : SIMD_LEVELS) {
+      check_joins(level, points, 1, count - 1);
+      check_joins(level, points, begin, end);
+
+      for (int q = 0; q < 16; ++q) {
+        check_distance(level, points, {coordinate(rng), coordinate(rng)},
+                       stop_below);
+      }
+      check_distance(level, {points[0]}, {coordinate(rng), coordinate(rng)},
+                     -1.0);
+    }
+  }
+  return test_result();
+}
@@ -0,0 +1,126 @@
+// The AVX2 span kernel of the software rasterizer against the scalar
+// reference: both must write bit-identical pixels, for pens, erasers, dots
+// and spans that do not end on a group of 8. Skipped without AVX2.
+
+#include "ribbon_kernel.h"
+#include "software_rasterizer.h"
+#include "test_check.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Segment = SoftwareRasterizer::Segment;
+
+// Columns of a tile row, plus guard pixels a span must not touch
+constexpr int ROW_PIXELS = SoftwareRasterizer::TILE_SIZE + 8;
+
+// Spans as shade_tile() issues them, and ones that start or end mid-group
+constexpr int SPANS[][2] = {{0, 32}, {8, 24}, {0, 13}, {5, 29}, {3, 6}};
+
+struct Row {
+  std::vector<float> r, g, b, a;
+
+  bool operator==(const Row &other) const {
+    auto same = [](const std::vector<float> &x, const std::vector<float> &y) {
+      return std::memcmp(x.data(), y.data(), x.size() * sizeof(float)) == 0;
+    };
+    return same(r, other.r) && same(g, other.g) && same(b, other.b) &&
+           same(a, other.a);
+  }
+};
+
+Segment make_segment(glm::vec2 start, glm::vec2 stop) {
+  glm::vec2 direction = stop - start;
+  float length2 = glm::dot(direction, direction);
+  return {start.x, start.y, direction.x, direction.y,
+          length2 > 0.0f ? 1.0f / length2 : 0.0f};
+}
+
+// A random walk across the tile, in tile coordinates
+std::vector<Segment> random_segments(std::mt19937 &rng, size_t count) {
+  std::uniform_real_distribution<float> coordinate(-4.0f, 36.0f);
+  std::uniform_real_distribution<float> step(-6.0f, 6.0f);
+
+  std::vector<Segment> segments;
+  glm::vec2 point(coordinate(rng), coordinate(rng));
+  for (size_t i = 0; i < count; ++i) {
+    glm::vec2 next = point + glm::vec2(step(rng), step(rng));
+    segments.push_back(make_segment(point, next));
+    point = next;
+  }
+  return segments;
+}
+
+// Premultiplied paint already in the tile, so erasers have something to cut
+Row random_row(std::mt19937 &rng) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  Row row;
+  for (int x = 0; x < ROW_PIXELS; ++x) {
+    float alpha = unit(rng);
+    row.r.push_back(unit(rng) * alpha);
+    row.g.push_back(unit(rng) * alpha);
+    row.b.push_back(unit(rng) * alpha);
+    row.a.push_back(alpha);
+  }
+  return row;
+}
+
+void check_span(const std::vector<Segment> &segments, const Row &row, float y,
+                float aspect, float radius, glm::vec3 color, bool is_eraser) {
+  for (const int *span : SPANS) {
+    Row expected = row;
+    Row actual = row;
+    shade_stroke_span(SimdLevel::Scalar, segments.data(), segments.size(), y,
+                      span[0], span[1], aspect, radius, color, is_eraser,
+                      expected.r.data(), expected.g.data(), expected.b.data(),
+                      expected.a.data());
+    shade_stroke_span(SimdLevel::AVX2, segments.data(), segments.size(), y,
+                      span[0], span[1], aspect, radius, color, is_eraser,
+                      actual.r.data(), actual.g.data(), actual.b.data(),
+                      actual.a.data());
+    CHECK(actual == expected);
+
+    // Nothing outside the span changes
+    for (int x = 0; x < ROW_PIXELS; ++x) {
+      if (x >= span[0] && x < span[1])
+        continue;
+      CHECK(actual.a[x] == row.a[x]);
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  if (detect_simd_level() != SimdLevel::AVX2) {
+    std::cout << "No AVX2 on this CPU, skipping" << std::endl;
+    return 0;
+  }
+
+  std::mt19937 rng(20240601);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  for (int trial = 0; trial < 500; ++trial) {
+    std::vector<Segment> segments =
+        random_segments(rng, 1 + rng() % (trial < 250 ? 4 : 40));
+    Row row = random_row(rng);
+    float y = unit(rng) * 32.0f;
+    float aspect = trial % 2 == 0 ? 1.0f : 0.5f + unit(rng);
+    float radius = 0.25f + unit(rng) * 8.0f;
+    glm::vec3 color(unit(rng), unit(rng), unit(rng));
+    bool is_eraser = trial % 3 == 0;
+    check_span(segments, row, y, aspect, radius, color, is_eraser);
+
+    // A dot: one segment of zero length
+    glm::vec2 center(unit(rng) * 32.0f, y + (unit(rng) - 0.5f) * radius);
+    std::vector<Segment> dot = {make_segment(center, center)};
+    check_span(dot, row, y, aspect, radius, color, is_eraser);
+  }
+  return test_result();
+}
@@ -0,0 +1,85 @@
+// Journal replay of committed strokes: after a reload, a stroke must have
+// the points it was finalized to, not the raw samples it was committed
+// with.
+
+#include "stroke.h"
+#include "stroke_journal.h"
+#include "test_check.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr double THICKNESS = 0.01;
+constexpr double SIMPLIFY_TOLERANCE = 0.0005;
+
+// Densely sampled, nearly straight: simplification drops most samples
+Stroke make_stroke(double y) {
+  Stroke stroke({0.2f, 0.4f, 0.6f}, THICKNESS);
+  for (int i = 0; i < 200; ++i)
+    stroke.add_point(i * 0.002, y + 0.0001 * std::sin(i * 0.3));
+  return stroke;
+}
+
+std::vector<glm::dvec2> points_of(const Stroke &stroke) {
+  std::vector<glm::dvec2> decoded;
+  std::span<const glm::dvec2> points =
+      stroke.get_raw_points().contiguous(decoded);
+  return {points.begin(), points.end()};
+}
+
+void test_finalized_points_replay(const std::string &document) {
+  Stroke first = make_stroke(0.0);
+  Stroke second = make_stroke(0.1);
+  Stroke finalized = first.clone_geometry();
+  finalized.finalize(SIMPLIFY_TOLERANCE);
+  CHECK(finalized.get_raw_points().size() < first.get_raw_points().size());
+
+  {
+    StrokeJournal journal(document);
+    std::vector<Stroke> strokes, reverted;
+    journal.load(strokes, reverted);
+
+    // As PaintApp does it: commit with the raw samples, then record the
+    // finalized points once the worker is done, after later edits
+    journal.append_commit(first);
+    journal.append_commit(second);
+    journal.append_undo();
+    journal.append_finalized(0, finalized);
+    journal.flush();
+  }
+
+  std::vector<Stroke> strokes, reverted;
+  StrokeJournal::read(document, strokes, reverted);
+  CHECK(strokes.size() == 1);
+  CHECK(reverted.size() == 1);
+  if (strokes.size() != 1 || reverted.size() != 1)
+    return;
+
+  CHECK(points_of(strokes[0]) == points_of(finalized));
+  CHECK(strokes[0].get_color() == finalized.get_color());
+  CHECK(strokes[0].get_thickness() == finalized.get_thickness());
+
+  // The redo stack is left alone
+  CHECK(points_of(reverted[0]) == points_of(second));
+}
+
+} // namespace
+
+int main() {
+  fs::path directory = fs::temp_directory_path() / "simple-paint-test-journal";
+  fs::remove_all(directory);
+  fs::create_directories(directory);
+
+  test_finalized_points_replay((directory / "canvas.spd").string());
+
+  fs::remove_all(directory);
+  return test_result();
+}
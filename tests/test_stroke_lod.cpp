@@ -0,0 +1,191 @@
+// Every LOD ribbon that select_lod() picks must draw within half a pixel of
+// the full-resolution stroke. Coverage is computed the way stroke.vert /
+// stroke.frag do it, over the triangle strip of the level.
+
+#include "geometry.h"
+#include "ribbon_kernel.h"
+#include "stroke.h"
+#include "test_check.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace {
+
+constexpr double THICKNESS = 0.01;
+constexpr double SAMPLE_STEP = 0.003; // Pointer input at the default zoom
+constexpr double MAX_OUTLINE_ERROR = 0.5; // Pixels
+
+struct Ribbon {
+  std::vector<glm::dvec2> positions;
+  std::vector<double> side; // Across the ribbon, [0, 1]
+  std::vector<double> cap;  // Into the caps, [-1, 1]
+};
+
+Ribbon decode_ribbon(const Stroke &stroke, LodLevel level) {
+  StrokeStyle style = stroke.get_style();
+  std::span<const PointVertex> vertices(
+      stroke.get_render_vertices().data() + level.first_vertex,
+      level.vertex_count);
+
+  Ribbon ribbon;
+  for (const PointVertex &vertex : vertices) {
+    glm::dvec2 q(vertex.position[0] / 32767.0, vertex.position[1] / 32767.0);
+    ribbon.positions.push_back(glm::dvec2(style.origin) +
+                               q * static_cast<double>(style.extent));
+    ribbon.side.push_back(vertex.side / 255.0);
+    ribbon.cap.push_back(vertex.cap / 127.0);
+  }
+  return ribbon;
+}
+
+// Distance from the centerline the fragment shader computes at `point`,
+// if triangle `i` of the strip covers it
+bool shade(const Ribbon &ribbon, size_t i, glm::dvec2 point, double radius,
+           double &distance) {
+  glm::dvec2 a = ribbon.positions[i];
+  glm::dvec2 b = ribbon.positions[i + 1];
+  glm::dvec2 c = ribbon.positions[i + 2];
+  double area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+  if (std::abs(area) < 1e-18)
+    return false;
+
+  double wb = ((point.x - a.x) * (c.y - a.y) - (point.y - a.y) * (c.x - a.x)) /
+              area;
+  double wc = ((b.x - a.x) * (point.y - a.y) - (b.y - a.y) * (point.x - a.x)) /
+              area;
+  double wa = 1.0 - wb - wc;
+  if (wa < 0.0 || wb < 0.0 || wc < 0.0)
+    return false;
+
+  double side = wa * ribbon.side[i] + wb * ribbon.side[i + 1] +
+                wc * ribbon.side[i + 2];
+  double cap =
+      wa * ribbon.cap[i] + wb * ribbon.cap[i + 1] + wc * ribbon.cap[i + 2];
+  double dx = (side - 0.5) * 2.0 * radius;
+  double dy = cap * radius;
+  distance = std::sqrt(dx * dx + dy * dy);
+  return true;
+}
+
+// The centerline of a ribbon: midpoints of its body pairs (the first and
+// last pair close the caps)
+std::vector<glm::dvec2> ribbon_centerline(const Ribbon &ribbon) {
+  std::vector<glm::dvec2> points;
+  for (size_t i = 2; i + 3 < ribbon.positions.size(); i += 2)
+    points.push_back((ribbon.positions[i] + ribbon.positions[i + 1]) * 0.5);
+  return points;
+}
+
+void check_outline(const Stroke &stroke, size_t lod, double pixel_size,
+                   std::mt19937 &rng) {
+  std::vector<glm::dvec2> storage;
+  std::span<const glm::dvec2> centerline = stroke.get_centerline(storage);
+  Ribbon ribbon = decode_ribbon(stroke, stroke.get_lod(lod));
+  double radius = stroke.get_thickness() * 0.5;
+  double slack = MAX_OUTLINE_ERROR * pixel_size;
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  // 1. Nothing the level draws is more than half a pixel outside level 0
+  for (size_t i = 0; i + 2 < ribbon.positions.size(); ++i) {
+    for (int sample = 0; sample < 64; ++sample) {
+      double u = unit(rng), v = unit(rng);
+      if (u + v > 1.0) {
+        u = 1.0 - u;
+        v = 1.0 - v;
+      }
+      glm::dvec2 point = ribbon.positions[i] * (1.0 - u - v) +
+                         ribbon.positions[i + 1] * u +
+                         ribbon.positions[i + 2] * v;
+
+      double distance;
+      if (!shade(ribbon, i, point, radius, distance) || distance > radius)
+        continue;
+      double reach = radius + slack;
+      CHECK(polyline_distance_squared(centerline.data(), centerline.size(),
+                                      point) <= reach * reach);
+    }
+  }
+
+  // 2. Nothing level 0 draws is more than half a pixel from the level
+  std::vector<glm::dvec2> lod_centerline = ribbon_centerline(ribbon);
+  for (glm::dvec2 center : centerline) {
+    for (int sample = 0; sample < 8; ++sample) {
+      double angle = unit(rng) * 6.283185307179586;
+      double offset = unit(rng) * radius;
+      glm::dvec2 point =
+          center + offset * glm::dvec2(std::cos(angle), std::sin(angle));
+      double reach = radius + slack;
+      CHECK(polyline_distance_squared(lod_centerline.data(),
+                                      lod_centerline.size(),
+                                      point) <= reach * reach);
+    }
+  }
+}
+
+Stroke make_stroke(const std::vector<glm::dvec2> &points) {
+  Stroke stroke({0.0f, 0.0f, 0.0f}, THICKNESS);
+  for (glm::dvec2 point : points)
+    stroke.add_point(point.x, point.y);
+  stroke.update_geometry();
+  return stroke;
+}
+
+std::vector<std::vector<glm::dvec2>> make_shapes(std::mt19937 &rng) {
+  std::vector<std::vector<glm::dvec2>> shapes(4);
+
+  // Straight line, gentle wave, spiral and a wandering scribble
+  for (int i = 0; i < 100; ++i) {
+    double t = i * SAMPLE_STEP;
+    shapes[0].push_back({t, 0.5 * t});
+    shapes[1].push_back({t, 0.02 * std::sin(t * 20.0)});
+    double angle = i * 0.15;
+    shapes[2].push_back((0.01 + 0.002 * angle) *
+                        glm::dvec2(std::cos(angle), std::sin(angle)));
+  }
+
+  std::normal_distribution<double> turn(0.0, 0.3);
+  glm::dvec2 point(0.0);
+  double heading = 0.0;
+  for (int i = 0; i < 300; ++i) {
+    heading += turn(rng);
+    point += SAMPLE_STEP * glm::dvec2(std::cos(heading), std::sin(heading));
+    shapes[3].push_back(point);
+  }
+  return shapes;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(20240601);
+
+  for (const std::vector<glm::dvec2> &points : make_shapes(rng)) {
+    Stroke stroke = make_stroke(points);
+    CHECK(stroke.get_lod_count() > 1);
+
+    glm::dvec2 extent = stroke.get_bounds().max - stroke.get_bounds().min;
+    double size = glm::max(extent.x, extent.y);
+
+    // From zoomed in past the default (about 0.0033 world units per pixel)
+    // to where the stroke is a few pixels across
+    for (double pixel_size = 0.0002; pixel_size < size * 0.5;
+         pixel_size *= 1.25) {
+      size_t lod = stroke.select_lod(pixel_size);
+      if (lod > 0)
+        check_outline(stroke, lod, pixel_size, rng);
+    }
+
+    // At the default zoom a stroke of the default thickness keeps its full
+    // resolution
+    CHECK(stroke.select_lod(0.0033) == 0);
+
+    // Under a pixel the stroke collapses to the coarsest level
+    CHECK(stroke.select_lod(size * 2.0) == stroke.get_lod_count() - 1);
+  }
+  return test_result();
+}
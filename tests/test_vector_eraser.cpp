@@ -0,0 +1,118 @@
+// Vector eraser cuts, in particular a single click: an eraser stroke with
+// one sample has no smooth points, yet its centerline is that sample and it
+// erases as a dot. Cuts remove ink, not just centerline: the round caps of
+// the surviving pieces must end at the eraser's edge.
+
+#include "stroke.h"
+#include "test_check.h"
+#include "vector_eraser.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <span>
+#include <vector>
+
+namespace {
+
+constexpr double THICKNESS = 0.1;
+
+// As PaintApp cuts: the eraser's radius grown by the stroke's
+constexpr double CUT_RADIUS = THICKNESS * 0.5 + THICKNESS * 0.5;
+
+bool near(glm::dvec2 a, glm::dvec2 b) { return glm::distance(a, b) < 1e-9; }
+
+// A horizontal line from (0, 0) to (1, 0), sampled every 0.1
+std::vector<glm::dvec2> make_line() {
+  std::vector<glm::dvec2> points;
+  for (int i = 0; i <= 10; ++i)
+    points.push_back({i * 0.1, 0.0});
+  return points;
+}
+
+void test_click_centerline() {
+  Stroke eraser({1.0f, 1.0f, 1.0f}, THICKNESS, true);
+  eraser.add_point(0.5, 0.0);
+
+  std::vector<glm::dvec2> storage;
+  std::span<const glm::dvec2> path = eraser.get_centerline(storage);
+  CHECK(eraser.get_smooth_points().empty());
+  CHECK(path.size() == 1);
+  CHECK(path.size() == 1 && near(path[0], {0.5, 0.0}));
+}
+
+void test_click_splits_line() {
+  std::vector<glm::dvec2> line = make_line();
+  std::vector<glm::dvec2> click = {{0.5, 0.0}};
+  std::vector<std::vector<glm::dvec2>> pieces;
+
+  CHECK(erase_along_path(std::span<const glm::dvec2>(line), click,
+                         CUT_RADIUS, pieces));
+  CHECK(pieces.size() == 2);
+  if (pieces.size() != 2)
+    return;
+
+  // The caps of the pieces, one stroke radius long, end exactly at the edge
+  // of the dot (0.45 and 0.55)
+  CHECK(near(pieces[0].front(), {0.0, 0.0}));
+  CHECK(near(pieces[0].back(), {0.4, 0.0}));
+  CHECK(near(pieces[1].front(), {0.6, 0.0}));
+  CHECK(near(pieces[1].back(), {1.0, 0.0}));
+}
+
+// The dot covers the edge of the ink but not the centerline
+void test_click_cuts_edge() {
+  std::vector<glm::dvec2> line = make_line();
+  std::vector<glm::dvec2> click = {{0.5, 0.06}};
+  std::vector<std::vector<glm::dvec2>> pieces;
+
+  CHECK(erase_along_path(std::span<const glm::dvec2>(line), click,
+                         CUT_RADIUS, pieces));
+  CHECK(pieces.size() == 2);
+}
+
+void test_click_misses_line() {
+  std::vector<glm::dvec2> line = make_line();
+  std::vector<glm::dvec2> click = {{0.5, 0.12}};
+  std::vector<std::vector<glm::dvec2>> pieces;
+
+  CHECK(!erase_along_path(std::span<const glm::dvec2>(line), click,
+                          CUT_RADIUS, pieces));
+  CHECK(pieces.empty());
+}
+
+void test_click_erases_dot() {
+  std::vector<glm::dvec2> dot = {{0.3, 0.3}};
+  std::vector<glm::dvec2> click = {{0.32, 0.3}};
+  std::vector<std::vector<glm::dvec2>> pieces;
+
+  CHECK(erase_along_path(std::span<const glm::dvec2>(dot), click,
+                         CUT_RADIUS, pieces));
+  CHECK(pieces.empty());
+}
+
+void test_path_trims_end() {
+  std::vector<glm::dvec2> line = make_line();
+  std::vector<glm::dvec2> path = {{0.7, -1.0}, {0.7, 1.0}};
+  std::vector<std::vector<glm::dvec2>> pieces;
+
+  CHECK(erase_along_path(std::span<const glm::dvec2>(line), path,
+                         CUT_RADIUS, pieces));
+  CHECK(pieces.size() == 2);
+  if (pieces.size() == 2) {
+    CHECK(near(pieces[0].back(), {0.6, 0.0}));
+    CHECK(near(pieces[1].front(), {0.8, 0.0}));
+  }
+}
+
+} // namespace
+
+int main() {
+  test_click_centerline();
+  test_click_splits_line();
+  test_click_cuts_edge();
+  test_click_misses_line();
+  test_click_erases_dot();
+  test_path_trims_end();
+  return test_result();
+}